@@ -4,6 +4,7 @@
 #define DAGEE_INCLUDE_DAGEE_ATMI_EXECUTOR_BASE_H
 
 #include "dagee/ATMIcoreDef.h"
+#include "dagee/ExecutorAccess.h"
 
 #include "atmi.h"
 #include "atmi_runtime.h"
@@ -12,28 +13,6 @@
 
 namespace dagee {
 
-/**
- * Provides access to private methods of the executor
- */
-template <typename Exec>
-struct ExecutorAccess {
-  Exec* mExec;
-
-  template <typename TaskInstance, typename V = std::initializer_list<ATMItaskHandle>>
-  ATMItaskHandle makeInternalTask(const TaskInstance& ti, const V& predHandles = V()) {
-    return mExec->makeInternalTask(ti, predHandles);
-  }
-};
-
-namespace impl {
-template <typename Exec, typename V = std::initializer_list<ATMItaskHandle>>
-ATMItaskHandle makeInternalTaskForDag(Exec* execPtr, const typename Exec::TaskInstance& ti,
-                                      const V& predHandles = V()) {
-  ExecutorAccess<Exec> ea{execPtr};
-  return ea.makeInternalTask(ti, predHandles);
-}
-} // namespace impl
-
 /**
  * This class defines the minimally necessary interface of an Executor
  */
@@ -48,6 +27,12 @@ struct HypotheticalExecutor {
    */
   using TaskInstance = HypotheticalTaskInstance;
 
+  /**
+   * Must expose a public typename TaskHandle, the handle of a task made by
+   * makeInternalTask or launchTask
+   */
+  using TaskHandle = ATMItaskHandle;
+
  private:
   /**
    * a private method to create an internal ATMI task from a TaskInstance
@@ -57,6 +42,20 @@ struct HypotheticalExecutor {
     return ATMItaskHandle{};
   }
 
+  /**
+   * Optional: launch parameters etc. of a TaskInstance precomputed once, and
+   * private methods to compute them and to create an internal ATMI task from
+   * them. Needed by ATMIdagExecutor::instantiate
+   */
+  struct PreparedTask {};
+
+  PreparedTask prepareTask(const TaskInstance& ti, const ATMItaskHandle* predsArr,
+                           size_t numPreds) {
+    return PreparedTask{};
+  }
+
+  ATMItaskHandle makePreparedTask(PreparedTask& pt) { return ATMItaskHandle{}; }
+
   /**
    * Must have this friend declaration which allows access to makeInternalTask
    */
@@ -82,11 +81,21 @@ struct HypotheticalExecutor {
   ATMItaskHandle launchTask(const TaskInstance& ti, const V& predecessors) {
     return ATMItaskHandle{};
   }
+
+  /**
+   * Start a task made by makeInternalTask without predecessors, and block until
+   * a task has completed. Used by generic DAG executors, see DAGexecutor.h
+   */
+  void activateTask(const ATMItaskHandle& t) {}
+
+  void waitOnTask(const ATMItaskHandle& t) {}
 };
 
 template <typename KernelRegPolicy, typename TaskLaunchPolicy>
 struct ExecutorSkeletonAtmi : public InitAtmiBase, public KernelRegPolicy, public TaskLaunchPolicy {
   using TaskInstance = typename TaskLaunchPolicy::TaskInstance;
+  using TaskHandle = ATMItaskHandle;
+  using PreparedTask = typename TaskLaunchPolicy::PreparedTask;
   using KernelInfo = typename KernelRegPolicy::KernelInfo;
 
  protected:
@@ -113,6 +122,16 @@ struct ExecutorSkeletonAtmi : public InitAtmiBase, public KernelRegPolicy, publi
     return TaskLaunchPolicy::makeInternalTask(ti, predHandles.data(), predHandles.size());
   }
 
+  //! predsArr must stay valid, and hold the predecessor handles, whenever pt is made into a task
+  PreparedTask prepareTask(const TaskInstance& ti, const ATMItaskHandle* predsArr,
+                           size_t numPreds) const {
+    return TaskLaunchPolicy::prepareTask(ti, predsArr, numPreds);
+  }
+
+  ATMItaskHandle makePreparedTask(PreparedTask& pt) const {
+    return TaskLaunchPolicy::makePreparedTask(pt);
+  }
+
  public:
   ExecutorSkeletonAtmi() : InitAtmiBase(), KernelRegPolicy(), TaskLaunchPolicy() {}
 
@@ -131,6 +150,8 @@ struct ExecutorSkeletonAtmi : public InitAtmiBase, public KernelRegPolicy, publi
   void waitOnTasks(std::initializer_list<ATMItaskHandle> l) const { impl::waitOnTasks(l); }
 
   void waitOnTask(const ATMItaskHandle& t) const { impl::waitOnTask(t); }
+
+  void activateTask(const ATMItaskHandle& t) const { impl::activateTask(t); }
 };
 
 } // end namespace dagee
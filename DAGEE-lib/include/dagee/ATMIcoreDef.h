@@ -13,6 +13,8 @@
 #include "hip/hip_runtime.h"
 
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 
 #include <type_traits>
 
@@ -22,6 +24,8 @@ using ATMIkernelHandle = atmi_kernel_t;
 using ATMItaskHandle = atmi_task_handle_t;
 using ATMIlaunchParam = atmi_lparm_t;
 using ATMIcopyParam = atmi_cparm_t;
+//! state of a task, updated by ATMI when given as task_info in the launch param
+using ATMItaskInfo = atmi_task_t;
 
 enum MemType : std::underlying_type<atmi_devtype_t>::type {
   // NOTE (Kiran) : Allocations with SHARED MemType is accessible from both CPU
@@ -71,6 +75,20 @@ inline void activateTasks(std::initializer_list<ATMItaskHandle> l) { activateTas
 
 inline void activateTask(const ATMItaskHandle& t) { atmi_task_activate(t); }
 
+//! non-blocking completion check of a task launched with task_info = &info
+inline bool isTaskCompleted(const ATMItaskInfo& info) noexcept {
+  // written by the ATMI runtime threads
+  return __atomic_load_n(&info.state, __ATOMIC_ACQUIRE) == ATMI_COMPLETED;
+}
+
+//! a kernel handle as an integer, usable as a hash map key
+inline uint64_t kernelKey(const ATMIkernelHandle& k) noexcept {
+  static_assert(sizeof(ATMIkernelHandle) == sizeof(uint64_t), "unexpected size of kernel handle");
+  uint64_t key;
+  std::memcpy(&key, &k, sizeof(key));
+  return key;
+}
+
 inline atmi_mem_place_t initMemPlaceAtmi(MemType memType) {
   atmi_mem_place_t place;
   place.node_id = 0;
@@ -125,7 +143,33 @@ template <typename TargetLaunchPolicy, typename AllocFactory = dagee::StdAllocat
 struct KernelLaunchAtmiPolicy {
   using TaskInstance = typename TargetLaunchPolicy::TaskInstance;
 
+  /**
+   * Everything atmi_task_create needs for a TaskInstance, computed once so that
+   * the task can be re-created many times (see ExecutableDAG). Argument
+   * addresses point into the kernel argument buffer of the TaskInstance, which
+   * must stay in place for as long as the PreparedTask is used
+   */
+  struct PreparedTask {
+    ATMIlaunchParam mLaunchParam;
+    ATMIkernelHandle mKern;
+    typename TaskInstance::VecArgAddr mArgAddrs;
+  };
+
  protected:
+  static PreparedTask prepareTask(const TaskInstance& ti, const ATMItaskHandle* predsArr,
+                                  size_t numPreds) {
+    PreparedTask pt{TargetLaunchPolicy::initLaunchParam(ti), TargetLaunchPolicy::kernelHandle(ti),
+                    ti.argAddresses()};
+    // TODO: find a way to remove this cast
+    pt.mLaunchParam.requires = const_cast<ATMItaskHandle*>(predsArr);
+    pt.mLaunchParam.num_required = numPreds;
+    return pt;
+  }
+
+  static ATMItaskHandle makePreparedTask(PreparedTask& pt) {
+    return atmi_task_create(&pt.mLaunchParam, pt.mKern, pt.mArgAddrs.data());
+  }
+
   static ATMItaskHandle makeInternalTask(const TaskInstance& ti, const ATMItaskHandle* predsArr,
                                          size_t numPreds) {
     auto lp = TargetLaunchPolicy::initLaunchParam(ti);
@@ -151,6 +195,9 @@ struct KernelLaunchAtmiPolicy {
   TaskInstance makeTask(Args&&... args) const {
     return TargetLaunchPolicy::makeTask(std::forward<Args>(args)...);
   }
+
+  //! identifies the kernel that ti runs, e.g., to key per-kernel statistics
+  static uint64_t kernelKey(const TaskInstance& ti) { return TargetLaunchPolicy::kernelKey(ti); }
 };
 
 template <typename U>
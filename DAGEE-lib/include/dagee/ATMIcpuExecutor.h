@@ -139,6 +139,11 @@ struct CpuKernelLaunchAtmiPolicy {
 
   static ATMIkernelHandle kernelHandle(const TaskInstance& ti) { return ti.mCpuKernelInfo.mKern; }
 
+  //! functions of the same signature share one ATMI kernel, so key on the function instead
+  static uint64_t kernelKey(const TaskInstance& ti) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ti.mCpuKernelInfo.mFuncPtr));
+  }
+
   template <typename... Args>
   static TaskInstance makeTask(const dim3& threads, const KernelInfo& kinfo, Args&&... args) {
     return TaskInstance(threads, kinfo, std::forward<Args>(args)...);
@@ -5,10 +5,16 @@
 
 #include "dagee/ATMIcpuExecutor.h"
 #include "dagee/ATMIgpuExecutor.h"
+#include "dagee/CostModel.h"
+#include "dagee/ExecutableDAG.h"
 #include "dagee/TaskDAG.h"
 
 #include "cpputils/Timer.h"
 
+#include <algorithm>
+#include <functional>
+#include <utility>
+
 namespace dagee {
 /*
  * TODO(amber): Fix Allocators for all containers.
@@ -33,18 +39,37 @@ class ATMIdagExecutor {
   using Node = typename DAG::Node;
   using NodePtr = typename DAG::NodePtr;
   using NodeCptr = typename DAG::NodeCptr;
+  using ExecDAG = ExecutableDAG<ExecT, AllocFactory>;
+  //! estimated duration of a task, see CostModel.h
+  using CostModel = std::function<double(const TaskInstance&)>;
+  using KernelCosts = KernelCostTable<uint64_t>;
 
  protected:
   using DAGmgr = DAGmanager<DAG, AllocFactory>;
   using NodePtrVec = typename AllocFactory::template Vec<NodePtr>;
   using NodeQ = typename AllocFactory::template Deque<NodePtr>;
   using ATMIhandleVec = typename AllocFactory::template Vec<ATMItaskHandle>;
+  using IndexVec = typename AllocFactory::template Vec<typename DAG::Index>;
+  using CostVec = typename AllocFactory::template Vec<double>;
+  using PrioHandleVec = typename AllocFactory::template Vec<std::pair<double, ATMItaskHandle>>;
 
   DAGmgr mDAGmgr;
   ExecT& mExec;
+  //! scratch space for makeLazyTasksFrozen etc., reused across calls
+  ATMIhandleVec mHandlesByIndex;
+  CostVec mBottomLevels;
+  IndexVec mOrder;
+  bool mReduceEdges = false;
+  bool mPrioritize = false;
+  CostModel mCostModel = UniformCostModel();
 
   template <typename V1, typename V2>
   inline void makeLazyTasks(DAGptr dag, V1& srcHandles, V2& sinkHandles) {
+    if (dag->isFrozen()) {
+      makeLazyTasksFrozen(dag, srcHandles, sinkHandles);
+      return;
+    }
+
     ATMIhandleVec predHandles;
     dag->forEachNode_TopoOrder([&, this](NodePtr task) {
       predHandles.clear();
@@ -71,6 +96,94 @@ class ATMIdagExecutor {
     });
   }
 
+  /**
+   * Same as makeLazyTasks but walks the CSR arrays of a frozen DAG. Task handles
+   * are kept in an array indexed by node index so that collecting predecessor
+   * handles does not touch the predecessor nodes at all
+   */
+  template <typename V1, typename V2>
+  inline void makeLazyTasksFrozen(DAGptr dag, V1& srcHandles, V2& sinkHandles) {
+    using Index = typename DAG::Index;
+    const auto& fz = dag->frozen();
+
+    makeTasksInOrder(dag, fz.topoOrder());
+
+    for (Index i : fz.sources()) {
+      srcHandles.emplace_back(mHandlesByIndex[i]);
+    }
+
+    for (Index i : fz.sinks()) {
+      sinkHandles.emplace_back(mHandlesByIndex[i]);
+    }
+  }
+
+  //! create the tasks of a frozen DAG in the given topological order of node indices
+  template <typename O>
+  inline void makeTasksInOrder(DAGptr dag, const O& order) {
+    using Index = typename DAG::Index;
+    const auto& fz = dag->frozen();
+
+    mHandlesByIndex.resize(fz.size());
+    ATMIhandleVec predHandles;
+
+    for (Index i : order) {
+      predHandles.clear();
+      for (Index p : fz.predecessors(i)) {
+        predHandles.emplace_back(mHandlesByIndex[p]);
+      }
+
+      auto& tdata = dag->nodeData(fz.node(i));
+      tdata.mATMItaskHandle = impl::makeInternalTaskForDag(&mExec, tdata, predHandles);
+      mHandlesByIndex[i] = tdata.mATMItaskHandle;
+    }
+  }
+
+  /**
+   * Critical path first: tasks are created in priority order (see
+   * DAGbase::computePriorityOrder). Sources are returned with their bottom
+   * level, to be activated across DAGs in decreasing order. Once activated,
+   * the order in which ATMI runs the dependents of a task is up to ATMI
+   */
+  template <typename V>
+  inline void makeLazyTasksPrioritized(DAGptr dag, PrioHandleVec& srcHandles, V& sinkHandles) {
+    using Index = typename DAG::Index;
+
+    dag->computeBottomLevels(mCostModel, mBottomLevels);
+    dag->computePriorityOrder(mBottomLevels, mOrder);
+
+    makeTasksInOrder(dag, mOrder);
+
+    const auto& fz = dag->frozen();
+    for (Index i : fz.sources()) {
+      srcHandles.emplace_back(mBottomLevels[i], mHandlesByIndex[i]);
+    }
+
+    for (Index i : fz.sinks()) {
+      sinkHandles.emplace_back(mHandlesByIndex[i]);
+    }
+  }
+
+  template <typename DAGptrIter>
+  void makeAndActivatePrioritized(DAGptrIter beg, DAGptrIter end, ATMIhandleVec& sinkHandles) {
+    PrioHandleVec srcHandles;
+
+    for (auto i = beg; i != end; ++i) {
+      DAGptr dag = *i;
+      if (mReduceEdges) {
+        dag->transitiveReduce();
+      }
+      makeLazyTasksPrioritized(dag, srcHandles, sinkHandles);
+    }
+
+    std::stable_sort(srcHandles.begin(), srcHandles.end(),
+                     [](const std::pair<double, ATMItaskHandle>& a,
+                        const std::pair<double, ATMItaskHandle>& b) { return a.first > b.first; });
+
+    for (const auto& p : srcHandles) {
+      impl::activateTask(p.second);
+    }
+  }
+
   /*
 template <typename V1, typename V2>
 inline void makeLazyGpuTasks(DAGptr dag, V1& srcHandles, V2& sinkHandles) {
@@ -127,10 +240,43 @@ inline void makeLazyGpuTasks(DAGptr dag, V1& srcHandles, V2& sinkHandles) {
   ExecT& targetExec() noexcept { return mExec; }
   const ExecT& targetExec() const noexcept { return mExec; }
 
+  /**
+   * Remove redundant edges (see DAGbase::transitiveReduce) from each DAG before
+   * creating its tasks, so that tasks carry fewer dependencies. The pass is
+   * skipped for DAGs not modified since their last reduction.
+   */
+  void enableTransitiveReduction(bool enable = true) noexcept { mReduceEdges = enable; }
+
+  /**
+   * Create and activate tasks critical path first, by bottom levels under the
+   * cost model (see setCostModel). Freezes every DAG executed. Off by default,
+   * in which case tasks are created in an arbitrary topological order.
+   */
+  void enablePriorityScheduling(bool enable = true) noexcept { mPrioritize = enable; }
+
+  //! the default model, UniformCostModel, prioritizes by number of tasks on the longest path
+  void setCostModel(CostModel costModel) { mCostModel = std::move(costModel); }
+
+  /**
+   * Estimate the cost of each task from the estimate of its kernel in costs,
+   * which must outlive this executor. Estimates learned by costs later on
+   * apply to later executions
+   */
+  void setCostModel(const KernelCosts& costs) {
+    setCostModel(makeKernelCostModel(
+        costs, [](const TaskInstance& ti) { return ExecT::kernelKey(ti); }));
+  }
+
   DAGptr makeDAG(void) { return mDAGmgr.makeDAG(); }
 
   void destroyDAG(DAGptr d) { mDAGmgr.destroyDAG(d); }
 
+  //! see DAGmanager::makeDAGfromFile. Needs dagee/DAGserialize.h
+  template <typename C>
+  DAGptr makeDAGfromFile(const char* path, const C& codec) {
+    return mDAGmgr.makeDAGfromFile(path, codec);
+  }
+
   template <typename DAGptrIter>
   void executeParallel(DAGptrIter beg, DAGptrIter end) {
     cpputils::Timer t0("HIP-ATMI", "ATMI-DAG-Create", true);
@@ -138,12 +284,19 @@ inline void makeLazyGpuTasks(DAGptr dag, V1& srcHandles, V2& sinkHandles) {
     ATMIhandleVec srcHandles;
     ATMIhandleVec sinkHandles;
 
-    for (auto i = beg; i != end; ++i) {
-      DAGptr dag = *i;
-      makeLazyTasks(dag, srcHandles, sinkHandles);
-    }
+    if (mPrioritize) {
+      makeAndActivatePrioritized(beg, end, sinkHandles);
+    } else {
+      for (auto i = beg; i != end; ++i) {
+        DAGptr dag = *i;
+        if (mReduceEdges) {
+          dag->transitiveReduce();
+        }
+        makeLazyTasks(dag, srcHandles, sinkHandles);
+      }
 
-    impl::activateTasks(srcHandles.begin(), srcHandles.end());
+      impl::activateTasks(srcHandles.begin(), srcHandles.end());
+    }
 
     t0.stop();
 
@@ -160,6 +313,44 @@ inline void makeLazyGpuTasks(DAGptr dag, V1& srcHandles, V2& sinkHandles) {
 
   void execute(DAGptr dag) { executeParallel({dag}); }
 
+  /**
+   * Build an ExecutableDAG from dag, for DAGs that are executed many times.
+   * The DAG is frozen (and reduced, if enabled) as a side effect. Launching
+   * the result skips everything execute() redoes on every call, except
+   * creating the ATMI tasks.
+   */
+  ExecDAG instantiate(DAGptr dag) {
+    cpputils::Timer t0("HIP-ATMI", "ATMI-DAG-Instantiate", true);
+
+    if (mReduceEdges) {
+      dag->transitiveReduce();
+    }
+    dag->freeze();
+
+    ExecDAG g;
+    if (mPrioritize) {
+      dag->computeBottomLevels(mCostModel, mBottomLevels);
+      dag->computePriorityOrder(mBottomLevels, mOrder);
+      g.instantiate(mExec, *dag, mOrder);
+    } else {
+      g.instantiate(mExec, *dag);
+    }
+
+    t0.stop();
+    return g;
+  }
+
+  //! launch an instantiated DAG and wait for it to finish
+  void launch(ExecDAG& g) {
+    cpputils::Timer t0("HIP-ATMI", "ATMI-DAG-Create", true);
+    g.launch();
+    t0.stop();
+
+    cpputils::Timer t1("HIP-ATMI", "ATMI-DAG-Execute", true);
+    g.wait();
+    t1.stop();
+  }
+
   /*
  *TODO: add static and dynamic launch mode
 void execute(void) {
@@ -167,6 +167,8 @@ struct GpuKernelLaunchAtmiPolicy {
 
   static ATMIkernelHandle kernelHandle(const TaskInstance& ti) { return ti.mKernInfo.mKern; }
 
+  static uint64_t kernelKey(const TaskInstance& ti) { return impl::kernelKey(kernelHandle(ti)); }
+
   template <typename... Args>
   static TaskInstance makeTask(const dim3& blocks, const dim3& threadsPerBlock,
                                const KernelInfo& kinfo, Args&&... args) {
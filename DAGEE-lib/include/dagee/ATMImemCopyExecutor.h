@@ -33,9 +33,29 @@ struct NoKernelRegPolicy {
 struct MemCopyTaskLaunchPolicy {
   using TaskInstance = MemCopyInstanceAtmi;
 
+  struct PreparedTask {
+    ATMIcopyParam mCopyParam;
+    void* mDst;
+    const void* mSrc;
+    size_t mSize;
+  };
+
  protected:
   static ATMIcopyParam initCopyParam(const TaskInstance&) { return impl::initCopyParam(); }
 
+  static PreparedTask prepareTask(const TaskInstance& ti, const ATMItaskHandle* predsArr,
+                                  const size_t numPreds) {
+    PreparedTask pt{initCopyParam(ti), ti.mDst, ti.mSrc, ti.mSize};
+    pt.mCopyParam.requires = const_cast<ATMItaskHandle*>(predsArr);
+    pt.mCopyParam.num_required = numPreds;
+    return pt;
+  }
+
+  static ATMItaskHandle makePreparedTask(PreparedTask& pt) {
+    // same caveat as makeInternalTask: the copy is launched right away
+    return atmi_memcpy_async(&pt.mCopyParam, pt.mDst, pt.mSrc, pt.mSize);
+  }
+
   static ATMItaskHandle launchInternalTask(const TaskInstance& ti, const ATMItaskHandle* predsArr,
                                            const size_t numPreds) {
     auto cp = initCopyParam(ti);
@@ -103,6 +103,12 @@ struct AtmiMixedDagExecutor {
 
   void destroyDAG(DAGptr d) { mDAGmgr.destroyDAG(d); }
 
+  //! see DAGmanager::makeDAGfromFile. Needs dagee/DAGserialize.h
+  template <typename C>
+  DAGptr makeDAGfromFile(const char* path, const C& codec) {
+    return mDAGmgr.makeDAGfromFile(path, codec);
+  }
+
   template <typename DAGptrIter>
   void executeParallel(DAGptrIter beg, DAGptrIter end) {
     cpputils::Timer t0("HIP-ATMI", "ATMI-DAG-Create", true);
@@ -0,0 +1,318 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_ATMI_STREAMING_DAG_EXECUTOR_H
+#define DAGEE_INCLUDE_DAGEE_ATMI_STREAMING_DAG_EXECUTOR_H
+
+#include "dagee/ATMIbaseExecutor.h"
+#include "dagee/ATMIcoreDef.h"
+#include "dagee/AllocFactory.h"
+
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+
+namespace dagee {
+
+/**
+ * Executes an unbounded stream of tasks as a live DAG. Producers append nodes
+ * and edges, and a node is launched as soon as it is submitted, with ATMI
+ * tracking its dependencies on the predecessors still in flight. Unlike
+ * ATMIdagExecutor, the DAG never exists as a whole: a node is retired once its
+ * task has completed, and its slot (task instance, launch state and edge
+ * storage) is recycled for a later node. Memory is therefore bounded by the
+ * number of nodes alive at a time, rather than by the total number of tasks.
+ *
+ * Nodes are referred to by NodeHandle, an index tagged with the generation of
+ * its slot, so a handle stays safe to use after its node is retired: an edge
+ * from a retired node is satisfied already and is dropped.
+ *
+ * At most maxInFlight submitted nodes are alive at a time. Submitting beyond
+ * that first retires completed nodes, by polling the state ATMI keeps in each
+ * task's task_info, and blocks on the oldest in-flight task if none has
+ * completed. Edges can only point to nodes that are not submitted yet, and
+ * predecessors must be submitted before their successors.
+ *
+ * Not thread safe: producers on multiple threads must serialize their calls.
+ */
+template <typename ExecT, typename AllocFactory = dagee::StdAllocatorFactory<>>
+class ATMIstreamingDAGexecutor {
+ public:
+  using TaskInstance = typename ExecT::TaskInstance;
+  using Index = uint32_t;
+
+  class NodeHandle {
+    friend class ATMIstreamingDAGexecutor;
+
+    Index mSlot;
+    uint32_t mGen;
+
+    NodeHandle(Index slot, uint32_t gen) noexcept : mSlot(slot), mGen(gen) {}
+
+   public:
+    NodeHandle(void) noexcept : mSlot(INVALID_SLOT), mGen(0) {}
+
+    bool valid(void) const noexcept { return mSlot != INVALID_SLOT; }
+
+    bool operator==(const NodeHandle& that) const noexcept {
+      return mSlot == that.mSlot && mGen == that.mGen;
+    }
+    bool operator!=(const NodeHandle& that) const noexcept { return !(*this == that); }
+  };
+
+  constexpr static const size_t DEFAULT_MAX_IN_FLIGHT = 1024;
+
+ protected:
+  constexpr static const Index INVALID_SLOT = ~Index(0);
+
+  enum class SlotState : uint8_t { FREE, PENDING, IN_FLIGHT };
+
+  using HandleVec = typename AllocFactory::template Vec<NodeHandle>;
+  using ATMIhandleVec = typename AllocFactory::template Vec<ATMItaskHandle>;
+  using IndexVec = typename AllocFactory::template Vec<Index>;
+
+  struct Slot {
+    TaskInstance mTask;
+    //! predecessors added by addEdge, resolved to task handles on submit
+    HandleVec mPreds;
+    ATMItaskHandle mTaskHandle;
+    ATMItaskInfo mInfo;
+    uint32_t mGen = 0;
+    SlotState mState = SlotState::FREE;
+    //! set once waited upon, since ATMI may update mInfo after the wait returns
+    bool mWaited = false;
+
+    explicit Slot(const TaskInstance& ti) : mTask(ti) {}
+  };
+
+  // a deque, so that the task_info and kernel args of a slot never move
+  using SlotDeq = typename AllocFactory::template Deque<Slot>;
+
+  ExecT& mExec;
+  size_t mMaxInFlight;
+  SlotDeq mSlots;
+  IndexVec mFreeSlots;
+  //! submitted nodes not retired yet, in order of submission
+  IndexVec mInFlight;
+  //! scratch space for the requires array of a task
+  ATMIhandleVec mPredHandles;
+  size_t mNumPending = 0;
+  size_t mNumSubmitted = 0;
+  size_t mNumRetired = 0;
+
+  //! @return nullptr if the node was retired
+  Slot* liveSlot(const NodeHandle& n) {
+    assert(n.valid() && n.mSlot < mSlots.size() && "invalid node handle");
+    Slot& s = mSlots[n.mSlot];
+    return (s.mGen == n.mGen && s.mState != SlotState::FREE) ? &s : nullptr;
+  }
+
+  const Slot* liveSlot(const NodeHandle& n) const {
+    return const_cast<ATMIstreamingDAGexecutor*>(this)->liveSlot(n);
+  }
+
+  Index allocSlot(const TaskInstance& ti) {
+    if (mFreeSlots.empty()) {
+      assert(mSlots.size() < INVALID_SLOT && "too many live nodes");
+      mSlots.emplace_back(ti);
+      return static_cast<Index>(mSlots.size() - 1);
+    }
+
+    Index i = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    mSlots[i].mTask = ti;
+    return i;
+  }
+
+  void freeSlot(Index i) {
+    Slot& s = mSlots[i];
+    s.mState = SlotState::FREE;
+    // invalidates all handles to the retired node
+    ++s.mGen;
+    s.mPreds.clear();
+    s.mWaited = false;
+    mFreeSlots.push_back(i);
+    ++mNumRetired;
+  }
+
+  bool isCompleted(const Slot& s) const { return s.mWaited || impl::isTaskCompleted(s.mInfo); }
+
+  void waitOnSlot(Slot& s) {
+    if (!s.mWaited) {
+      impl::waitOnTask(s.mTaskHandle);
+      s.mWaited = true;
+    }
+  }
+
+  //! make room in the window for one more node
+  void throttle(void) {
+    if (mInFlight.size() < mMaxInFlight) {
+      return;
+    }
+
+    if (retireCompleted() == 0) {
+      waitOnSlot(mSlots[mInFlight.front()]);
+      retireCompleted();
+    }
+    assert(mInFlight.size() < mMaxInFlight);
+  }
+
+ public:
+  explicit ATMIstreamingDAGexecutor(ExecT& exec, size_t maxInFlight = DEFAULT_MAX_IN_FLIGHT)
+      : mExec(exec), mMaxInFlight(maxInFlight) {
+    assert(maxInFlight > 0 && "window must hold at least one node");
+  }
+
+  ATMIstreamingDAGexecutor(const ATMIstreamingDAGexecutor&) = delete;
+  ATMIstreamingDAGexecutor& operator=(const ATMIstreamingDAGexecutor&) = delete;
+
+  //! tasks in flight read their args from the slots, so wait for them
+  ~ATMIstreamingDAGexecutor(void) { waitAll(); }
+
+  ExecT& targetExec() noexcept { return mExec; }
+  const ExecT& targetExec() const noexcept { return mExec; }
+
+  //! add a node that runs ti once submitted. Edges to it may be added until then
+  NodeHandle addNode(const TaskInstance& ti) {
+    Index i = allocSlot(ti);
+    Slot& s = mSlots[i];
+    s.mState = SlotState::PENDING;
+    ++mNumPending;
+    return NodeHandle(i, s.mGen);
+  }
+
+  //! dst runs after src. A no-op if src was retired, i.e., has completed already
+  void addEdge(const NodeHandle& src, const NodeHandle& dst) {
+    Slot* d = liveSlot(dst);
+    assert(d && d->mState == SlotState::PENDING && "cannot add an edge to a submitted node");
+    assert(src != dst && "cannot add self edge, i.e., src==dst");
+
+    if (liveSlot(src)) {
+      d->mPreds.push_back(src);
+    }
+  }
+
+  void addFanInEdges(std::initializer_list<NodeHandle> la, const NodeHandle& b) {
+    for (const auto& a : la) {
+      addEdge(a, b);
+    }
+  }
+
+  //! launch the task of n, which runs as soon as its predecessors have completed
+  void submit(const NodeHandle& n) {
+    throttle();
+
+    Slot* s = liveSlot(n);
+    assert(s && s->mState == SlotState::PENDING && "node submitted already");
+
+    mPredHandles.clear();
+    for (const auto& p : s->mPreds) {
+      const Slot* ps = liveSlot(p);
+      if (!ps) {
+        continue; // retired in the meantime
+      }
+      assert(ps->mState == SlotState::IN_FLIGHT && "predecessors must be submitted first");
+      mPredHandles.push_back(ps->mTaskHandle);
+    }
+
+    s->mInfo.state = ATMI_INITIALIZED;
+
+    auto pt = impl::prepareTaskForDag(&mExec, s->mTask, mPredHandles.data(), mPredHandles.size());
+    pt.mLaunchParam.task_info = &s->mInfo;
+    s->mTaskHandle = impl::makePreparedTaskForDag(&mExec, pt);
+    impl::activateTask(s->mTaskHandle);
+
+    s->mState = SlotState::IN_FLIGHT;
+    --mNumPending;
+    ++mNumSubmitted;
+    mInFlight.push_back(n.mSlot);
+  }
+
+  /**
+   * addNode, addEdge from each of preds, and submit, in one go.
+   * @param preds: vector like container of NodeHandle
+   */
+  template <typename V = std::initializer_list<NodeHandle>>
+  NodeHandle addTask(const TaskInstance& ti, const V& preds = V()) {
+    // make room first, so that preds retired by it are dropped below
+    throttle();
+
+    NodeHandle n = addNode(ti);
+    for (const auto& p : preds) {
+      addEdge(p, n);
+    }
+    submit(n);
+    return n;
+  }
+
+  /**
+   * Poll the nodes in flight and retire those completed, recycling their slots.
+   * Non-blocking. Called by submit whenever the window is full.
+   * @return the number of nodes retired
+   */
+  size_t retireCompleted(void) {
+    size_t numRetired = 0;
+    size_t j = 0;
+
+    for (size_t k = 0; k < mInFlight.size(); ++k) {
+      Index i = mInFlight[k];
+      if (isCompleted(mSlots[i])) {
+        freeSlot(i);
+        ++numRetired;
+      } else {
+        mInFlight[j++] = i;
+      }
+    }
+    mInFlight.resize(j);
+
+    return numRetired;
+  }
+
+  //! true once the task of n has completed. Never blocks
+  bool isDone(const NodeHandle& n) const {
+    const Slot* s = liveSlot(n);
+    return !s || (s->mState == SlotState::IN_FLIGHT && isCompleted(*s));
+  }
+
+  //! block until the task of n, which must be submitted, has completed
+  void wait(const NodeHandle& n) {
+    Slot* s = liveSlot(n);
+    if (s) {
+      assert(s->mState == SlotState::IN_FLIGHT && "waiting on a node not submitted");
+      waitOnSlot(*s);
+    }
+  }
+
+  //! block until all submitted tasks have completed, and retire them. Pending nodes stay
+  void waitAll(void) {
+    for (Index i : mInFlight) {
+      waitOnSlot(mSlots[i]);
+    }
+    retireCompleted();
+    assert(mInFlight.empty());
+  }
+
+  size_t maxInFlight(void) const noexcept { return mMaxInFlight; }
+
+  size_t numInFlight(void) const noexcept { return mInFlight.size(); }
+
+  //! nodes added but not submitted yet
+  size_t numPending(void) const noexcept { return mNumPending; }
+
+  size_t numSubmitted(void) const noexcept { return mNumSubmitted; }
+
+  size_t numRetired(void) const noexcept { return mNumRetired; }
+
+  //! slots allocated so far, i.e., the peak number of live nodes
+  size_t numSlots(void) const noexcept { return mSlots.size(); }
+};
+
+template <typename ExecT, typename AllocFactory>
+constexpr size_t ATMIstreamingDAGexecutor<ExecT, AllocFactory>::DEFAULT_MAX_IN_FLIGHT;
+
+template <typename ExecT, typename AllocFactory>
+constexpr typename ATMIstreamingDAGexecutor<ExecT, AllocFactory>::Index
+    ATMIstreamingDAGexecutor<ExecT, AllocFactory>::INVALID_SLOT;
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_ATMI_STREAMING_DAG_EXECUTOR_H
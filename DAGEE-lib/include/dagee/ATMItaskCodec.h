@@ -0,0 +1,193 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_ATMI_TASK_CODEC_H
+#define DAGEE_INCLUDE_DAGEE_ATMI_TASK_CODEC_H
+
+#include "dagee/ATMIcpuExecutor.h"
+#include "dagee/ATMIgpuExecutor.h"
+#include "dagee/DAGserialize.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace dagee {
+
+namespace impl {
+
+/**
+ * Serialized form of a kernel task, followed by uint64_t arg offsets[mNumArgs]
+ * and the packed kernel args, mArgBytes of them
+ */
+struct KernelTaskRecord {
+  uint32_t mKernelId;
+  uint32_t mNumArgs;
+  uint32_t mDims[6];
+  uint64_t mArgBytes;
+};
+
+template <typename TI, typename V>
+void encodeKernelTask(const TI& ti, uint32_t kernelId, const dim3& d0, const dim3& d1, V& out) {
+  KernelTaskRecord r;
+  r.mKernelId = kernelId;
+  r.mNumArgs = static_cast<uint32_t>(ti.mKernArgOffsets.size());
+  r.mDims[0] = d0.x;
+  r.mDims[1] = d0.y;
+  r.mDims[2] = d0.z;
+  r.mDims[3] = d1.x;
+  r.mDims[4] = d1.y;
+  r.mDims[5] = d1.z;
+  r.mArgBytes = ti.mKernArgs.size();
+
+  appendBytes(out, &r, sizeof(r));
+  for (size_t off : ti.mKernArgOffsets) {
+    uint64_t o = off;
+    appendBytes(out, &o, sizeof(o));
+  }
+  appendBytes(out, ti.mKernArgs.data(), ti.mKernArgs.size());
+}
+
+/**
+ * Whether the payload holds a record of a kernel in a table of numKernels,
+ * with as many bytes as the record says, and arg offsets within the args
+ */
+inline bool validKernelTask(const uint8_t* bytes, size_t size, size_t numKernels) {
+  KernelTaskRecord r;
+  if (size < sizeof(r)) {
+    return false;
+  }
+  std::memcpy(&r, bytes, sizeof(r));
+
+  const size_t rest = size - sizeof(r);
+  if (r.mKernelId >= numKernels || r.mNumArgs > rest / sizeof(uint64_t) ||
+      r.mArgBytes != rest - r.mNumArgs * sizeof(uint64_t)) {
+    return false;
+  }
+
+  const uint8_t* p = bytes + sizeof(r);
+  for (uint32_t a = 0; a < r.mNumArgs; ++a) {
+    uint64_t o;
+    std::memcpy(&o, p + a * sizeof(o), sizeof(o));
+    if (o >= r.mArgBytes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline KernelTaskRecord decodeKernelTaskRecord(const uint8_t* bytes, size_t size) {
+  KernelTaskRecord r;
+  assert(size >= sizeof(r) && "payload too small");
+  std::memcpy(&r, bytes, sizeof(r));
+  assert(size == sizeof(r) + r.mNumArgs * sizeof(uint64_t) + r.mArgBytes &&
+         "payload size doesn't match");
+  (void)size;
+  return r;
+}
+
+template <typename TI>
+void decodeKernelArgs(TI& ti, const KernelTaskRecord& r, const uint8_t* bytes) {
+  const uint8_t* p = bytes + sizeof(r);
+
+  ti.mKernArgOffsets.resize(r.mNumArgs);
+  for (uint32_t a = 0; a < r.mNumArgs; ++a) {
+    uint64_t o;
+    std::memcpy(&o, p, sizeof(o));
+    ti.mKernArgOffsets[a] = o;
+    p += sizeof(o);
+  }
+  ti.mKernArgs.assign(p, p + r.mArgBytes);
+}
+
+} // end namespace impl
+
+/**
+ * Value codecs (see TrivialCodec) for the task instances of the ATMI GPU and
+ * CPU executors. Kernel handles (or functions) differ from run to run, so a
+ * task stores the position of its kernel in a kernel table instead; the same
+ * table, with the kernels registered anew, must be given when loading. Kernel
+ * args are stored as packed bytes, hence pointer args must either stay valid
+ * (e.g. fixed device allocations) or be set again after loading, e.g., with
+ * ExecutableDAG::setArg.
+ */
+template <typename AllocFactory = dagee::StdAllocatorFactory<> >
+class GpuTaskCodec {
+ public:
+  using value_type = ATMIgpuKernelInstance<AllocFactory>;
+
+ protected:
+  std::vector<ATMIgpuKernelInfo> mKernels;
+  std::unordered_map<uint64_t, uint32_t> mIdOfKernel;
+
+ public:
+  explicit GpuTaskCodec(const std::vector<ATMIgpuKernelInfo>& kernels) : mKernels(kernels) {
+    for (uint32_t k = 0; k < mKernels.size(); ++k) {
+      mIdOfKernel.emplace(impl::kernelKey(mKernels[k].mKern), k);
+    }
+  }
+
+  bool valid(const uint8_t* bytes, size_t size) const {
+    return impl::validKernelTask(bytes, size, mKernels.size());
+  }
+
+  template <typename V>
+  void encode(const value_type& ti, V& out) const {
+    auto it = mIdOfKernel.find(impl::kernelKey(ti.mKernInfo.mKern));
+    assert(it != mIdOfKernel.cend() && "kernel of the task is missing from the kernel table");
+    impl::encodeKernelTask(ti, it->second, ti.mBlocks, ti.mThreadsPerBlock, out);
+  }
+
+  value_type decode(const uint8_t* bytes, size_t size) const {
+    const auto r = impl::decodeKernelTaskRecord(bytes, size);
+    assert(r.mKernelId < mKernels.size() && "kernel id out of range");
+
+    value_type ti(dim3(r.mDims[0], r.mDims[1], r.mDims[2]),
+                  dim3(r.mDims[3], r.mDims[4], r.mDims[5]), mKernels[r.mKernelId]);
+    impl::decodeKernelArgs(ti, r, bytes);
+    return ti;
+  }
+};
+
+template <typename AllocFactory = dagee::StdAllocatorFactory<> >
+class CpuTaskCodec {
+ public:
+  using value_type = ATMIcpuKernelInstance<AllocFactory>;
+
+ protected:
+  std::vector<ATMIcpuKernelInfo> mKernels;
+  std::unordered_map<GenericFuncPtr, uint32_t> mIdOfKernel;
+
+ public:
+  //! kernels are told apart by their function, see CpuKernelLaunchAtmiPolicy::kernelKey
+  explicit CpuTaskCodec(const std::vector<ATMIcpuKernelInfo>& kernels) : mKernels(kernels) {
+    for (uint32_t k = 0; k < mKernels.size(); ++k) {
+      mIdOfKernel.emplace(mKernels[k].mFuncPtr, k);
+    }
+  }
+
+  bool valid(const uint8_t* bytes, size_t size) const {
+    return impl::validKernelTask(bytes, size, mKernels.size());
+  }
+
+  template <typename V>
+  void encode(const value_type& ti, V& out) const {
+    auto it = mIdOfKernel.find(ti.mCpuKernelInfo.mFuncPtr);
+    assert(it != mIdOfKernel.cend() && "kernel of the task is missing from the kernel table");
+    impl::encodeKernelTask(ti, it->second, ti.mThreads, dim3(1, 1, 1), out);
+  }
+
+  value_type decode(const uint8_t* bytes, size_t size) const {
+    const auto r = impl::decodeKernelTaskRecord(bytes, size);
+    assert(r.mKernelId < mKernels.size() && "kernel id out of range");
+
+    value_type ti(dim3(r.mDims[0], r.mDims[1], r.mDims[2]), mKernels[r.mKernelId]);
+    impl::decodeKernelArgs(ti, r, bytes);
+    return ti;
+  }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_ATMI_TASK_CODEC_H
@@ -0,0 +1,264 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_ADJACENCY_LIST_H
+#define DAGEE_INCLUDE_DAGEE_ADJACENCY_LIST_H
+
+#include "dagee/AllocFactory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+namespace dagee {
+
+namespace impl {
+
+//! hashing and empty-slot sentinel for the neighbor index, for pointers and integer ids
+template <typename T, typename Enable = void>
+struct AdjKeyTraits;
+
+template <typename T>
+struct AdjKeyTraits<T*> {
+  static T* empty(void) noexcept { return nullptr; }
+  static uint64_t hash(T* p) noexcept { return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p)); }
+};
+
+template <typename T>
+struct AdjKeyTraits<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+  static T empty(void) noexcept { return std::numeric_limits<T>::max(); }
+  static uint64_t hash(T x) noexcept { return static_cast<uint64_t>(x); }
+};
+
+} // end namespace impl
+
+/**
+ * Adjacency list of a DAG node. Elements are kept in insertion order in an
+ * AllocFactory::AdjVec. Once the degree exceeds INDEX_THRESHOLD, a hashed
+ * index of the neighbors (open addressing, linear probing) is built on the side
+ * and kept up to date, so contains() is O(1) instead of O(degree) for high
+ * fan-in/fan-out nodes. Low-degree nodes pay only for two extra words.
+ */
+template <typename T, typename AllocFactory, size_t INDEX_THRESHOLD = 32>
+class AdjacencyList {
+  using List = typename AllocFactory::template AdjVec<T>;
+  using KeyTraits = impl::AdjKeyTraits<T>;
+  using SlotAlloc = typename std::allocator_traits<typename List::allocator_type>::template rebind_alloc<T>;
+  using SlotAllocTraits = std::allocator_traits<SlotAlloc>;
+
+ public:
+  using value_type = T;
+  using allocator_type = typename List::allocator_type;
+  using iterator = typename List::iterator;
+  using const_iterator = typename List::const_iterator;
+
+ private:
+  List mList;
+  //! hash index of the elements of mList, null while the degree is at or below INDEX_THRESHOLD
+  T* mSlots = nullptr;
+  uint32_t mSlotCap = 0;
+
+  static uint64_t hashOf(const T& x) noexcept {
+    // Fibonacci hashing, mixes the (often aligned) low bits of pointers
+    return KeyTraits::hash(x) * 0x9E3779B97F4A7C15ull;
+  }
+
+  size_t slotOf(const T& x) const noexcept {
+    return static_cast<size_t>(hashOf(x) >> 32) & (mSlotCap - 1);
+  }
+
+  void insertIndex(const T& x) noexcept {
+    size_t i = slotOf(x);
+    while (mSlots[i] != KeyTraits::empty()) {
+      i = (i + 1) & (mSlotCap - 1);
+    }
+    mSlots[i] = x;
+  }
+
+  void rebuildIndex(size_t minElems) {
+    freeIndex();
+
+    // power of 2, at most half full
+    size_t cap = 16;
+    while (cap < 2 * minElems) {
+      cap *= 2;
+    }
+
+    SlotAlloc a(mList.get_allocator());
+    mSlots = SlotAllocTraits::allocate(a, cap);
+    mSlotCap = static_cast<uint32_t>(cap);
+    std::fill(mSlots, mSlots + cap, KeyTraits::empty());
+
+    for (const T& x : mList) {
+      insertIndex(x);
+    }
+  }
+
+  void freeIndex(void) noexcept {
+    if (mSlots) {
+      SlotAlloc a(mList.get_allocator());
+      SlotAllocTraits::deallocate(a, mSlots, mSlotCap);
+      mSlots = nullptr;
+      mSlotCap = 0;
+    }
+  }
+
+  bool findIndex(const T& x) const noexcept {
+    size_t i = slotOf(x);
+    while (mSlots[i] != KeyTraits::empty()) {
+      if (mSlots[i] == x) {
+        return true;
+      }
+      i = (i + 1) & (mSlotCap - 1);
+    }
+    return false;
+  }
+
+  //! backward-shift deletion, keeps probe sequences intact without tombstones
+  void eraseIndex(const T& x) noexcept {
+    const size_t mask = mSlotCap - 1;
+    size_t i = slotOf(x);
+    while (mSlots[i] != x) {
+      assert(mSlots[i] != KeyTraits::empty() && "element missing from the index");
+      i = (i + 1) & mask;
+    }
+
+    size_t j = i;
+    while (true) {
+      j = (j + 1) & mask;
+      if (mSlots[j] == KeyTraits::empty()) {
+        break;
+      }
+      size_t home = slotOf(mSlots[j]);
+      // move mSlots[j] into the hole at i unless its home lies cyclically in (i, j]
+      bool homeInRange = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+      if (!homeInRange) {
+        mSlots[i] = mSlots[j];
+        i = j;
+      }
+    }
+    mSlots[i] = KeyTraits::empty();
+  }
+
+ public:
+  explicit AdjacencyList(const allocator_type& a = allocator_type()) : mList(a) {}
+
+  AdjacencyList(const AdjacencyList& that) : mList(that.mList) {
+    if (that.mSlots) {
+      rebuildIndex(mList.size());
+    }
+  }
+
+  AdjacencyList(AdjacencyList&& that) noexcept
+      : mList(std::move(that.mList)), mSlots(that.mSlots), mSlotCap(that.mSlotCap) {
+    that.mSlots = nullptr;
+    that.mSlotCap = 0;
+  }
+
+  AdjacencyList& operator=(const AdjacencyList& that) {
+    if (this != &that) {
+      freeIndex();
+      mList = that.mList;
+      if (that.mSlots) {
+        rebuildIndex(mList.size());
+      }
+    }
+    return *this;
+  }
+
+  AdjacencyList& operator=(AdjacencyList&& that) {
+    if (this != &that) {
+      freeIndex();
+      mList = std::move(that.mList);
+      if (that.mSlots) {
+        that.freeIndex();
+        rebuildIndex(mList.size());
+      }
+    }
+    return *this;
+  }
+
+  ~AdjacencyList(void) { freeIndex(); }
+
+  allocator_type get_allocator(void) const { return mList.get_allocator(); }
+
+  iterator begin(void) noexcept { return mList.begin(); }
+  iterator end(void) noexcept { return mList.end(); }
+  const_iterator begin(void) const noexcept { return mList.begin(); }
+  const_iterator end(void) const noexcept { return mList.end(); }
+  const_iterator cbegin(void) const noexcept { return mList.cbegin(); }
+  const_iterator cend(void) const noexcept { return mList.cend(); }
+
+  const T* data(void) const noexcept { return mList.data(); }
+  size_t size(void) const noexcept { return mList.size(); }
+  bool empty(void) const noexcept { return mList.empty(); }
+  const T& operator[](size_t i) const noexcept { return mList[i]; }
+
+  bool isIndexed(void) const noexcept { return mSlots != nullptr; }
+
+  void reserve(size_t n) {
+    mList.reserve(n);
+    if (n > INDEX_THRESHOLD && (!mSlots || 2 * n > mSlotCap)) {
+      rebuildIndex(n);
+    }
+  }
+
+  void push_back(const T& x) {
+    assert(x != KeyTraits::empty() && "sentinel value can't be stored");
+    mList.push_back(x);
+
+    if (mSlots) {
+      if (2 * mList.size() > mSlotCap) {
+        rebuildIndex(mList.size());
+      } else {
+        insertIndex(x);
+      }
+    } else if (mList.size() > INDEX_THRESHOLD) {
+      rebuildIndex(mList.size());
+    }
+  }
+
+  bool contains(const T& x) const {
+    if (mSlots) {
+      return findIndex(x);
+    }
+    return std::find(mList.cbegin(), mList.cend(), x) != mList.cend();
+  }
+
+  //! remove x if present, preserving the order of the rest. @return true if removed
+  bool remove(const T& x) {
+    auto i = std::find(mList.cbegin(), mList.cend(), x);
+    if (i == mList.cend()) {
+      return false;
+    }
+    if (mSlots) {
+      eraseIndex(x);
+    }
+    mList.erase(i);
+    return true;
+  }
+
+  void clear(void) {
+    mList.clear();
+    freeIndex();
+  }
+
+  void swap(AdjacencyList& that) {
+    // indices are rebuilt because their memory belongs to the allocator of each list
+    freeIndex();
+    that.freeIndex();
+    mList.swap(that.mList);
+    if (size() > INDEX_THRESHOLD) {
+      rebuildIndex(size());
+    }
+    if (that.size() > INDEX_THRESHOLD) {
+      that.rebuildIndex(that.size());
+    }
+  }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_ADJACENCY_LIST_H
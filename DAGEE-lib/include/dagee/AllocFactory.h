@@ -3,6 +3,8 @@
 #ifndef DAGEE_INCLUDE_DAGEE_ALLOC_FACTORY_H
 #define DAGEE_INCLUDE_DAGEE_ALLOC_FACTORY_H
 
+#include "dagee/SmallVec.h"
+
 #include <deque>
 #include <memory>
 #include <string>
@@ -57,8 +59,32 @@ namespace dagee {
 using Byte = uint8_t;
 using BytePtr = uint8_t*;
 
+/**
+ * Every DAG owns an AllocFactory::Arena, a memory resource that its containers
+ * draw from (see ArenaAllocFactory.h). Factories that allocate from the global
+ * heap use this empty placeholder
+ */
+struct NoArena {
+  void reset(void) noexcept {}
+  void release(void) noexcept {}
+};
+
+//! placeholder for AllocFactory::ArenaScope, see MonotonicArena::Scope
+struct NoArenaScope {
+  explicit NoArenaScope(NoArena&) noexcept {}
+};
+
 template <typename __UNUSED = void>
 struct StdAllocatorFactory {
+  using Arena = NoArena;
+  using ArenaScope = NoArenaScope;
+
+  //! objects must be destroyed one by one
+  constexpr static const bool RELEASES_IN_BULK = false;
+
+  //! allocators may be used from several threads at once
+  constexpr static const bool THREAD_SAFE = true;
+
   template <typename T>
   using FixedSizeAlloc = std::allocator<T>;
 
@@ -68,6 +94,10 @@ struct StdAllocatorFactory {
   template <typename T>
   using Vec = std::vector<T, VarSizeAlloc<T> >;
 
+  //! adjacency lists of DAG nodes, low-degree nodes need no allocation
+  template <typename T>
+  using AdjVec = SmallVec<T, AdjInlineCapacity<T>::value, VarSizeAlloc<T> >;
+
   using Str = std::basic_string<char, std::char_traits<char>, VarSizeAlloc<char> >;
 
   template <typename T>
@@ -83,20 +113,40 @@ struct StdAllocatorFactory {
     return FixedSizeAlloc<T>();
   }
 
+  template <typename T>
+  static FixedSizeAlloc<T> makeFixedSizeAlloc(Arena&) {
+    return FixedSizeAlloc<T>();
+  }
+
   template <typename T>
   static VarSizeAlloc<T> makeVarSizeAlloc(void) {
     return VarSizeAlloc<T>();
   }
 
+  template <typename T>
+  static VarSizeAlloc<T> makeVarSizeAlloc(Arena&) {
+    return VarSizeAlloc<T>();
+  }
+
   template <typename T>
   static Vec<T> makeVec(void) {
     return Vec<T>(makeVarSizeAlloc<T>());
   }
 
+  template <typename T>
+  static Vec<T> makeVec(Arena&) {
+    return Vec<T>(makeVarSizeAlloc<T>());
+  }
+
   template <typename T>
   static Deque<T> makeDeque(void) {
     return Deque<T>(makeVarSizeAlloc<T>());
   }
+
+  template <typename T>
+  static Deque<T> makeDeque(Arena&) {
+    return Deque<T>(makeVarSizeAlloc<T>());
+  }
 };
 
 template <typename A>
@@ -105,6 +155,16 @@ using AllocTraits = std::allocator_traits<A>;
 template <typename A, typename T>
 using RebindAlloc = typename dagee::AllocTraits<A>::template rebind_alloc<T>::type;
 
+/**
+ * Drop the buffer of a container, not just its contents. Needed before the
+ * arena backing the buffer is reset or released
+ */
+template <typename C>
+void releaseStorage(C& c) {
+  C empty(c.get_allocator());
+  c.swap(empty);
+}
+
 } // end namespace dagee
 
 #endif // DAGEE_INCLUDE_DAGEE_ALLOC_FACTORY_H
@@ -0,0 +1,406 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_ARENA_ALLOC_FACTORY_H
+#define DAGEE_INCLUDE_DAGEE_ARENA_ALLOC_FACTORY_H
+
+#include "dagee/AllocFactory.h"
+#include "dagee/SmallVec.h"
+
+#include <sys/mman.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dagee {
+
+/**
+ * Monotonic (bump-pointer) memory arena built on mmap'ed chunks.
+ *
+ * - Variable size allocations are carved out of the current chunk. Freeing
+ *   memory is a no-op, except that freeing the most recent allocation rolls the
+ *   bump pointer back.
+ * - Fixed size allocations (one object at a time, e.g. DAG nodes) are served
+ *   from per-size-class free lists first, so destroyed objects are recycled.
+ * - release() unmaps all chunks, reset() keeps the largest one for reuse. Both
+ *   are O(number of chunks).
+ *
+ * Chunk sizes grow geometrically, so building a large DAG needs only a handful
+ * of mmap calls. Not thread-safe: an arena is meant to be owned by a single DAG
+ * that is built by a single thread.
+ */
+class MonotonicArena {
+  struct ChunkHeader {
+    ChunkHeader* mNext;
+    size_t mSize;
+  };
+
+  struct FreeBlock {
+    FreeBlock* mNext;
+  };
+
+ public:
+  constexpr static const size_t MIN_ALIGN = alignof(std::max_align_t);
+  constexpr static const size_t SIZE_CLASS_GRAIN = 16;
+  constexpr static const size_t NUM_SIZE_CLASSES = 64;
+  constexpr static const size_t MAX_CLASS_SIZE = SIZE_CLASS_GRAIN * NUM_SIZE_CLASSES;
+  constexpr static const size_t MAX_CHUNK_SIZE = size_t(1) << 28;
+
+ private:
+  size_t mMinChunkSize;
+  size_t mNextChunkSize;
+  ChunkHeader* mChunks = nullptr;
+  uint8_t* mBump = nullptr;
+  uint8_t* mEnd = nullptr;
+  uint8_t* mLastAlloc = nullptr;
+  FreeBlock* mFreeLists[NUM_SIZE_CLASSES] = {};
+
+  static MonotonicArena*& currentRef(void) {
+    static thread_local MonotonicArena* cur = nullptr;
+    return cur;
+  }
+
+  static size_t alignUp(size_t x, size_t a) { return (x + a - 1) & ~(a - 1); }
+
+  static size_t sizeClass(size_t bytes) { return (bytes + SIZE_CLASS_GRAIN - 1) / SIZE_CLASS_GRAIN; }
+
+  void addChunk(size_t minBytes) {
+    size_t sz = mNextChunkSize;
+    size_t needed = alignUp(sizeof(ChunkHeader), MIN_ALIGN) + minBytes;
+    while (sz < needed) {
+      sz *= 2;
+    }
+
+    void* mem = ::mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      std::abort();
+    }
+
+    ChunkHeader* c = static_cast<ChunkHeader*>(mem);
+    c->mNext = mChunks;
+    c->mSize = sz;
+    mChunks = c;
+
+    mBump = static_cast<uint8_t*>(mem) + alignUp(sizeof(ChunkHeader), MIN_ALIGN);
+    mEnd = static_cast<uint8_t*>(mem) + sz;
+    mLastAlloc = nullptr;
+
+    if (mNextChunkSize < MAX_CHUNK_SIZE) {
+      mNextChunkSize *= 2;
+    }
+  }
+
+  void resetFreeLists(void) {
+    for (auto& f : mFreeLists) {
+      f = nullptr;
+    }
+  }
+
+ public:
+  explicit MonotonicArena(size_t minChunkSize = size_t(1) << 20)
+      : mMinChunkSize(minChunkSize), mNextChunkSize(minChunkSize) {}
+
+  MonotonicArena(const MonotonicArena&) = delete;
+  MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+  ~MonotonicArena(void) { release(); }
+
+  //! arena used by default-constructed arena allocators on this thread, may be null
+  static MonotonicArena* current(void) noexcept { return currentRef(); }
+
+  void* allocate(size_t bytes, size_t align = MIN_ALIGN) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(alignUp(reinterpret_cast<uintptr_t>(mBump), align));
+    if (!mBump || p + bytes > mEnd) {
+      addChunk(bytes + align);
+      p = reinterpret_cast<uint8_t*>(alignUp(reinterpret_cast<uintptr_t>(mBump), align));
+    }
+    mBump = p + bytes;
+    mLastAlloc = p;
+    return p;
+  }
+
+  void deallocate(void* ptr, size_t bytes) noexcept {
+    uint8_t* p = static_cast<uint8_t*>(ptr);
+    if (p == mLastAlloc && p + bytes == mBump) {
+      mBump = p;
+      mLastAlloc = nullptr;
+    }
+  }
+
+  void* allocateFixed(size_t bytes, size_t align) {
+    if (bytes > MAX_CLASS_SIZE || align > MIN_ALIGN) {
+      return allocate(bytes, align);
+    }
+
+    const size_t c = sizeClass(bytes);
+    FreeBlock*& head = mFreeLists[c - 1];
+    if (head) {
+      FreeBlock* b = head;
+      head = b->mNext;
+      return b;
+    }
+    return allocate(c * SIZE_CLASS_GRAIN, MIN_ALIGN);
+  }
+
+  void deallocateFixed(void* ptr, size_t bytes, size_t align) noexcept {
+    if (bytes > MAX_CLASS_SIZE || align > MIN_ALIGN) {
+      deallocate(ptr, bytes);
+      return;
+    }
+
+    FreeBlock*& head = mFreeLists[sizeClass(bytes) - 1];
+    FreeBlock* b = static_cast<FreeBlock*>(ptr);
+    b->mNext = head;
+    head = b;
+  }
+
+  //! unmap all chunks. All memory handed out by this arena becomes invalid
+  void release(void) noexcept {
+    ChunkHeader* c = mChunks;
+    while (c) {
+      ChunkHeader* next = c->mNext;
+      ::munmap(c, c->mSize);
+      c = next;
+    }
+    mChunks = nullptr;
+    mBump = mEnd = mLastAlloc = nullptr;
+    mNextChunkSize = mMinChunkSize;
+    resetFreeLists();
+  }
+
+  //! like release() but keeps the most recent (and largest) chunk for reuse
+  void reset(void) noexcept {
+    if (!mChunks) {
+      return;
+    }
+
+    ChunkHeader* keep = mChunks;
+    mChunks = keep->mNext;
+    release();
+
+    keep->mNext = nullptr;
+    mChunks = keep;
+    mBump = reinterpret_cast<uint8_t*>(keep) + alignUp(sizeof(ChunkHeader), MIN_ALIGN);
+    mEnd = reinterpret_cast<uint8_t*>(keep) + keep->mSize;
+    mNextChunkSize = keep->mSize < MAX_CHUNK_SIZE ? 2 * keep->mSize : keep->mSize;
+  }
+
+  size_t numChunks(void) const noexcept {
+    size_t n = 0;
+    for (ChunkHeader* c = mChunks; c; c = c->mNext) {
+      ++n;
+    }
+    return n;
+  }
+
+  /**
+   * RAII guard that makes an arena the default for arena allocators that are
+   * default-constructed within its scope (e.g. adjacency lists of a node being
+   * constructed). Guards nest.
+   */
+  class Scope {
+    MonotonicArena* mPrev;
+
+   public:
+    explicit Scope(MonotonicArena& a) noexcept : mPrev(currentRef()) { currentRef() = &a; }
+    ~Scope(void) noexcept { currentRef() = mPrev; }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+};
+
+namespace impl {
+
+template <typename T>
+struct ArenaAllocBase {
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  //! null means no arena was in scope at construction, fall back to the global heap
+  MonotonicArena* mArena;
+
+  ArenaAllocBase(void) noexcept : mArena(MonotonicArena::current()) {}
+  explicit ArenaAllocBase(MonotonicArena& a) noexcept : mArena(&a) {}
+  explicit ArenaAllocBase(MonotonicArena* a) noexcept : mArena(a) {}
+};
+
+} // end namespace impl
+
+//! variable size allocator over a MonotonicArena
+template <typename T>
+struct ArenaAllocator : public impl::ArenaAllocBase<T> {
+  using Base = impl::ArenaAllocBase<T>;
+  using Base::Base;
+
+  ArenaAllocator(void) noexcept : Base() {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& that) noexcept : Base(that.mArena) {}
+
+  T* allocate(size_t n) {
+    if (!Base::mArena) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(Base::mArena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    if (!Base::mArena) {
+      ::operator delete(p);
+      return;
+    }
+    Base::mArena->deallocate(p, n * sizeof(T));
+  }
+};
+
+//! fixed size (slab) allocator over a MonotonicArena, recycles freed objects
+template <typename T>
+struct ArenaSlabAllocator : public impl::ArenaAllocBase<T> {
+  using Base = impl::ArenaAllocBase<T>;
+  using Base::Base;
+
+  ArenaSlabAllocator(void) noexcept : Base() {}
+
+  template <typename U>
+  ArenaSlabAllocator(const ArenaSlabAllocator<U>& that) noexcept : Base(that.mArena) {}
+
+  T* allocate(size_t n) {
+    if (!Base::mArena) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    if (n == 1) {
+      return static_cast<T*>(Base::mArena->allocateFixed(sizeof(T), alignof(T)));
+    }
+    return static_cast<T*>(Base::mArena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    if (!Base::mArena) {
+      ::operator delete(p);
+      return;
+    }
+    if (n == 1) {
+      Base::mArena->deallocateFixed(p, sizeof(T), alignof(T));
+    } else {
+      Base::mArena->deallocate(p, n * sizeof(T));
+    }
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+  return a.mArena == b.mArena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+  return !(a == b);
+}
+
+template <typename T, typename U>
+bool operator==(const ArenaSlabAllocator<T>& a, const ArenaSlabAllocator<U>& b) noexcept {
+  return a.mArena == b.mArena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaSlabAllocator<T>& a, const ArenaSlabAllocator<U>& b) noexcept {
+  return !(a == b);
+}
+
+/**
+ * AllocFactory whose allocators draw from a MonotonicArena. Every DAG (and
+ * DAGmanager) owns an Arena; containers owned by the DAG are bound to it and
+ * everything is returned to the OS at once when the DAG is cleared or destroyed.
+ * Containers created outside of any arena, e.g. temporaries in executors, fall
+ * back to the global heap.
+ *
+ * @param CHUNK_SIZE: size of the first chunk in bytes, later chunks grow geometrically
+ */
+template <size_t CHUNK_SIZE = (size_t(1) << 20)>
+struct ArenaAllocatorFactory {
+  struct Arena : public MonotonicArena {
+    Arena(void) : MonotonicArena(CHUNK_SIZE) {}
+  };
+
+  using ArenaScope = MonotonicArena::Scope;
+
+  //! destroying all objects in an Arena individually is unnecessary, see DAGbase::clear()
+  constexpr static const bool RELEASES_IN_BULK = true;
+
+  //! an Arena is not synchronized, see ConcurrentDAGbuilder
+  constexpr static const bool THREAD_SAFE = false;
+
+  template <typename T>
+  using FixedSizeAlloc = ArenaSlabAllocator<T>;
+
+  template <typename T>
+  using VarSizeAlloc = ArenaAllocator<T>;
+
+  template <typename T>
+  using Vec = std::vector<T, VarSizeAlloc<T> >;
+
+  //! adjacency lists of DAG nodes, low-degree nodes need no allocation
+  template <typename T>
+  using AdjVec = SmallVec<T, AdjInlineCapacity<T>::value, VarSizeAlloc<T> >;
+
+  using Str = std::basic_string<char, std::char_traits<char>, VarSizeAlloc<char> >;
+
+  template <typename T>
+  using Deque = std::deque<T, VarSizeAlloc<T> >;
+
+  template <typename K, typename V, typename H = std::hash<K>, typename EQ = std::equal_to<K> >
+  using HashMap = std::unordered_map<K, V, H, EQ, VarSizeAlloc<std::pair<const K, V> > >;
+
+  template <typename T>
+  static FixedSizeAlloc<T> makeFixedSizeAlloc(void) {
+    return FixedSizeAlloc<T>();
+  }
+
+  template <typename T>
+  static FixedSizeAlloc<T> makeFixedSizeAlloc(Arena& a) {
+    return FixedSizeAlloc<T>(a);
+  }
+
+  template <typename T>
+  static VarSizeAlloc<T> makeVarSizeAlloc(void) {
+    return VarSizeAlloc<T>();
+  }
+
+  template <typename T>
+  static VarSizeAlloc<T> makeVarSizeAlloc(Arena& a) {
+    return VarSizeAlloc<T>(a);
+  }
+
+  template <typename T>
+  static Vec<T> makeVec(void) {
+    return Vec<T>(makeVarSizeAlloc<T>());
+  }
+
+  template <typename T>
+  static Vec<T> makeVec(Arena& a) {
+    return Vec<T>(makeVarSizeAlloc<T>(a));
+  }
+
+  template <typename T>
+  static Deque<T> makeDeque(void) {
+    return Deque<T>(makeVarSizeAlloc<T>());
+  }
+
+  template <typename T>
+  static Deque<T> makeDeque(Arena& a) {
+    return Deque<T>(makeVarSizeAlloc<T>(a));
+  }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_ARENA_ALLOC_FACTORY_H
@@ -0,0 +1,169 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_CHAIN_FUSION_H
+#define DAGEE_INCLUDE_DAGEE_CHAIN_FUSION_H
+
+#include "dagee/FrozenDAG.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace dagee {
+
+/**
+ * Decomposition of a DAG into maximal chains: a node b joins the chain of a if
+ * b is the only successor of a, a is the only predecessor of b, and
+ * canFuse(a, b) allows it, e.g., both run on the same executor. Every node is in
+ * exactly one chain, so a chain of length one is just a node.
+ *
+ * A chain can be submitted as one macro-task, i.e., as an in-order sequence of
+ * launches that needs a dependency signal only at its end. Its head waits for
+ * the predecessors of the chain and its tail releases the successors.
+ *
+ * Chains are stored in topological order of their heads, each as a contiguous
+ * run of nodes in chain order. Built from a FrozenDAG and cached by
+ * DAGbase::computeChains().
+ */
+template <typename NodePtr_tp, typename AllocFactory>
+class DAGchains {
+ public:
+  using NodePtr = NodePtr_tp;
+  using Frozen = FrozenDAG<NodePtr, AllocFactory>;
+  using Index = typename Frozen::Index;
+  using IndexVec = typename Frozen::IndexVec;
+  using NodeVec = typename Frozen::NodeVec;
+
+  class Chain {
+    const NodePtr* mBeg;
+    const NodePtr* mEnd;
+
+   public:
+    Chain(const NodePtr* beg, const NodePtr* end) noexcept : mBeg(beg), mEnd(end) {}
+
+    const NodePtr* begin(void) const noexcept { return mBeg; }
+    const NodePtr* end(void) const noexcept { return mEnd; }
+    size_t size(void) const noexcept { return mEnd - mBeg; }
+    NodePtr head(void) const noexcept { return *mBeg; }
+    NodePtr tail(void) const noexcept { return *(mEnd - 1); }
+  };
+
+ protected:
+  bool mValid = false;
+  //! chain of each node, by frozen index
+  IndexVec mChainOf;
+  //! position of each node in mNodes, by frozen index
+  IndexVec mPosOf;
+  IndexVec mOffsets;
+  NodeVec mNodes;
+
+ public:
+  DAGchains(void) = default;
+
+  template <typename A>
+  explicit DAGchains(A& arena)
+      : mChainOf(AllocFactory::template makeVec<Index>(arena)),
+        mPosOf(AllocFactory::template makeVec<Index>(arena)),
+        mOffsets(AllocFactory::template makeVec<Index>(arena)),
+        mNodes(AllocFactory::template makeVec<NodePtr>(arena)) {}
+
+  /**
+   * @param canFuse: canFuse(Index a, Index b) for an edge a->b that could
+   * otherwise be fused
+   */
+  template <typename F>
+  void build(const Frozen& fz, const F& canFuse) {
+    clear();
+    const Index N = fz.size();
+    const Index UNASSIGNED = Frozen::INVALID_INDEX;
+
+    mChainOf.assign(N, UNASSIGNED);
+    mPosOf.assign(N, 0);
+    mNodes.reserve(N);
+
+    auto fusesWithNext = [&fz, &canFuse](Index a, Index& b) {
+      if (fz.numSuccs(a) != 1) {
+        return false;
+      }
+      b = *fz.successors(a).begin();
+      return fz.numPreds(b) == 1 && canFuse(a, b);
+    };
+
+    for (Index i : fz.topoOrder()) {
+      if (mChainOf[i] != UNASSIGNED) {
+        continue; // already in the chain of its predecessor
+      }
+
+      const Index c = static_cast<Index>(mOffsets.size());
+      mOffsets.emplace_back(static_cast<Index>(mNodes.size()));
+
+      Index cur = i;
+      while (true) {
+        mChainOf[cur] = c;
+        mPosOf[cur] = static_cast<Index>(mNodes.size());
+        mNodes.emplace_back(fz.node(cur));
+
+        Index next = UNASSIGNED;
+        if (!fusesWithNext(cur, next)) {
+          break;
+        }
+        cur = next;
+      }
+    }
+    mOffsets.emplace_back(static_cast<Index>(mNodes.size()));
+
+    mValid = true;
+  }
+
+  void build(const Frozen& fz) {
+    build(fz, [](Index, Index) { return true; });
+  }
+
+  void clear(void) {
+    mValid = false;
+    mChainOf.clear();
+    mPosOf.clear();
+    mOffsets.clear();
+    mNodes.clear();
+  }
+
+  void releaseStorage(void) {
+    clear();
+    dagee::releaseStorage(mChainOf);
+    dagee::releaseStorage(mPosOf);
+    dagee::releaseStorage(mOffsets);
+    dagee::releaseStorage(mNodes);
+  }
+
+  bool valid(void) const noexcept { return mValid; }
+
+  Index numChains(void) const noexcept {
+    return mOffsets.empty() ? 0 : static_cast<Index>(mOffsets.size() - 1);
+  }
+
+  Chain chain(Index c) const {
+    assert(c < numChains() && "chain out of range");
+    return Chain(mNodes.data() + mOffsets[c], mNodes.data() + mOffsets[c + 1]);
+  }
+
+  //! chain of the node with frozen index i
+  Index chainOf(Index i) const { return mChainOf[i]; }
+
+  //! whether the node with frozen index i starts its chain
+  bool isHead(Index i) const { return mPosOf[i] == mOffsets[mChainOf[i]]; }
+
+  //! number of edges folded into chains, i.e., dependencies saved
+  size_t numFused(void) const noexcept { return mNodes.size() - numChains(); }
+
+  size_t maxLength(void) const {
+    size_t m = 0;
+    for (Index c = 0; c < numChains(); ++c) {
+      m = std::max(m, chain(c).size());
+    }
+    return m;
+  }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_CHAIN_FUSION_H
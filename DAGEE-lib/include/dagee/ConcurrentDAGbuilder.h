@@ -0,0 +1,190 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_CONCURRENT_DAG_BUILDER_H
+#define DAGEE_INCLUDE_DAGEE_CONCURRENT_DAG_BUILDER_H
+
+#include "dagee/TaskDAG.h"
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dagee {
+
+/**
+ * Builds a DAGbase from several producer threads at once.
+ *
+ * Each producer thread gets its own Producer, which allocates nodes and keeps
+ * them in a private chunk, so adding nodes needs no synchronization. Edges may
+ * connect nodes of any producers; an edge update locks only the stripes of its
+ * two endpoints, out of NUM_STRIPES mutexes picked by hashing the node address.
+ * finalize() splices the chunks into the DAG in producer order, so node order
+ * (and hence frozen indices) is deterministic, while the order of neighbors in
+ * adjacency lists depends on the interleaving of producers.
+ *
+ * The DAG must not be used otherwise until finalize() returns. The
+ * AllocFactory of the DAG must be THREAD_SAFE, which rules out
+ * ArenaAllocatorFactory.
+ */
+template <typename DAG>
+class ConcurrentDAGbuilder {
+  using AllocFactory = typename DAG::AllocFactoryTy;
+
+  static_assert(AllocFactory::THREAD_SAFE,
+                "ConcurrentDAGbuilder needs an AllocFactory whose allocators are thread safe");
+
+ public:
+  using Node = typename DAG::Node;
+  using NodePtr = typename DAG::NodePtr;
+
+  constexpr static const size_t NUM_STRIPES = 256;
+
+ protected:
+  using NodeAlloc = typename DAG::NodeAlloc;
+  using NodeAllocTraits = typename DAG::NodeAllocTraits;
+  using NodeCont = typename DAG::NodeCont;
+
+  constexpr static const size_t CACHE_LINE = 64;
+
+  struct Stripe {
+    std::mutex mMutex;
+    char mPad[CACHE_LINE - (sizeof(std::mutex) % CACHE_LINE)];
+  };
+
+ public:
+  //! per-thread handle for adding nodes and edges. Not to be shared between threads
+  class Producer {
+    friend class ConcurrentDAGbuilder;
+
+    ConcurrentDAGbuilder& mBuilder;
+    NodeAlloc mNodeAlloc;
+    NodeCont mNodes;
+    // keep neighboring producers off each other's cache lines
+    char mPad[CACHE_LINE];
+
+   public:
+    Producer(ConcurrentDAGbuilder& builder, const NodeAlloc& nodeAlloc)
+        : mBuilder(builder), mNodeAlloc(nodeAlloc), mNodes() {}
+
+    template <typename... Args>
+    NodePtr addNode(Args&&... args) {
+      NodePtr t = NodeAllocTraits::allocate(mNodeAlloc, 1);
+      assert(t && "node allocation failed");
+      NodeAllocTraits::construct(mNodeAlloc, t, std::forward<Args>(args)...);
+      mNodes.push_back(t);
+      return t;
+    }
+
+    void addEdge(NodePtr a, NodePtr b) { mBuilder.addEdge(a, b); }
+
+    size_t numNodes(void) const noexcept { return mNodes.size(); }
+  };
+
+ protected:
+  DAG& mDag;
+  std::vector<std::unique_ptr<Producer> > mProducers;
+  std::unique_ptr<Stripe[]> mStripes;
+
+  //! @return number of nodes moved into the DAG
+  size_t spliceNodes(void) {
+    size_t total = 0;
+    for (const auto& p : mProducers) {
+      total += p->mNodes.size();
+    }
+    mDag.mAllNodes.reserve(mDag.mAllNodes.size() + total);
+
+    for (auto& p : mProducers) {
+      mDag.mAllNodes.insert(mDag.mAllNodes.end(), p->mNodes.cbegin(), p->mNodes.cend());
+      p->mNodes.clear();
+    }
+    return total;
+  }
+
+  Stripe& stripeOf(NodePtr n) const noexcept {
+    // Fibonacci hashing, see AdjacencyList
+    uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(n)) * 0x9E3779B97F4A7C15ull;
+    return mStripes[(h >> 32) % NUM_STRIPES];
+  }
+
+ public:
+  ConcurrentDAGbuilder(DAG& dag, unsigned numProducers)
+      : mDag(dag), mProducers(), mStripes(new Stripe[NUM_STRIPES]) {
+    assert(numProducers > 0 && "need at least one producer");
+    for (unsigned i = 0; i < numProducers; ++i) {
+      mProducers.emplace_back(new Producer(*this, dag.mNodeAlloc));
+    }
+  }
+
+  ConcurrentDAGbuilder(const ConcurrentDAGbuilder&) = delete;
+  ConcurrentDAGbuilder& operator=(const ConcurrentDAGbuilder&) = delete;
+
+  //! nodes not yet handed over to the DAG are handed over here, so they don't leak
+  ~ConcurrentDAGbuilder(void) {
+    if (spliceNodes() > 0) {
+      mDag.thaw();
+    }
+  }
+
+  unsigned numProducers(void) const noexcept { return static_cast<unsigned>(mProducers.size()); }
+
+  Producer& producer(unsigned i) {
+    assert(i < mProducers.size() && "producer id out of range");
+    return *mProducers[i];
+  }
+
+  /**
+   * Thread safe. Duplicate edges are not detected, since hasEdge can't be
+   * answered reliably while the lists of both endpoints are being updated
+   */
+  void addEdge(NodePtr a, NodePtr b) {
+    assert(a && b && "both args should be non-null");
+    assert(a != b && "cannot add self edge, i.e., src==dst");
+    {
+      std::lock_guard<std::mutex> lk(stripeOf(a).mMutex);
+      a->addSucc(b);
+    }
+    {
+      std::lock_guard<std::mutex> lk(stripeOf(b).mMutex);
+      b->addPred(a);
+    }
+  }
+
+  /**
+   * Run func(producer, id) for every producer, each on its own thread (the
+   * calling thread runs producer 0), and wait for all of them
+   */
+  template <typename F>
+  void runProducers(F&& func) {
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < numProducers(); ++i) {
+      threads.emplace_back([&func, this, i](void) { func(producer(i), i); });
+    }
+
+    func(producer(0), 0u);
+
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  /**
+   * Hand all nodes over to the DAG, in producer order. Must be called after all
+   * producers are done. The builder may be reused afterwards.
+   * @param freeze: also call DAG::freeze()
+   */
+  void finalize(bool freeze = false) {
+    spliceNodes();
+    mDag.thaw();
+
+    if (freeze) {
+      mDag.freeze();
+    }
+  }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_CONCURRENT_DAG_BUILDER_H
@@ -0,0 +1,118 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_COST_MODEL_H
+#define DAGEE_INCLUDE_DAGEE_COST_MODEL_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace dagee {
+
+/**
+ * A cost model estimates the duration of a task from its node data, through
+ * double operator()(const NodeData&) const. Any callable with that signature
+ * works, e.g., a lambda. Costs only need to be consistent relative to each
+ * other; they are used to compute bottom levels (see
+ * DAGbase::computeBottomLevels) for critical-path-first scheduling.
+ */
+
+//! every task costs the same, so a bottom level is the number of tasks on the longest path to a sink
+struct UniformCostModel {
+  template <typename T>
+  double operator()(const T&) const noexcept {
+    return 1.0;
+  }
+};
+
+/**
+ * Estimated duration per kernel. An estimate is either set by the user or
+ * learned from measured durations, as an exponential moving average with
+ * weight alpha for the newest sample. Estimates set by the user take precedence
+ * and are not changed by measurements. Kernels without an estimate cost
+ * defaultCost.
+ */
+template <typename Key = uint64_t>
+class KernelCostTable {
+  struct Entry {
+    double mCost;
+    uint32_t mSamples;
+    bool mUserSet;
+  };
+
+  std::unordered_map<Key, Entry> mEntries;
+  double mDefaultCost;
+  double mAlpha;
+
+ public:
+  explicit KernelCostTable(double defaultCost = 1.0, double alpha = 0.25)
+      : mEntries(), mDefaultCost(defaultCost), mAlpha(alpha) {
+    assert(alpha > 0.0 && alpha <= 1.0 && "alpha must be in (0, 1]");
+  }
+
+  //! user-provided estimate for kernel k
+  void set(const Key& k, double cost) { mEntries[k] = Entry{cost, 0, true}; }
+
+  //! learn from a measured duration of kernel k
+  void record(const Key& k, double measured) {
+    auto it = mEntries.find(k);
+    if (it == mEntries.end()) {
+      mEntries.emplace(k, Entry{measured, 1, false});
+      return;
+    }
+
+    Entry& e = it->second;
+    if (!e.mUserSet) {
+      e.mCost += mAlpha * (measured - e.mCost);
+      ++e.mSamples;
+    }
+  }
+
+  double estimate(const Key& k) const {
+    auto it = mEntries.find(k);
+    return it == mEntries.cend() ? mDefaultCost : it->second.mCost;
+  }
+
+  //! number of measurements the estimate of k was learned from
+  uint32_t numSamples(const Key& k) const {
+    auto it = mEntries.find(k);
+    return it == mEntries.cend() ? 0 : it->second.mSamples;
+  }
+
+  bool contains(const Key& k) const { return mEntries.find(k) != mEntries.cend(); }
+
+  size_t size(void) const noexcept { return mEntries.size(); }
+
+  void clear(void) { mEntries.clear(); }
+
+  double defaultCost(void) const noexcept { return mDefaultCost; }
+};
+
+/**
+ * Cost model that looks up the estimate of a task's kernel in a
+ * KernelCostTable. KeyFn maps node data to the kernel key. The table is held
+ * by reference, so estimates learned later are seen by the model
+ */
+template <typename Table, typename KeyFn>
+class KernelCostModel {
+  const Table* mTable;
+  KeyFn mKeyFn;
+
+ public:
+  KernelCostModel(const Table& table, const KeyFn& keyFn) : mTable(&table), mKeyFn(keyFn) {}
+
+  template <typename T>
+  double operator()(const T& nodeData) const {
+    return mTable->estimate(mKeyFn(nodeData));
+  }
+};
+
+template <typename Table, typename KeyFn>
+KernelCostModel<Table, KeyFn> makeKernelCostModel(const Table& table, const KeyFn& keyFn) {
+  return KernelCostModel<Table, KeyFn>(table, keyFn);
+}
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_COST_MODEL_H
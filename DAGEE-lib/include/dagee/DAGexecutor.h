@@ -0,0 +1,129 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_GENERIC_DAG_EXECUTOR_H
+#define DAGEE_INCLUDE_DAGEE_GENERIC_DAG_EXECUTOR_H
+
+#include "dagee/ExecutorAccess.h"
+#include "dagee/TaskDAG.h"
+
+#include "cpputils/Timer.h"
+
+#include <initializer_list>
+
+namespace dagee {
+
+/**
+ * Executes DAGs of ExecT::TaskInstance on any executor implementing the
+ * executor concept of HypotheticalExecutor (see ATMIbaseExecutor.h), e.g.,
+ * ThreadPoolExecutor. Unlike ATMIdagExecutor, it doesn't store task handles in
+ * the node data, so TaskInstance needs no mATMItaskHandle field.
+ *
+ * Each DAG is frozen, then its tasks are created in topological order with
+ * handles kept by node index, sources are activated and sinks are waited on.
+ */
+template <typename ExecT, typename AllocFactory = dagee::StdAllocatorFactory<>>
+class DAGexecutor {
+ public:
+  template <typename AF>
+  using withAllocFactory = DAGexecutor<ExecT, AF>;
+  template <typename NE>
+  using withExecutor = DAGexecutor<NE, AllocFactory>;
+
+  using TaskInstance = typename ExecT::TaskInstance;
+  using TaskHandle = typename ExecT::TaskHandle;
+  using DAG = typename DAGbase<TaskInstance, AllocFactory>::WithPredSucc;
+  using DAGptr = DAG*;
+  using Node = typename DAG::Node;
+  using NodePtr = typename DAG::NodePtr;
+
+ protected:
+  using DAGmgr = DAGmanager<DAG, AllocFactory>;
+  using HandleVec = typename AllocFactory::template Vec<TaskHandle>;
+
+  DAGmgr mDAGmgr;
+  ExecT& mExec;
+  //! scratch space for makeTasks, reused across calls
+  HandleVec mHandlesByIndex;
+  HandleVec mPredHandles;
+  bool mReduceEdges = false;
+
+  template <typename V>
+  void makeTasks(DAGptr dag, V& srcHandles, V& sinkHandles) {
+    using Index = typename DAG::Index;
+
+    if (mReduceEdges) {
+      dag->transitiveReduce();
+    }
+    dag->freeze();
+    const auto& fz = dag->frozen();
+
+    mHandlesByIndex.resize(fz.size());
+
+    for (Index i : fz.topoOrder()) {
+      mPredHandles.clear();
+      for (Index p : fz.predecessors(i)) {
+        mPredHandles.emplace_back(mHandlesByIndex[p]);
+      }
+
+      const auto& tdata = dag->nodeData(fz.node(i));
+      mHandlesByIndex[i] = impl::makeInternalTaskForDag(&mExec, tdata, mPredHandles);
+    }
+
+    for (Index i : fz.sources()) {
+      srcHandles.emplace_back(mHandlesByIndex[i]);
+    }
+
+    for (Index i : fz.sinks()) {
+      sinkHandles.emplace_back(mHandlesByIndex[i]);
+    }
+  }
+
+ public:
+  explicit DAGexecutor(ExecT& exec) : mExec(exec) {}
+
+  ExecT& targetExec() noexcept { return mExec; }
+  const ExecT& targetExec() const noexcept { return mExec; }
+
+  //! see ATMIdagExecutor::enableTransitiveReduction
+  void enableTransitiveReduction(bool enable = true) noexcept { mReduceEdges = enable; }
+
+  DAGptr makeDAG(void) { return mDAGmgr.makeDAG(); }
+
+  void destroyDAG(DAGptr d) { mDAGmgr.destroyDAG(d); }
+
+  template <typename DAGptrIter>
+  void executeParallel(DAGptrIter beg, DAGptrIter end) {
+    cpputils::Timer t0("DAGEE", "DAG-Create", true);
+
+    HandleVec srcHandles;
+    HandleVec sinkHandles;
+
+    for (auto i = beg; i != end; ++i) {
+      makeTasks(*i, srcHandles, sinkHandles);
+    }
+
+    for (const auto& h : srcHandles) {
+      mExec.activateTask(h);
+    }
+
+    t0.stop();
+
+    cpputils::Timer t1("DAGEE", "DAG-Execute", true);
+
+    for (const auto& h : sinkHandles) {
+      mExec.waitOnTask(h);
+    }
+
+    t1.stop();
+  }
+
+  void executeParallel(std::initializer_list<DAGptr> dagArr) {
+    executeParallel(dagArr.begin(), dagArr.end());
+  }
+
+  void execute(DAGptr dag) { executeParallel({dag}); }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_GENERIC_DAG_EXECUTOR_H
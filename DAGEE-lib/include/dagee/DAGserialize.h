@@ -0,0 +1,474 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_DAG_SERIALIZE_H
+#define DAGEE_INCLUDE_DAGEE_DAG_SERIALIZE_H
+
+#include "dagee/TaskDAG.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace dagee {
+
+/**
+ * Binary DAG file format, version 1. All integers are in host byte order,
+ * which the magic string guards against, and all sections are 8-byte aligned.
+ *
+ *   DAGfileHeader
+ *   succ offsets:    uint64_t[numNodes + 1]
+ *   succ indices:    uint32_t[numEdges]
+ *   payload offsets: uint64_t[numNodes + 1]
+ *   payload:         uint8_t[payloadBytes]
+ *
+ * Nodes are stored in topological order, so a node is loaded after all of its
+ * predecessors. The payload of a node is whatever its codec wrote, see
+ * TrivialCodec for the codec interface.
+ */
+struct DAGfileHeader {
+  constexpr static const uint32_t VERSION = 1;
+
+  char mMagic[8];
+  uint32_t mVersion;
+  uint32_t mFlags;
+  uint64_t mNumNodes;
+  uint64_t mNumEdges;
+  uint64_t mPayloadBytes;
+  //! byte offsets of the sections from the start of the file
+  uint64_t mSuccOffsetsPos;
+  uint64_t mSuccIndicesPos;
+  uint64_t mPayloadOffsetsPos;
+  uint64_t mPayloadPos;
+
+  static const char* magic(void) noexcept { return "DAGEEdag"; }
+};
+
+namespace impl {
+
+inline uint64_t alignUp8(uint64_t x) noexcept { return (x + 7) & ~uint64_t(7); }
+
+template <typename V>
+void appendBytes(V& out, const void* src, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(src);
+  out.insert(out.end(), p, p + size);
+}
+
+inline bool writePadded(std::ofstream& fh, const void* src, uint64_t size) {
+  static const char zeros[8] = {};
+  fh.write(static_cast<const char*>(src), size);
+  fh.write(zeros, alignUp8(size) - size);
+  return fh.good();
+}
+
+} // end namespace impl
+
+/**
+ * Codec for trivially copyable node data, stored as raw bytes. A value codec
+ * has a value_type, encode(const value_type&, ByteVec& out) appending the
+ * bytes of a value, valid(bytes, size) telling whether decode can read bytes,
+ * which come from a file and may be corrupt, and decode(bytes, size) returning
+ * the value of valid bytes.
+ */
+template <typename T>
+struct TrivialCodec {
+  static_assert(std::is_trivially_copyable<T>::value, "TrivialCodec needs trivially copyable T");
+
+  using value_type = T;
+
+  template <typename V>
+  void encode(const T& x, V& out) const {
+    impl::appendBytes(out, &x, sizeof(T));
+  }
+
+  bool valid(const uint8_t*, size_t size) const { return size == sizeof(T); }
+
+  T decode(const uint8_t* bytes, size_t size) const {
+    assert(size == sizeof(T) && "payload size doesn't match");
+    (void)size;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type buf;
+    std::memcpy(&buf, bytes, sizeof(T));
+    return *reinterpret_cast<const T*>(&buf);
+  }
+};
+
+/**
+ * Adapts a value codec to the node data of a DAGbase or an IdDAGbase. A node
+ * codec has encode(dag, node, ByteVec& out) and decode(dag, bytes, size,
+ * NodePtr& n), which adds a node to dag and sets n to it, or returns false if
+ * bytes are not valid. Failure is not told by n, since a NodePtr may be an id,
+ * where 0 is a valid node
+ */
+template <typename C>
+struct NodeDataCodec {
+  C mCodec;
+
+  explicit NodeDataCodec(const C& codec = C()) : mCodec(codec) {}
+
+  template <typename DAG, typename V>
+  void encode(DAG& dag, typename DAG::NodePtr n, V& out) const {
+    mCodec.encode(dag.nodeData(n), out);
+  }
+
+  template <typename DAG>
+  bool decode(DAG& dag, const uint8_t* bytes, size_t size, typename DAG::NodePtr& n) const {
+    if (!mCodec.valid(bytes, size)) {
+      return false;
+    }
+    n = dag.addNode(mCodec.decode(bytes, size));
+    return true;
+  }
+};
+
+template <typename DAG>
+using DefaultNodeCodec = NodeDataCodec<TrivialCodec<typename DAG::NodeData> >;
+
+/**
+ * Node codec for MixedTaskDag<..., DataTypes...>, with one value codec per data
+ * type, in the same order. The payload is the type id in one byte, followed by
+ * the bytes written by the value codec of that type
+ */
+template <typename... Codecs>
+class MixedNodeDataCodec {
+  using CodecTuple = std::tuple<Codecs...>;
+
+  static_assert(sizeof...(Codecs) <= 256, "type id must fit in one byte");
+
+  CodecTuple mCodecs;
+
+  template <typename DAG, typename V, size_t... Indices>
+  void encodeImpl(DAG& dag, typename DAG::NodePtr n, V& out,
+                  impl::IntSeq<size_t, Indices...>) const {
+    const auto& gd = dag.nodeData(n);
+    const size_t id = gd.id();
+    out.push_back(static_cast<uint8_t>(id));
+
+    int expand[] = {0, ((id == Indices)
+                            ? std::get<Indices>(mCodecs).encode(
+                                  *gd.template ptr<typename std::tuple_element<
+                                      Indices, CodecTuple>::type::value_type>(),
+                                  out)
+                            : void(),
+                        0)...};
+    (void)expand;
+  }
+
+  template <typename DAG, size_t... Indices>
+  bool decodeImpl(DAG& dag, const uint8_t* bytes, size_t size, typename DAG::NodePtr& n,
+                  impl::IntSeq<size_t, Indices...>) const {
+    if (size == 0 || bytes[0] >= sizeof...(Codecs)) {
+      return false;
+    }
+    const size_t id = bytes[0];
+
+    // stays false if the codec of type id rejects the payload
+    bool ok = false;
+    int expand[] = {
+        0, ((id == Indices && std::get<Indices>(mCodecs).valid(bytes + 1, size - 1))
+                ? void((n = dag.addNode(std::get<Indices>(mCodecs).decode(bytes + 1, size - 1)),
+                        ok = true))
+                : void(),
+            0)...};
+    (void)expand;
+    return ok;
+  }
+
+ public:
+  explicit MixedNodeDataCodec(const Codecs&... codecs) : mCodecs(codecs...) {}
+
+  template <typename DAG, typename V>
+  void encode(DAG& dag, typename DAG::NodePtr n, V& out) const {
+    encodeImpl(dag, n, out, impl::MakeIndexSeqFor<Codecs...>());
+  }
+
+  template <typename DAG>
+  bool decode(DAG& dag, const uint8_t* bytes, size_t size, typename DAG::NodePtr& n) const {
+    return decodeImpl(dag, bytes, size, n, impl::MakeIndexSeqFor<Codecs...>());
+  }
+};
+
+template <typename... Codecs>
+MixedNodeDataCodec<Codecs...> makeMixedNodeDataCodec(const Codecs&... codecs) {
+  return MixedNodeDataCodec<Codecs...>(codecs...);
+}
+
+/**
+ * Write dag to path. Freezes the DAG. Nodes are written in topological order
+ * and their data is encoded by codec. @return false on I/O errors
+ */
+template <typename DAG, typename C = DefaultNodeCodec<DAG> >
+bool saveDAG(DAG& dag, const char* path, const C& codec = C()) {
+  using Index = typename DAG::Index;
+
+  dag.freeze();
+  const auto& fz = dag.frozen();
+  const Index N = fz.size();
+
+  std::vector<Index> pos(N);
+  for (Index k = 0; k < N; ++k) {
+    pos[fz.topoOrder()[k]] = k;
+  }
+
+  std::vector<uint64_t> succOffsets;
+  std::vector<uint32_t> succIndices;
+  std::vector<uint64_t> payloadOffsets;
+  std::vector<uint8_t> payload;
+
+  succOffsets.reserve(N + 1);
+  succIndices.reserve(fz.numEdges());
+  payloadOffsets.reserve(N + 1);
+
+  for (Index i : fz.topoOrder()) {
+    succOffsets.emplace_back(succIndices.size());
+    for (Index s : fz.successors(i)) {
+      succIndices.emplace_back(pos[s]);
+    }
+
+    payloadOffsets.emplace_back(payload.size());
+    codec.encode(dag, fz.node(i), payload);
+  }
+  succOffsets.emplace_back(succIndices.size());
+  payloadOffsets.emplace_back(payload.size());
+
+  DAGfileHeader h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.mMagic, DAGfileHeader::magic(), sizeof(h.mMagic));
+  h.mVersion = DAGfileHeader::VERSION;
+  h.mNumNodes = N;
+  h.mNumEdges = succIndices.size();
+  h.mPayloadBytes = payload.size();
+  h.mSuccOffsetsPos = impl::alignUp8(sizeof(h));
+  h.mSuccIndicesPos = h.mSuccOffsetsPos + impl::alignUp8(succOffsets.size() * sizeof(uint64_t));
+  h.mPayloadOffsetsPos = h.mSuccIndicesPos + impl::alignUp8(succIndices.size() * sizeof(uint32_t));
+  h.mPayloadPos = h.mPayloadOffsetsPos + impl::alignUp8(payloadOffsets.size() * sizeof(uint64_t));
+
+  std::ofstream fh(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!fh.is_open()) {
+    return false;
+  }
+
+  bool ok = impl::writePadded(fh, &h, sizeof(h));
+  ok = ok && impl::writePadded(fh, succOffsets.data(), succOffsets.size() * sizeof(uint64_t));
+  ok = ok && impl::writePadded(fh, succIndices.data(), succIndices.size() * sizeof(uint32_t));
+  ok = ok && impl::writePadded(fh, payloadOffsets.data(), payloadOffsets.size() * sizeof(uint64_t));
+  ok = ok && impl::writePadded(fh, payload.data(), payload.size());
+  fh.close();
+
+  return ok && !fh.fail();
+}
+
+/**
+ * Read-only view of a DAG file, mapped into memory. Topology and payloads are
+ * read in place, without copying; pages are brought in by the OS as they are
+ * touched, and the page cache is shared by all processes using the file
+ */
+class MappedDAGfile {
+ public:
+  template <typename T>
+  class Range {
+    const T* mBeg;
+    const T* mEnd;
+
+   public:
+    Range(const T* beg, const T* end) noexcept : mBeg(beg), mEnd(end) {}
+
+    const T* begin(void) const noexcept { return mBeg; }
+    const T* end(void) const noexcept { return mEnd; }
+    size_t size(void) const noexcept { return mEnd - mBeg; }
+    bool empty(void) const noexcept { return mBeg == mEnd; }
+  };
+
+ protected:
+  void* mMap = nullptr;
+  size_t mSize = 0;
+
+  const uint8_t* bytes(void) const noexcept { return static_cast<const uint8_t*>(mMap); }
+
+  const DAGfileHeader& header(void) const noexcept {
+    return *reinterpret_cast<const DAGfileHeader*>(mMap);
+  }
+
+  template <typename T>
+  const T* section(uint64_t pos) const noexcept {
+    return reinterpret_cast<const T*>(bytes() + pos);
+  }
+
+  const uint64_t* succOffsets(void) const noexcept {
+    return section<uint64_t>(header().mSuccOffsetsPos);
+  }
+
+  const uint64_t* payloadOffsets(void) const noexcept {
+    return section<uint64_t>(header().mPayloadOffsetsPos);
+  }
+
+  bool fits(uint64_t pos, uint64_t size) const noexcept {
+    return pos % 8 == 0 && pos <= mSize && size <= mSize - pos;
+  }
+
+  //! fits for an array of count elements, without overflowing count * elemSize
+  bool fitsArray(uint64_t pos, uint64_t count, uint64_t elemSize) const noexcept {
+    return count <= mSize / elemSize && fits(pos, count * elemSize);
+  }
+
+  //! offsets[0..N] start at 0, never decrease and end at last
+  static bool validOffsets(const uint64_t* offsets, uint64_t N, uint64_t last) noexcept {
+    if (offsets[0] != 0 || offsets[N] != last) {
+      return false;
+    }
+    for (uint64_t i = 0; i < N; ++i) {
+      if (offsets[i] > offsets[i + 1]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool validate(void) const {
+    if (mSize < sizeof(DAGfileHeader)) {
+      return false;
+    }
+
+    const DAGfileHeader& h = header();
+    if (std::memcmp(h.mMagic, DAGfileHeader::magic(), sizeof(h.mMagic)) != 0 ||
+        h.mVersion != DAGfileHeader::VERSION) {
+      return false;
+    }
+
+    const uint64_t N = h.mNumNodes;
+    if (N >= uint64_t(UINT32_MAX) || !fitsArray(h.mSuccOffsetsPos, N + 1, sizeof(uint64_t)) ||
+        !fitsArray(h.mSuccIndicesPos, h.mNumEdges, sizeof(uint32_t)) ||
+        !fitsArray(h.mPayloadOffsetsPos, N + 1, sizeof(uint64_t)) ||
+        !fits(h.mPayloadPos, h.mPayloadBytes)) {
+      return false;
+    }
+
+    // successors(i) and payload(i) index the sections with these, unchecked
+    return validOffsets(succOffsets(), N, h.mNumEdges) &&
+           validOffsets(payloadOffsets(), N, h.mPayloadBytes);
+  }
+
+ public:
+  MappedDAGfile(void) = default;
+
+  explicit MappedDAGfile(const char* path) { open(path); }
+
+  MappedDAGfile(const MappedDAGfile&) = delete;
+  MappedDAGfile& operator=(const MappedDAGfile&) = delete;
+
+  ~MappedDAGfile(void) { close(); }
+
+  //! @return false if the file can't be mapped or is not a valid DAG file
+  bool open(const char* path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+
+    void* m = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+      return false;
+    }
+
+    mMap = m;
+    mSize = st.st_size;
+
+    if (!validate()) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close(void) {
+    if (mMap) {
+      ::munmap(mMap, mSize);
+      mMap = nullptr;
+      mSize = 0;
+    }
+  }
+
+  bool isOpen(void) const noexcept { return mMap != nullptr; }
+
+  uint32_t numNodes(void) const noexcept { return static_cast<uint32_t>(header().mNumNodes); }
+
+  size_t numEdges(void) const noexcept { return header().mNumEdges; }
+
+  //! node indices are topological positions
+  Range<uint32_t> successors(uint32_t i) const noexcept {
+    assert(i < numNodes() && "node index out of range");
+    const uint32_t* s = section<uint32_t>(header().mSuccIndicesPos);
+    return Range<uint32_t>(s + succOffsets()[i], s + succOffsets()[i + 1]);
+  }
+
+  Range<uint8_t> payload(uint32_t i) const noexcept {
+    assert(i < numNodes() && "node index out of range");
+    const uint8_t* p = section<uint8_t>(header().mPayloadPos);
+    return Range<uint8_t>(p + payloadOffsets()[i], p + payloadOffsets()[i + 1]);
+  }
+};
+
+/**
+ * Add the nodes and edges of a DAG file to dag, decoding the node data with
+ * codec straight from the mapped file. The i-th node of the file is the i-th
+ * node added. @return false if the file is invalid, the codec rejects a
+ * payload, or the DAG has a node whose successor doesn't come after it. The
+ * nodes added until then stay in dag
+ */
+template <typename DAG, typename C = DefaultNodeCodec<DAG> >
+bool loadDAG(DAG& dag, const MappedDAGfile& file, const C& codec = C()) {
+  using NodePtr = typename DAG::NodePtr;
+
+  if (!file.isOpen()) {
+    return false;
+  }
+
+  const uint32_t N = file.numNodes();
+  std::vector<NodePtr> nodes;
+  nodes.reserve(N);
+
+  for (uint32_t i = 0; i < N; ++i) {
+    auto p = file.payload(i);
+    NodePtr n;
+    if (!codec.decode(dag, p.begin(), p.size(), n)) {
+      return false;
+    }
+    nodes.emplace_back(n);
+  }
+
+  for (uint32_t i = 0; i < N; ++i) {
+    for (uint32_t s : file.successors(i)) {
+      if (s <= i || s >= N) {
+        return false;
+      }
+      dag.addEdge(nodes[i], nodes[s]);
+    }
+  }
+  return true;
+}
+
+template <typename DAG, typename C = DefaultNodeCodec<DAG> >
+bool loadDAG(DAG& dag, const char* path, const C& codec = C()) {
+  MappedDAGfile file(path);
+  return loadDAG(dag, file, codec);
+}
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_DAG_SERIALIZE_H
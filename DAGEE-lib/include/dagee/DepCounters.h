@@ -0,0 +1,100 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_DEP_COUNTERS_H
+#define DAGEE_INCLUDE_DAGEE_DEP_COUNTERS_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+namespace dagee {
+
+using AtomicCounter = std::atomic<unsigned>;
+using AtomicCounterValue = unsigned;
+
+enum class DepCounterLayout {
+  //! counters back to back, 16 to a cache line. Smallest, best for sequential traversals
+  PACKED,
+  //! one counter per cache line, so that concurrent decrements never false-share
+  PADDED
+};
+
+/**
+ * Dependency counters of the nodes of a DAG, by node index, kept apart from the
+ * nodes so that a traversal updating them doesn't pull node data and adjacency
+ * lists into the cache, nor contend with threads reading those. The storage is
+ * reused across traversals, and only grows.
+ */
+class DepCounterArray {
+  constexpr static const size_t CACHE_LINE = 64;
+  constexpr static const size_t PER_LINE = CACHE_LINE / sizeof(AtomicCounter);
+
+  std::unique_ptr<AtomicCounter[]> mBuf;
+  //! first cache-line aligned element of mBuf
+  AtomicCounter* mCounters = nullptr;
+  size_t mCapacity = 0;
+  size_t mSize = 0;
+  size_t mStride = 1;
+  DepCounterLayout mLayout;
+
+  void allocate(size_t numSlots) {
+    // C++11 new[] does not align to cache lines, so over-allocate and align by hand
+    mBuf.reset(new AtomicCounter[numSlots + PER_LINE]);
+    auto addr = reinterpret_cast<uintptr_t>(mBuf.get());
+    size_t skip = ((CACHE_LINE - addr % CACHE_LINE) % CACHE_LINE) / sizeof(AtomicCounter);
+    mCounters = mBuf.get() + skip;
+    mCapacity = numSlots;
+  }
+
+ public:
+  explicit DepCounterArray(DepCounterLayout layout = DepCounterLayout::PACKED) noexcept
+      : mLayout(layout) {}
+
+  //! takes effect at the next reset
+  void setLayout(DepCounterLayout layout) noexcept { mLayout = layout; }
+
+  DepCounterLayout layout(void) const noexcept { return mLayout; }
+
+  /**
+   * Size the array for n nodes and set the counter of node i to initFn(i).
+   * Counters are stored with relaxed order; publishing them to other threads is
+   * up to the caller, e.g., the thread launch of a parallel traversal.
+   */
+  template <typename F>
+  void reset(size_t n, const F& initFn) {
+    mStride = (mLayout == DepCounterLayout::PADDED) ? size_t(PER_LINE) : size_t(1);
+    if (n * mStride > mCapacity) {
+      allocate(n * mStride);
+    }
+    mSize = n;
+
+    for (size_t i = 0; i < n; ++i) {
+      mCounters[i * mStride].store(initFn(i), std::memory_order_relaxed);
+    }
+  }
+
+  //! @return the value after the decrement
+  AtomicCounterValue decrement(size_t i) noexcept {
+    assert(i < mSize && "index out of range");
+    return mCounters[i * mStride].fetch_sub(1, std::memory_order_acq_rel) - 1;
+  }
+
+  AtomicCounterValue value(size_t i) const noexcept {
+    assert(i < mSize && "index out of range");
+    return mCounters[i * mStride].load(std::memory_order_acquire);
+  }
+
+  size_t size(void) const noexcept { return mSize; }
+
+  void releaseStorage(void) {
+    mBuf.reset();
+    mCounters = nullptr;
+    mCapacity = 0;
+    mSize = 0;
+  }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_DEP_COUNTERS_H
@@ -0,0 +1,228 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_EXECUTABLE_DAG_H
+#define DAGEE_INCLUDE_DAGEE_EXECUTABLE_DAG_H
+
+#include "dagee/ATMIbaseExecutor.h"
+#include "dagee/ATMIcoreDef.h"
+#include "dagee/AllocFactory.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace dagee {
+
+/**
+ * A DAG of tasks instantiated once and launched many times, in the spirit of
+ * CUDA/HIP graph instantiation. See ATMIdagExecutor::instantiate.
+ *
+ * At instantiation, the tasks are laid out in topological order and each task
+ * gets its launch parameters, kernel handle and argument addresses precomputed
+ * (ExecT::PreparedTask). Predecessors are stored as positions in a flat
+ * array, and the requires array of each task points at its own slice of a flat
+ * array of handles. A launch then only refreshes those handles and creates the
+ * ATMI tasks, with no allocation and no walk over DAG nodes.
+ *
+ * Kernel arguments live in the TaskInstance stored in the DAG node, and can be
+ * changed in place between launches with setArg. The DAG must outlive the
+ * ExecutableDAG, and its nodes must not be removed. Edges added after
+ * instantiation are not seen by the ExecutableDAG.
+ */
+template <typename ExecT, typename AllocFactory>
+class ExecutableDAG {
+ public:
+  using TaskInstance = typename ExecT::TaskInstance;
+  using PreparedTask = typename ExecT::PreparedTask;
+  using Index = uint32_t;
+
+ protected:
+  using IndexVec = typename AllocFactory::template Vec<Index>;
+  using TaskPtrVec = typename AllocFactory::template Vec<TaskInstance*>;
+  using PreparedVec = typename AllocFactory::template Vec<PreparedTask>;
+  using ATMIhandleVec = typename AllocFactory::template Vec<ATMItaskHandle>;
+
+  ExecT* mExec = nullptr;
+
+  //! all of the following, except mPosOfIndex, are indexed by topological position
+  TaskPtrVec mTasks;
+  PreparedVec mPrepared;
+  IndexVec mPredOffsets;
+  //! topological positions of the predecessors, delimited by mPredOffsets
+  IndexVec mPredPos;
+  //! handles of the predecessors, same layout as mPredPos. The requires arrays point here
+  ATMIhandleVec mPredHandles;
+  ATMIhandleVec mHandles;
+
+  //! node index in the frozen DAG -> topological position
+  IndexVec mPosOfIndex;
+
+  IndexVec mSrcPos;
+  IndexVec mSinkPos;
+  ATMIhandleVec mSrcHandles;
+  ATMIhandleVec mSinkHandles;
+
+  bool mInFlight = false;
+
+ public:
+  ExecutableDAG(void) = default;
+
+  // requires arrays point into mPredHandles, which a copy would not carry over
+  ExecutableDAG(const ExecutableDAG&) = delete;
+  ExecutableDAG& operator=(const ExecutableDAG&) = delete;
+
+  // moving the vectors keeps their buffers, so the requires arrays stay valid
+  ExecutableDAG(ExecutableDAG&&) = default;
+  ExecutableDAG& operator=(ExecutableDAG&&) = default;
+
+  /**
+   * @param exec: target executor that creates the tasks
+   * @param dag: a frozen DAG with TaskInstance node data
+   */
+  template <typename DAG>
+  void instantiate(ExecT& exec, DAG& dag) {
+    assert(dag.isFrozen() && "DAG must be frozen first");
+    instantiate(exec, dag, dag.frozen().topoOrder());
+  }
+
+  /**
+   * Same as above, with tasks laid out, created and activated in the given
+   * topological order of node indices, e.g., DAGbase::computePriorityOrder
+   */
+  template <typename DAG, typename O>
+  void instantiate(ExecT& exec, DAG& dag, const O& order) {
+    assert(!mInFlight && "wait for the previous launch first");
+    assert(dag.isFrozen() && "DAG must be frozen first");
+
+    const auto& fz = dag.frozen();
+    const Index N = fz.size();
+    assert(order.size() == N && "order must have every node exactly once");
+
+    mExec = &exec;
+
+    mTasks.clear();
+    mPrepared.clear();
+    mPredOffsets.clear();
+    mPredPos.clear();
+    mSrcPos.clear();
+    mSinkPos.clear();
+
+    mPosOfIndex.assign(N, 0);
+    Index pos = 0;
+    for (Index i : order) {
+      mPosOfIndex[i] = pos++;
+    }
+
+    mTasks.reserve(N);
+    mPredOffsets.reserve(N + 1);
+    mPredPos.reserve(fz.numEdges());
+
+    for (Index i : order) {
+      mPredOffsets.emplace_back(static_cast<Index>(mPredPos.size()));
+      for (Index p : fz.predecessors(i)) {
+        mPredPos.emplace_back(mPosOfIndex[p]);
+      }
+
+      mTasks.emplace_back(&dag.nodeData(fz.node(i)));
+
+      if (fz.isSrc(i)) {
+        mSrcPos.emplace_back(mPosOfIndex[i]);
+      }
+      if (fz.isSink(i)) {
+        mSinkPos.emplace_back(mPosOfIndex[i]);
+      }
+    }
+    mPredOffsets.emplace_back(static_cast<Index>(mPredPos.size()));
+
+    // sized once and for all, the prepared tasks keep pointers into mPredHandles
+    mPredHandles.assign(mPredPos.size(), ATMItaskHandle());
+    mHandles.assign(N, ATMItaskHandle());
+    mSrcHandles.assign(mSrcPos.size(), ATMItaskHandle());
+    mSinkHandles.assign(mSinkPos.size(), ATMItaskHandle());
+
+    mPrepared.reserve(N);
+    for (Index k = 0; k < N; ++k) {
+      const Index beg = mPredOffsets[k];
+      const Index numPreds = mPredOffsets[k + 1] - beg;
+      mPrepared.emplace_back(impl::prepareTaskForDag(mExec, *mTasks[k],
+                                                     numPreds ? &mPredHandles[beg] : nullptr,
+                                                     numPreds));
+    }
+  }
+
+  bool valid(void) const noexcept { return mExec != nullptr; }
+
+  Index size(void) const noexcept { return static_cast<Index>(mTasks.size()); }
+
+  size_t numEdges(void) const noexcept { return mPredPos.size(); }
+
+  /**
+   * Create all tasks and activate the sources. Returns without waiting; call
+   * wait() before the next launch or before changing any arguments
+   */
+  void launch(void) {
+    assert(valid() && "not instantiated");
+    assert(!mInFlight && "wait for the previous launch first");
+
+    const Index N = size();
+    for (Index k = 0; k < N; ++k) {
+      for (Index e = mPredOffsets[k]; e < mPredOffsets[k + 1]; ++e) {
+        mPredHandles[e] = mHandles[mPredPos[e]];
+      }
+      mHandles[k] = impl::makePreparedTaskForDag(mExec, mPrepared[k]);
+    }
+
+    for (size_t s = 0; s < mSrcPos.size(); ++s) {
+      mSrcHandles[s] = mHandles[mSrcPos[s]];
+    }
+    for (size_t s = 0; s < mSinkPos.size(); ++s) {
+      mSinkHandles[s] = mHandles[mSinkPos[s]];
+    }
+
+    mInFlight = true;
+    impl::activateTasks(mSrcHandles.begin(), mSrcHandles.end());
+  }
+
+  //! wait for the sinks of the last launch
+  void wait(void) {
+    if (mInFlight) {
+      impl::waitOnTasks(mSinkHandles.begin(), mSinkHandles.end());
+      mInFlight = false;
+    }
+  }
+
+  /**
+   * Overwrite kernel argument number argPos of the task at node index
+   * nodeIndex (see NodeBase::frozenIndex) with val. T must have the type the
+   * task was created with, or at least fit in its slot.
+   */
+  template <typename T>
+  void setArg(Index nodeIndex, size_t argPos, const T& val) {
+    static_assert(std::is_trivially_copyable<T>::value, "kernel args must be trivially copyable");
+    assert(!mInFlight && "arguments can't change while a launch is in flight");
+    assert(nodeIndex < mPosOfIndex.size() && "node index out of range");
+
+    TaskInstance& ti = *mTasks[mPosOfIndex[nodeIndex]];
+    assert(argPos < ti.mKernArgOffsets.size() && "arg position out of range");
+
+    const size_t off = ti.mKernArgOffsets[argPos];
+    const size_t end = (argPos + 1 < ti.mKernArgOffsets.size()) ? ti.mKernArgOffsets[argPos + 1]
+                                                                 : ti.mKernArgs.size();
+    assert(off + sizeof(T) <= end && "value doesn't fit in the arg slot");
+    (void)end;
+
+    // in place, so the argument addresses of the prepared task remain valid
+    std::memcpy(ti.mKernArgs.data() + off, &val, sizeof(T));
+  }
+
+  //! same as above, for a node of the instantiated DAG
+  template <typename N, typename T>
+  void setArg(const N* node, size_t argPos, const T& val) {
+    setArg(node->frozenIndex(), argPos, val);
+  }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_EXECUTABLE_DAG_H
@@ -0,0 +1,65 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_EXECUTOR_ACCESS_H
+#define DAGEE_INCLUDE_DAGEE_EXECUTOR_ACCESS_H
+
+#include <cstddef>
+#include <initializer_list>
+
+namespace dagee {
+
+/**
+ * Provides access to private methods of the executor. Exec::TaskHandle is the
+ * type of its task handles, e.g., ATMItaskHandle for the ATMI executors
+ */
+template <typename Exec>
+struct ExecutorAccess {
+  using TaskHandle = typename Exec::TaskHandle;
+
+  Exec* mExec;
+
+  template <typename TaskInstance, typename V = std::initializer_list<TaskHandle>>
+  TaskHandle makeInternalTask(const TaskInstance& ti, const V& predHandles = V()) {
+    return mExec->makeInternalTask(ti, predHandles);
+  }
+
+  // templates so that executors without PreparedTask, e.g., ThreadPoolExecutor, can use the rest
+  template <typename E = Exec>
+  typename E::PreparedTask prepareTask(const typename E::TaskInstance& ti,
+                                       const TaskHandle* predsArr, size_t numPreds) {
+    return mExec->prepareTask(ti, predsArr, numPreds);
+  }
+
+  template <typename E = Exec>
+  TaskHandle makePreparedTask(typename E::PreparedTask& pt) {
+    return mExec->makePreparedTask(pt);
+  }
+};
+
+namespace impl {
+template <typename Exec, typename V = std::initializer_list<typename Exec::TaskHandle>>
+typename Exec::TaskHandle makeInternalTaskForDag(Exec* execPtr,
+                                                 const typename Exec::TaskInstance& ti,
+                                                 const V& predHandles = V()) {
+  ExecutorAccess<Exec> ea{execPtr};
+  return ea.makeInternalTask(ti, predHandles);
+}
+
+template <typename Exec>
+typename Exec::PreparedTask prepareTaskForDag(Exec* execPtr, const typename Exec::TaskInstance& ti,
+                                              const typename Exec::TaskHandle* predsArr,
+                                              size_t numPreds) {
+  ExecutorAccess<Exec> ea{execPtr};
+  return ea.prepareTask(ti, predsArr, numPreds);
+}
+
+template <typename Exec>
+typename Exec::TaskHandle makePreparedTaskForDag(Exec* execPtr, typename Exec::PreparedTask& pt) {
+  ExecutorAccess<Exec> ea{execPtr};
+  return ea.makePreparedTask(pt);
+}
+} // namespace impl
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_EXECUTOR_ACCESS_H
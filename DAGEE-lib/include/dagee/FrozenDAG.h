@@ -0,0 +1,368 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_FROZEN_DAG_H
+#define DAGEE_INCLUDE_DAGEE_FROZEN_DAG_H
+
+#include "dagee/AllocFactory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace dagee {
+
+/**
+ * Immutable compressed sparse row (CSR) snapshot of the topology of a DAG.
+ *
+ * Nodes are numbered 0..N-1 in insertion order. Successors and predecessors of
+ * each node are stored as 32-bit indices in two contiguous arrays, delimited by
+ * offset arrays, so that traversals scan memory linearly instead of chasing
+ * per-node adjacency lists. A topological order, the sources and the sinks are
+ * computed once at build time.
+ *
+ * A FrozenDAG does not own the nodes. It is built and cached by DAGbase::freeze()
+ * and dropped as soon as the DAG is modified.
+ */
+template <typename NodePtr_tp, typename AllocFactory>
+class FrozenDAG {
+ public:
+  using NodePtr = NodePtr_tp;
+  using Index = uint32_t;
+  using IndexVec = typename AllocFactory::template Vec<Index>;
+  using NodeVec = typename AllocFactory::template Vec<NodePtr>;
+
+  constexpr static const Index INVALID_INDEX = std::numeric_limits<Index>::max();
+
+  class IndexRange {
+    const Index* mBeg;
+    const Index* mEnd;
+
+   public:
+    IndexRange(const Index* beg, const Index* end) noexcept : mBeg(beg), mEnd(end) {}
+
+    const Index* begin(void) const noexcept { return mBeg; }
+    const Index* end(void) const noexcept { return mEnd; }
+    size_t size(void) const noexcept { return mEnd - mBeg; }
+    bool empty(void) const noexcept { return mBeg == mEnd; }
+    Index operator[](size_t i) const noexcept { return mBeg[i]; }
+  };
+
+ protected:
+  bool mValid = false;
+  NodeVec mNodes;
+  IndexVec mSuccOffsets;
+  IndexVec mSuccIndices;
+  IndexVec mPredOffsets;
+  IndexVec mPredIndices;
+  IndexVec mTopoOrder;
+  IndexVec mSources;
+  IndexVec mSinks;
+
+  static void prefixSum(IndexVec& offsets) {
+    Index sum = 0;
+    for (auto& o : offsets) {
+      Index c = o;
+      o = sum;
+      sum += c;
+    }
+  }
+
+  void computeTopoOrder(void) {
+    const Index N = size();
+    mTopoOrder.clear();
+    mTopoOrder.reserve(N);
+
+    IndexVec depCounts(N);
+    for (Index i = 0; i < N; ++i) {
+      depCounts[i] = numPreds(i);
+    }
+
+    mTopoOrder.insert(mTopoOrder.end(), mSources.cbegin(), mSources.cend());
+
+    // mTopoOrder doubles up as the FIFO work queue, which yields a BFS-like order
+    for (size_t head = 0; head < mTopoOrder.size(); ++head) {
+      for (Index s : successors(mTopoOrder[head])) {
+        assert(depCounts[s] > 0 && "invalid dependence count");
+        if (--depCounts[s] == 0) {
+          mTopoOrder.push_back(s);
+        }
+      }
+    }
+
+    assert(mTopoOrder.size() == N && "cycle detected, graph is not a DAG");
+  }
+
+ public:
+  FrozenDAG(void) = default;
+
+  //! bind all arrays to the memory arena of the owning DAG
+  template <typename A>
+  explicit FrozenDAG(A& arena)
+      : mNodes(AllocFactory::template makeVec<NodePtr>(arena)),
+        mSuccOffsets(AllocFactory::template makeVec<Index>(arena)),
+        mSuccIndices(AllocFactory::template makeVec<Index>(arena)),
+        mPredOffsets(AllocFactory::template makeVec<Index>(arena)),
+        mPredIndices(AllocFactory::template makeVec<Index>(arena)),
+        mTopoOrder(AllocFactory::template makeVec<Index>(arena)),
+        mSources(AllocFactory::template makeVec<Index>(arena)),
+        mSinks(AllocFactory::template makeVec<Index>(arena)) {}
+
+  /**
+   * Build the CSR arrays.
+   * @param nodes: container of NodePtr in index order
+   * @param forEachEdge: callable that accepts a callable edgeFn and invokes
+   * edgeFn(srcIndex, dstIndex) once for every edge of the DAG. It is called
+   * twice: once to count degrees and once to fill the index arrays
+   */
+  template <typename C, typename E>
+  void build(const C& nodes, E&& forEachEdge) {
+    clear();
+
+    assert(nodes.size() < INVALID_INDEX && "too many nodes for 32-bit indices");
+    const Index N = static_cast<Index>(nodes.size());
+
+    mNodes.assign(nodes.cbegin(), nodes.cend());
+    mSuccOffsets.assign(N + 1, 0);
+    mPredOffsets.assign(N + 1, 0);
+
+    size_t numEdges = 0;
+    forEachEdge([&, this](Index src, Index dst) {
+      assert(src < N && dst < N && "edge index out of range");
+      ++mSuccOffsets[src];
+      ++mPredOffsets[dst];
+      ++numEdges;
+    });
+    assert(numEdges < INVALID_INDEX && "too many edges for 32-bit offsets");
+
+    prefixSum(mSuccOffsets);
+    prefixSum(mPredOffsets);
+
+    mSuccIndices.resize(numEdges);
+    mPredIndices.resize(numEdges);
+
+    // use the offsets as insertion cursors, which shifts them by one node. Shift
+    // them back afterwards instead of keeping separate cursor arrays
+    forEachEdge([this](Index src, Index dst) {
+      mSuccIndices[mSuccOffsets[src]++] = dst;
+      mPredIndices[mPredOffsets[dst]++] = src;
+    });
+
+    for (Index i = N; i > 0; --i) {
+      mSuccOffsets[i] = mSuccOffsets[i - 1];
+      mPredOffsets[i] = mPredOffsets[i - 1];
+    }
+    mSuccOffsets[0] = 0;
+    mPredOffsets[0] = 0;
+
+    for (Index i = 0; i < N; ++i) {
+      if (isSrc(i)) {
+        mSources.push_back(i);
+      }
+      if (isSink(i)) {
+        mSinks.push_back(i);
+      }
+    }
+
+    computeTopoOrder();
+
+    mValid = true;
+  }
+
+  void clear(void) {
+    mValid = false;
+    mNodes.clear();
+    mSuccOffsets.clear();
+    mSuccIndices.clear();
+    mPredOffsets.clear();
+    mPredIndices.clear();
+    mTopoOrder.clear();
+    mSources.clear();
+    mSinks.clear();
+  }
+
+  //! clear and also give back the memory of all arrays
+  void releaseStorage(void) {
+    clear();
+    dagee::releaseStorage(mNodes);
+    dagee::releaseStorage(mSuccOffsets);
+    dagee::releaseStorage(mSuccIndices);
+    dagee::releaseStorage(mPredOffsets);
+    dagee::releaseStorage(mPredIndices);
+    dagee::releaseStorage(mTopoOrder);
+    dagee::releaseStorage(mSources);
+    dagee::releaseStorage(mSinks);
+  }
+
+  bool valid(void) const noexcept { return mValid; }
+
+  Index size(void) const noexcept { return static_cast<Index>(mNodes.size()); }
+
+  size_t numEdges(void) const noexcept { return mSuccIndices.size(); }
+
+  NodePtr node(Index i) const {
+    assert(i < size() && "index out of range");
+    return mNodes[i];
+  }
+
+  const NodeVec& nodes(void) const noexcept { return mNodes; }
+
+  IndexRange successors(Index i) const {
+    assert(i < size() && "index out of range");
+    return IndexRange(mSuccIndices.data() + mSuccOffsets[i],
+                      mSuccIndices.data() + mSuccOffsets[i + 1]);
+  }
+
+  IndexRange predecessors(Index i) const {
+    assert(i < size() && "index out of range");
+    return IndexRange(mPredIndices.data() + mPredOffsets[i],
+                      mPredIndices.data() + mPredOffsets[i + 1]);
+  }
+
+  Index numSuccs(Index i) const { return mSuccOffsets[i + 1] - mSuccOffsets[i]; }
+
+  Index numPreds(Index i) const { return mPredOffsets[i + 1] - mPredOffsets[i]; }
+
+  bool isSrc(Index i) const { return numPreds(i) == 0; }
+
+  bool isSink(Index i) const { return numSuccs(i) == 0; }
+
+  const IndexVec& topoOrder(void) const noexcept { return mTopoOrder; }
+
+  const IndexVec& sources(void) const noexcept { return mSources; }
+
+  const IndexVec& sinks(void) const noexcept { return mSinks; }
+
+  template <typename F>
+  void forEachIndex_TopoOrder(F&& func) const {
+    for (Index i : mTopoOrder) {
+      func(i);
+    }
+  }
+};
+
+/**
+ * Decomposition of a DAG into levels (wavefronts) by longest-path depth: a
+ * source has level 0 and any other node has one more than the deepest of its
+ * predecessors. All predecessors of a node are in earlier levels, so the
+ * nodes of a level may run concurrently once the previous levels are done.
+ *
+ * Nodes are stored grouped by level in one contiguous array, delimited by an
+ * offset array. Built from a FrozenDAG and cached by DAGbase::computeLevels().
+ */
+template <typename NodePtr_tp, typename AllocFactory>
+class DAGlevels {
+ public:
+  using NodePtr = NodePtr_tp;
+  using Frozen = FrozenDAG<NodePtr, AllocFactory>;
+  using Index = typename Frozen::Index;
+  using IndexVec = typename Frozen::IndexVec;
+  using NodeVec = typename Frozen::NodeVec;
+
+  class Level {
+    const NodePtr* mBeg;
+    const NodePtr* mEnd;
+
+   public:
+    Level(const NodePtr* beg, const NodePtr* end) noexcept : mBeg(beg), mEnd(end) {}
+
+    const NodePtr* begin(void) const noexcept { return mBeg; }
+    const NodePtr* end(void) const noexcept { return mEnd; }
+    size_t size(void) const noexcept { return mEnd - mBeg; }
+    bool empty(void) const noexcept { return mBeg == mEnd; }
+    NodePtr operator[](size_t i) const noexcept { return mBeg[i]; }
+  };
+
+ protected:
+  bool mValid = false;
+  //! level of each node, by frozen index
+  IndexVec mLevelOf;
+  IndexVec mOffsets;
+  NodeVec mNodes;
+
+ public:
+  DAGlevels(void) = default;
+
+  template <typename A>
+  explicit DAGlevels(A& arena)
+      : mLevelOf(AllocFactory::template makeVec<Index>(arena)),
+        mOffsets(AllocFactory::template makeVec<Index>(arena)),
+        mNodes(AllocFactory::template makeVec<NodePtr>(arena)) {}
+
+  void build(const Frozen& fz) {
+    clear();
+    const Index N = fz.size();
+
+    mLevelOf.assign(N, 0);
+    Index numLevels = N ? 1 : 0;
+    for (Index i : fz.topoOrder()) {
+      Index l = 0;
+      for (Index p : fz.predecessors(i)) {
+        l = std::max(l, mLevelOf[p] + 1);
+      }
+      mLevelOf[i] = l;
+      numLevels = std::max(numLevels, l + 1);
+    }
+
+    // counting sort by level, stable w.r.t. frozen index
+    mOffsets.assign(numLevels + 1, 0);
+    for (Index i = 0; i < N; ++i) {
+      ++mOffsets[mLevelOf[i] + 1];
+    }
+    for (Index l = 0; l < numLevels; ++l) {
+      mOffsets[l + 1] += mOffsets[l];
+    }
+
+    mNodes.resize(N);
+    IndexVec cursor(mOffsets.cbegin(), mOffsets.cend());
+    for (Index i = 0; i < N; ++i) {
+      mNodes[cursor[mLevelOf[i]]++] = fz.node(i);
+    }
+
+    mValid = true;
+  }
+
+  void clear(void) {
+    mValid = false;
+    mLevelOf.clear();
+    mOffsets.clear();
+    mNodes.clear();
+  }
+
+  void releaseStorage(void) {
+    clear();
+    dagee::releaseStorage(mLevelOf);
+    dagee::releaseStorage(mOffsets);
+    dagee::releaseStorage(mNodes);
+  }
+
+  bool valid(void) const noexcept { return mValid; }
+
+  Index numLevels(void) const noexcept {
+    return mOffsets.empty() ? 0 : static_cast<Index>(mOffsets.size() - 1);
+  }
+
+  Level level(Index l) const {
+    assert(l < numLevels() && "level out of range");
+    return Level(mNodes.data() + mOffsets[l], mNodes.data() + mOffsets[l + 1]);
+  }
+
+  //! level of the node with frozen index i
+  Index levelOf(Index i) const { return mLevelOf[i]; }
+
+  //! size of the widest level, an upper bound on the parallelism available at once
+  size_t maxWidth(void) const {
+    size_t w = 0;
+    for (Index l = 0; l < numLevels(); ++l) {
+      w = std::max(w, level(l).size());
+    }
+    return w;
+  }
+
+  //! all nodes, level by level
+  const NodeVec& nodes(void) const noexcept { return mNodes; }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_FROZEN_DAG_H
@@ -5,48 +5,39 @@
 
 #include "dagee/ATMIdagExecutor.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
 namespace dagee {
 
+/**
+ * Executes DAGs level by level (see DAGbase::computeLevels) and writes a
+ * profile of the parallelism available at every step, i.e., in every level
+ * across all DAGs, to parallelismProfile.csv
+ */
 template <typename Exec, typename AllocFactory = dagee::StdAllocatorFactory<> >
 class DAGparallelismExecutor : public ATMIdagExecutor<Exec, AllocFactory> {
   using Base = ATMIdagExecutor<Exec, AllocFactory>;
 
  public:
   using typename Base::TaskInstance;
-  using DAG = typename DAGbase<TaskInstance, AllocFactory>::WithPredSucc;
-  using DAGptr = DAG*;
-  using Task = typename DAG::Task;
-  using TaskPtr = typename DAG::TaskPtr;
+  using typename Base::DAG;
+  using typename Base::DAGptr;
+  using typename Base::NodePtr;
 
  protected:
-  using DAGmgr = DAGmanager<DAG, AllocFactory>;
-  using TaskPtrVec = typename AllocFactory::template Vec<TaskPtr>;
-  using TaskQ = typename AllocFactory::template Deque<TaskPtr>;
   using ATMIhandleVec = typename AllocFactory::template Vec<ATMItaskHandle>;
-
-  struct DAGworklists {
-    DAGptr mDAG;
-    TaskPtrVec _mV0;
-    TaskPtrVec _mV1;
-    TaskPtrVec* mCurr = &_mV0;
-    TaskPtrVec* mNext = &_mV1;
-
-    explicit DAGworklists(DAGptr dag) : mDAG(dag) {}
-  };
-
-  using VecDAGworklists = typename AllocFactory::template Vec<DAGworklists>;
+  using Levels = typename DAG::Levels;
+  using LevelsPtrVec = typename AllocFactory::template Vec<const Levels*>;
 
   static constexpr unsigned WI_PER_WF = 64;
   const char* const DELIM = ", ";
 
   std::ofstream mOutFile;
-  DAGmgr mDAGmgr;
 
-  template <typename V>
-  void writeStep(size_t step, const V& vecDAGworklists) {
+  template <typename I>
+  void writeStep(size_t step, I dagBeg, const LevelsPtrVec& vecLevels) {
     size_t numTasks = 0;
 
     size_t numWI = 0;
@@ -54,11 +45,18 @@ class DAGparallelismExecutor : public ATMIdagExecutor<Exec, AllocFactory> {
 
     // TODO: add avg in-degree and avg out-degree
 
-    for (const auto& sd : vecDAGworklists) {
-      numTasks += sd.mCurr->size();
+    auto d = dagBeg;
+    for (const Levels* lv : vecLevels) {
+      DAGptr dag = *d++;
+      if (step >= lv->numLevels()) {
+        continue;
+      }
+
+      const auto& level = lv->level(step);
+      numTasks += level.size();
 
-      for (auto src : *sd.mCurr) {
-        const auto& ki = sd.mDAG->getTaskData(src);
+      for (NodePtr n : level) {
+        const auto& ki = dag->nodeData(n);
 
         numWI += (ki.mThreadsPerBlock.x * ki.mThreadsPerBlock.y * ki.mThreadsPerBlock.z) *
                  (ki.mBlocks.x * ki.mBlocks.y * ki.mBlocks.z);
@@ -70,59 +68,46 @@ class DAGparallelismExecutor : public ATMIdagExecutor<Exec, AllocFactory> {
   }
 
  public:
-  explicit DAGparallelismExecutor(void) : mOutFile("parallelismProfile.csv") {
+  explicit DAGparallelismExecutor(Exec& exec) : Base(exec), mOutFile("parallelismProfile.csv") {
     mOutFile << "Step" << DELIM << "numTasks" << DELIM << "numWF" << DELIM << "numWI" << std::endl;
   }
 
-  DAGptr makeDAG(void) { return mDAGmgr.makeDAG(); }
-
-  void destroyDAG(DAGptr d) { mDAGmgr.destroyDAG(d); }
-
+  /*
+   * Every step, for each DAG, we launch the nodes of the current level (and
+   * collect stats about them via writeStep()), then wait for them to finish
+   * before moving on to the next level
+   */
   template <typename DAGptrIter>
   void executeParallel(DAGptrIter beg, DAGptrIter end) {
-    VecDAGworklists vecDAGworklists;
-    vecDAGworklists.reserve(std::distance(beg, end));
+    LevelsPtrVec vecLevels;
+    vecLevels.reserve(std::distance(beg, end));
 
+    size_t numSteps = 0;
     for (auto i = beg; i != end; ++i) {
-      vecDAGworklists.emplace_back(*i);
-      auto& sd = vecDAGworklists.back();
-      sd.mDAG->collectInitialSources(*sd.mNext);
+      const Levels& lv = (*i)->computeLevels();
+      vecLevels.emplace_back(&lv);
+      numSteps = std::max(numSteps, size_t(lv.numLevels()));
     }
 
-    size_t step = 0;
-
-    /*
-     * Every iteration, for each DAG
-     *    we execute current sources (and collect stats about them
-     *    via writeStep().
-     *    Then we collect next set of sources in a new worklist. Swap worklists and
-     * repeat
-     */
-    while (true) {
-      bool done = true;
+    ATMIhandleVec handles;
 
-      for (auto& sd : vecDAGworklists) {
-        std::swap(sd.mNext, sd.mCurr);
-        sd.mNext->clear();
+    for (size_t step = 0; step < numSteps; ++step) {
+      writeStep(step, beg, vecLevels);
 
-        done = done && sd.mCurr->empty();
-      }
-
-      if (done) {
-        break;
-      }
-
-      writeStep(step, vecDAGworklists);
-      ++step;
-
-      for (auto& sd : vecDAGworklists) {
-        for (TaskPtr src : *sd.mCurr) {
-          const auto& kinst = sd.mDAG->getTaskData(src);
-          Base::launchKernel(kinst);
+      handles.clear();
+      auto d = beg;
+      for (const Levels* lv : vecLevels) {
+        DAGptr dag = *d++;
+        if (step >= lv->numLevels()) {
+          continue;
+        }
 
-          sd.mDAG->findNextSources(src, *sd.mNext);
+        for (NodePtr n : lv->level(step)) {
+          handles.emplace_back(Base::targetExec().launchTask(dag->nodeData(n)));
         }
       }
+
+      impl::waitOnTasks(handles.begin(), handles.end());
     }
   }
 
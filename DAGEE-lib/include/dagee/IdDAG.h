@@ -0,0 +1,555 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_ID_DAG_H
+#define DAGEE_INCLUDE_DAGEE_ID_DAG_H
+
+#include "dagee/AllocFactory.h"
+#include "dagee/ChainFusion.h"
+#include "dagee/FrozenDAG.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+
+namespace dagee {
+
+/**
+ * Storage for the adjacency lists of an IdDAGbase: all lists share one array
+ * of 32-bit node ids, each list owning a range of it. A full range moves to a
+ * range of twice its capacity, and the old one goes to a free list by size
+ * class, to be reused by other lists. Free lists are threaded through the
+ * array itself, so the pool holds no pointers and can be moved or copied as
+ * plain memory. compact() packs all ranges tightly.
+ */
+template <typename AllocFactory>
+class IdEdgePool {
+ public:
+  using Index = uint32_t;
+
+  struct Range {
+    Index mOff = 0;
+    Index mSize = 0;
+    Index mCap = 0;
+  };
+
+ protected:
+  using IndexVec = typename AllocFactory::template Vec<Index>;
+
+  constexpr static const Index NIL = std::numeric_limits<Index>::max();
+  constexpr static const unsigned NUM_CLASSES = 32;
+
+  IndexVec mPool;
+  //! first free range of capacity >= 2^k, for each size class k
+  Index mFreeHeads[NUM_CLASSES];
+
+  static unsigned floorLog2(Index x) noexcept {
+    assert(x > 0);
+    return 31 - __builtin_clz(x);
+  }
+
+  void resetFreeLists(void) noexcept { std::fill(mFreeHeads, mFreeHeads + NUM_CLASSES, NIL); }
+
+  //! @param k: size class, the range has capacity 2^k
+  Index allocRange(unsigned k) {
+    Index off = mFreeHeads[k];
+    if (off != NIL) {
+      mFreeHeads[k] = mPool[off];
+      return off;
+    }
+
+    const size_t cap = size_t(1) << k;
+    assert(mPool.size() + cap < NIL && "too many edges for 32-bit offsets");
+    off = static_cast<Index>(mPool.size());
+    mPool.resize(mPool.size() + cap);
+    return off;
+  }
+
+  void freeRange(const Range& r) {
+    if (r.mCap == 0) {
+      return;
+    }
+    // compacted ranges need not have a power of 2 capacity, hence the floor
+    unsigned k = floorLog2(r.mCap);
+    mPool[r.mOff] = mFreeHeads[k];
+    mFreeHeads[k] = r.mOff;
+  }
+
+  void grow(Range& r) {
+    unsigned k = r.mSize ? floorLog2(r.mSize) + 1 : 0;
+    Range nr;
+    nr.mOff = allocRange(k);
+    nr.mSize = r.mSize;
+    nr.mCap = Index(1) << k;
+
+    std::copy(mPool.cbegin() + r.mOff, mPool.cbegin() + r.mOff + r.mSize, mPool.begin() + nr.mOff);
+    freeRange(r);
+    r = nr;
+  }
+
+ public:
+  IdEdgePool(void) { resetFreeLists(); }
+
+  template <typename A>
+  explicit IdEdgePool(A& arena) : mPool(AllocFactory::template makeVec<Index>(arena)) {
+    resetFreeLists();
+  }
+
+  void push(Range& r, Index v) {
+    if (r.mSize == r.mCap) {
+      grow(r);
+    }
+    mPool[r.mOff + r.mSize++] = v;
+  }
+
+  const Index* begin(const Range& r) const noexcept { return mPool.data() + r.mOff; }
+
+  const Index* end(const Range& r) const noexcept { return mPool.data() + r.mOff + r.mSize; }
+
+  bool contains(const Range& r, Index v) const { return std::find(begin(r), end(r), v) != end(r); }
+
+  /**
+   * Move all ranges into a new array, back to back and with no spare capacity.
+   * @param forEachRange: invokes its argument on every Range in use, in order
+   */
+  template <typename F>
+  void compact(F&& forEachRange) {
+    IndexVec packed(mPool.get_allocator());
+    size_t total = 0;
+    forEachRange([&total](Range& r) { total += r.mSize; });
+    packed.reserve(total);
+
+    forEachRange([&packed, this](Range& r) {
+      Index off = static_cast<Index>(packed.size());
+      packed.insert(packed.end(), begin(r), end(r));
+      r.mOff = off;
+      r.mCap = r.mSize;
+    });
+
+    mPool.swap(packed);
+    resetFreeLists();
+  }
+
+  void clear(void) {
+    mPool.clear();
+    resetFreeLists();
+  }
+
+  void releaseStorage(void) {
+    clear();
+    dagee::releaseStorage(mPool);
+  }
+
+  //! bytes held by the pool, spare capacity and free ranges included
+  size_t sizeInBytes(void) const noexcept { return mPool.size() * sizeof(Index); }
+};
+
+namespace impl {
+
+//! adjacency of a node of IdDAGbase, for each combination of STORE_PRED and STORE_SUCC
+template <bool STORE_PRED, bool STORE_SUCC, typename Range>
+struct IdNode {};
+
+template <typename Range>
+struct IdNode<true, true, Range> {
+  Range mPreds;
+  Range mSuccs;
+
+  uint32_t numPreds(void) const noexcept { return mPreds.mSize; }
+  uint32_t numSuccs(void) const noexcept { return mSuccs.mSize; }
+};
+
+template <typename Range>
+struct IdNode<true, false, Range> {
+  Range mPreds;
+
+  uint32_t numPreds(void) const noexcept { return mPreds.mSize; }
+};
+
+template <typename Range>
+struct IdNode<false, true, Range> {
+  Range mSuccs;
+  uint32_t mNumPred = 0;
+
+  uint32_t numPreds(void) const noexcept { return mNumPred; }
+  uint32_t numSuccs(void) const noexcept { return mSuccs.mSize; }
+};
+
+} // end namespace impl
+
+/**
+ * A DAG addressed by 32-bit node ids instead of node pointers, for DAGs large
+ * enough that adjacency dominates memory. Nodes are numbered 0..N-1 in
+ * insertion order and live in one contiguous array, their data (the NodeData
+ * payload) in another, and their adjacency lists in an IdEdgePool as 32-bit
+ * ids, i.e., half the size of a DAGbase edge. Nothing refers to memory by
+ * address, so the whole DAG can be copied or moved as a few flat arrays, e.g.,
+ * to place it in shared memory through the AllocFactory.
+ *
+ * The interface follows DAGbase with NodePtr being the node id, so generic
+ * code, e.g., saveDAG/loadDAG, DAGlevels and DAGchains, works on either. A
+ * frozen IdDAG has frozen index == node id. Traversals in topological order
+ * freeze the DAG. Nodes can't be removed. Unlike DAGbase, hasEdge is linear in
+ * the degree, and the ranges returned by successors()/predecessors() are
+ * invalidated by adding edges.
+ */
+template <typename D, typename AllocFactory = dagee::StdAllocatorFactory<>, bool STORE_PRED = true,
+          bool STORE_SUCC = false>
+class IdDAGbase {
+ public:
+  using WithPred = IdDAGbase<D, AllocFactory, true, false>;
+  using WithSucc = IdDAGbase<D, AllocFactory, false, true>;
+  using WithPredSucc = IdDAGbase<D, AllocFactory, true, true>;
+  template <typename AF>
+  using withAllocFactory = IdDAGbase<D, AF, STORE_PRED, STORE_SUCC>;
+
+  using NodeID = uint32_t;
+  using NodePtr = NodeID;
+  using NodeData = D;
+  using IDty = size_t;
+  using AllocFactoryTy = AllocFactory;
+  using EdgePool = IdEdgePool<AllocFactory>;
+  using Node = impl::IdNode<STORE_PRED, STORE_SUCC, typename EdgePool::Range>;
+  using Frozen = FrozenDAG<NodeID, AllocFactory>;
+  using Index = typename Frozen::Index;
+  using Levels = DAGlevels<NodeID, AllocFactory>;
+  using Chains = DAGchains<NodeID, AllocFactory>;
+
+  constexpr static const NodeID INVALID_ID = std::numeric_limits<NodeID>::max();
+
+  class IdRange {
+    const NodeID* mBeg;
+    const NodeID* mEnd;
+
+   public:
+    IdRange(const NodeID* beg, const NodeID* end) noexcept : mBeg(beg), mEnd(end) {}
+
+    const NodeID* begin(void) const noexcept { return mBeg; }
+    const NodeID* end(void) const noexcept { return mEnd; }
+    size_t size(void) const noexcept { return mEnd - mBeg; }
+    bool empty(void) const noexcept { return mBeg == mEnd; }
+    NodeID operator[](size_t i) const noexcept { return mBeg[i]; }
+  };
+
+ protected:
+  using NodeVec = typename AllocFactory::template Vec<Node>;
+  using DataVec = typename AllocFactory::template Vec<D>;
+  using IdVec = typename AllocFactory::template Vec<NodeID>;
+  using Arena = typename AllocFactory::Arena;
+
+  //! must precede the members using it
+  Arena mArena;
+  NodeVec mNodes = AllocFactory::template makeVec<Node>(mArena);
+  DataVec mData = AllocFactory::template makeVec<D>(mArena);
+  EdgePool mEdges{mArena};
+  size_t mNumEdges = 0;
+  //! CSR snapshot built by freeze(), invalidated by any modification
+  Frozen mFrozen{mArena};
+  Levels mLevels{mArena};
+  Chains mChains{mArena};
+
+  void thaw(void) {
+    if (mFrozen.valid()) {
+      mFrozen.clear();
+    }
+    if (mLevels.valid()) {
+      mLevels.clear();
+    }
+    if (mChains.valid()) {
+      mChains.clear();
+    }
+  }
+
+  template <bool S = STORE_SUCC>
+  typename std::enable_if<S>::type addSucc(NodeID a, NodeID b) {
+    assert(!mEdges.contains(mNodes[a].mSuccs, b) && "duplicate edge");
+    mEdges.push(mNodes[a].mSuccs, b);
+  }
+
+  template <bool S = STORE_SUCC>
+  typename std::enable_if<!S>::type addSucc(NodeID, NodeID) {}
+
+  template <bool P = STORE_PRED>
+  typename std::enable_if<P>::type addPred(NodeID a, NodeID b) {
+    assert(!mEdges.contains(mNodes[b].mPreds, a) && "duplicate edge");
+    mEdges.push(mNodes[b].mPreds, a);
+  }
+
+  template <bool P = STORE_PRED>
+  typename std::enable_if<!P>::type addPred(NodeID, NodeID b) {
+    ++mNodes[b].mNumPred;
+  }
+
+  template <typename G, bool S = STORE_SUCC>
+  typename std::enable_if<S>::type forEachEdge(G& edgeFn) const {
+    for (NodeID a = 0; a < numNodes(); ++a) {
+      for (NodeID b : successors(a)) {
+        edgeFn(a, b);
+      }
+    }
+  }
+
+  template <typename G, bool S = STORE_SUCC>
+  typename std::enable_if<!S>::type forEachEdge(G& edgeFn) const {
+    for (NodeID b = 0; b < numNodes(); ++b) {
+      for (NodeID a : predecessors(b)) {
+        edgeFn(a, b);
+      }
+    }
+  }
+
+  struct ForEachEdge {
+    const IdDAGbase& mDag;
+
+    template <typename G>
+    void operator()(G&& edgeFn) const {
+      mDag.forEachEdge(edgeFn);
+    }
+  };
+
+  struct ForEachRange {
+    IdDAGbase& mDag;
+
+    template <typename F>
+    void operator()(F&& func) const {
+      mDag.forEachRange(func);
+    }
+  };
+
+  template <typename F, bool P = STORE_PRED, bool S = STORE_SUCC>
+  typename std::enable_if<P && S>::type forEachRange(F& func) {
+    for (Node& n : mNodes) {
+      func(n.mPreds);
+      func(n.mSuccs);
+    }
+  }
+
+  template <typename F, bool P = STORE_PRED, bool S = STORE_SUCC>
+  typename std::enable_if<P && !S>::type forEachRange(F& func) {
+    for (Node& n : mNodes) {
+      func(n.mPreds);
+    }
+  }
+
+  template <typename F, bool P = STORE_PRED, bool S = STORE_SUCC>
+  typename std::enable_if<!P && S>::type forEachRange(F& func) {
+    for (Node& n : mNodes) {
+      func(n.mSuccs);
+    }
+  }
+
+ public:
+  IdDAGbase(void) = default;
+
+  IdDAGbase(const IdDAGbase&) = delete;
+  IdDAGbase& operator=(const IdDAGbase&) = delete;
+
+  template <typename... Args>
+  NodeID addNode(Args&&... args) {
+    thaw();
+    assert(mNodes.size() < INVALID_ID && "too many nodes for 32-bit ids");
+    mData.emplace_back(std::forward<Args>(args)...);
+    mNodes.emplace_back();
+    return static_cast<NodeID>(mNodes.size() - 1);
+  }
+
+  void addEdge(NodeID a, NodeID b) {
+    assert(a < numNodes() && b < numNodes() && "node id out of range");
+    assert(a != b && "cannot add self edge, i.e., src==dst");
+    thaw();
+    addSucc(a, b);
+    addPred(a, b);
+    ++mNumEdges;
+  }
+
+  void addFanOutEdges(NodeID a, std::initializer_list<NodeID> lb) {
+    for (auto b : lb) {
+      addEdge(a, b);
+    }
+  }
+
+  void addFanInEdges(std::initializer_list<NodeID> la, NodeID b) {
+    for (auto a : la) {
+      addEdge(a, b);
+    }
+  }
+
+  template <bool P = STORE_PRED, bool S = STORE_SUCC,
+            typename std::enable_if<P && S, int>::type = 0>
+  bool hasEdge(NodeID a, NodeID b) const {
+    // both sides hold the edge, so search the shorter list
+    if (mNodes[a].numSuccs() <= mNodes[b].numPreds()) {
+      return mEdges.contains(mNodes[a].mSuccs, b);
+    }
+    return mEdges.contains(mNodes[b].mPreds, a);
+  }
+
+  template <bool P = STORE_PRED, bool S = STORE_SUCC,
+            typename std::enable_if<P && !S, int>::type = 0>
+  bool hasEdge(NodeID a, NodeID b) const {
+    return mEdges.contains(mNodes[b].mPreds, a);
+  }
+
+  template <bool P = STORE_PRED, bool S = STORE_SUCC,
+            typename std::enable_if<!P && S, int>::type = 0>
+  bool hasEdge(NodeID a, NodeID b) const {
+    return mEdges.contains(mNodes[a].mSuccs, b);
+  }
+
+  void addEdgeIfAbsent(NodeID a, NodeID b) {
+    assert(a != b && "cannot add self edge, i.e., src==dst");
+    if (!hasEdge(a, b)) {
+      addEdge(a, b);
+    }
+  }
+
+  template <bool S = STORE_SUCC, typename std::enable_if<S, int>::type = 0>
+  IdRange successors(NodeID a) const {
+    const auto& r = mNodes[a].mSuccs;
+    return IdRange(mEdges.begin(r), mEdges.end(r));
+  }
+
+  template <bool P = STORE_PRED, typename std::enable_if<P, int>::type = 0>
+  IdRange predecessors(NodeID a) const {
+    const auto& r = mNodes[a].mPreds;
+    return IdRange(mEdges.begin(r), mEdges.end(r));
+  }
+
+  const D& nodeData(NodeID n) const { return mData[n]; }
+
+  D& nodeData(NodeID n) { return mData[n]; }
+
+  //! payload of all nodes, by node id
+  const DataVec& allNodeData(void) const noexcept { return mData; }
+
+  bool isSrc(NodeID n) const { return mNodes[n].numPreds() == 0; }
+
+  template <bool S = STORE_SUCC>
+  typename std::enable_if<S, bool>::type isSink(NodeID n) const {
+    return mNodes[n].numSuccs() == 0;
+  }
+
+  NodeID numNodes(void) const noexcept { return static_cast<NodeID>(mNodes.size()); }
+
+  size_t numEdges(void) const noexcept { return mNumEdges; }
+
+  //! number of nodes and edges, as DAGbase::size
+  std::pair<size_t, size_t> size(void) const { return std::make_pair(mNodes.size(), mNumEdges); }
+
+  //! bytes held by the nodes, edges and payload, spare capacity of the edge pool included
+  size_t sizeInBytes(void) const noexcept {
+    return mNodes.size() * sizeof(Node) + mData.size() * sizeof(D) + mEdges.sizeInBytes();
+  }
+
+  /**
+   * Pack the adjacency lists back to back, e.g., once the DAG is complete and
+   * before copying it elsewhere. Later edges still work, at the cost of moving
+   * the lists they are added to.
+   */
+  void compact(void) { mEdges.compact(ForEachRange{*this}); }
+
+  void clear(void) {
+    thaw();
+    mNodes.clear();
+    mData.clear();
+    mEdges.clear();
+    mNumEdges = 0;
+
+    if (AllocFactory::RELEASES_IN_BULK) {
+      mFrozen.releaseStorage();
+      mLevels.releaseStorage();
+      mChains.releaseStorage();
+      mEdges.releaseStorage();
+      dagee::releaseStorage(mNodes);
+      dagee::releaseStorage(mData);
+      mArena.reset();
+    }
+  }
+
+  //! build the CSR snapshot, see DAGbase::freeze. Frozen indices are node ids
+  void freeze(void) {
+    if (mFrozen.valid()) {
+      return;
+    }
+
+    IdVec ids(numNodes());
+    std::iota(ids.begin(), ids.end(), NodeID(0));
+    mFrozen.build(ids, ForEachEdge{*this});
+  }
+
+  bool isFrozen(void) const { return mFrozen.valid(); }
+
+  const Frozen& frozen(void) const {
+    assert(isFrozen() && "DAG must be frozen first");
+    return mFrozen;
+  }
+
+  //! see DAGbase::computeLevels
+  const Levels& computeLevels(void) {
+    if (!mLevels.valid()) {
+      freeze();
+      mLevels.build(mFrozen);
+    }
+    return mLevels;
+  }
+
+  //! see DAGbase::computeChains
+  const Chains& computeChains(void) {
+    if (!mChains.valid()) {
+      freeze();
+      mChains.build(mFrozen);
+    }
+    return mChains;
+  }
+
+  template <typename F>
+  void forEachNode(F&& func) {
+    for (NodeID n = 0; n < numNodes(); ++n) {
+      func(n);
+    }
+  }
+
+  template <typename F>
+  void forEachSource(F&& func) {
+    for (NodeID n = 0; n < numNodes(); ++n) {
+      if (isSrc(n)) {
+        func(n);
+      }
+    }
+  }
+
+  template <typename F>
+  void forEachSink(F&& func) {
+    freeze();
+    for (Index i : mFrozen.sinks()) {
+      func(i);
+    }
+  }
+
+  //! visit all nodes such that a node is visited after all its predecessors. Freezes the DAG
+  template <typename F>
+  void forEachNode_TopoOrder(F&& func) {
+    freeze();
+    for (Index i : mFrozen.topoOrder()) {
+      func(i);
+    }
+  }
+};
+
+template <typename D, typename AllocFactory, bool STORE_PRED, bool STORE_SUCC>
+constexpr typename IdDAGbase<D, AllocFactory, STORE_PRED, STORE_SUCC>::NodeID
+    IdDAGbase<D, AllocFactory, STORE_PRED, STORE_SUCC>::INVALID_ID;
+
+template <typename AllocFactory>
+constexpr typename IdEdgePool<AllocFactory>::Index IdEdgePool<AllocFactory>::NIL;
+
+template <typename AllocFactory>
+constexpr unsigned IdEdgePool<AllocFactory>::NUM_CLASSES;
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_ID_DAG_H
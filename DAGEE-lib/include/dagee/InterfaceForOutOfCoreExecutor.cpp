@@ -8,19 +8,47 @@ int main() {
   ex.registerKernel<types...>(kernelFunc0);
   ex.registerKernel<types...>(kernelFunc1);
 
-  ex.makeDeviceDataBuffers(hostData[0], numBuffers); // based on some budget
+  // Manual: one Partition per chunk, and the number of buffers picked by hand
+  {
+    ex.makeDeviceDataBuffers(hostData[0], numBuffers); // based on some budget
 
-  auto partDAG = ex.makePartitionDAG(dagPtr);
+    auto partDAG = ex.makePartitionDAG(dagPtr);
 
-  for (i = 0; i < numPartitions; ++i) {
-    auto dagPtr = ex.makeDAG();
-    partDAG->addNode(Partition(dagPtr, &hostData[i]));
-  }
-  while (someCond) {
-    partDAG->addEdge(srcPart, dstPart);
+    for (i = 0; i < numPartitions; ++i) {
+      auto dagPtr = ex.makeDAG();
+      partDAG->addNode(Partition(dagPtr, &hostData[i]));
+    }
+    while (someCond) {
+      partDAG->addEdge(srcPart, dstPart);
+    }
+
+    ex.prepareDAG(partDAG);
+
+    ex.executeDAG(partDAG);
   }
 
-  ex.prepareDAG(partDAG);
+  // Automatic: a fine-grained task DAG, annotated with the buffers of each task, is
+  // partitioned to fit a device memory budget
+  {
+    taskDAG->freeze();
+
+    dagee::OutOfCoreBudget budget(deviceBytes, 2);
+    dagee::OutOfCorePartitioner<TaskNodePtr, AllocFactory> plan;
+    plan.build(taskDAG->frozen(), [](TaskNodePtr n, BufferUseVec& out) {
+      for (auto& b : buffersOf(n)) {
+        out.push_back(dagee::BufferUse{b.id, b.bytes});
+      }
+    }, budget);
 
-  ex.executeDAG(partDAG);
+    ex.makeDeviceDataBuffers(hostDataSizedFor(plan.maxPartitionBytes()), budget.mNumResident);
+
+    auto partDAG = ex.makePartitionDAG(plan, [&](Index p) {
+      // host data from plan.buffers(p), fill func adding plan.tasks(p) to the partition's DAG
+      return Partition(fillWith(plan.tasks(p)), hostDataFor(plan.buffers(p)));
+    });
+
+    ex.preparePartitionDAG(partDAG);
+
+    ex.executePartitionDAG(partDAG);
+  }
 }
@@ -6,6 +6,7 @@
 #include "dagee/ATMIdagExecutor.h"
 #include "dagee/AllocFactory.h"
 #include "dagee/NullKernel.h"
+#include "dagee/OutOfCorePartitioner.h"
 #include "dagee/Partition.h"
 
 #include "atmi.h"
@@ -199,6 +200,29 @@ class OutOfCoreATMIexecutor : private ATMIdagExecutor<Exec, AllocFactory> {
 
   PartitionDAGptr makePartitionDAG(void) { return mPartDAGmgr.makeDAG(); }
 
+  /**
+   * Make the partition DAG for the partitions computed by plan, an
+   * OutOfCorePartitioner. makePartition(p) returns the Partition running the
+   * tasks of partition p on its buffers, and the edges come from the plan. The
+   * device data buffers should number mNumResident of the budget of the plan,
+   * each sized for plan.maxPartitionBytes()
+   */
+  template <typename Plan, typename F>
+  PartitionDAGptr makePartitionDAG(const Plan& plan, const F& makePartition) {
+    assert(plan.valid() && "partitioner not built");
+    PartitionDAGptr partDAG = makePartitionDAG();
+
+    typename AllocFactory::template Vec<PartNodePtr> partNodes;
+    for (typename Plan::Index p = 0; p < plan.numPartitions(); ++p) {
+      partNodes.emplace_back(partDAG->addNode(makePartition(p)));
+    }
+
+    for (const auto& e : plan.partitionEdges()) {
+      partDAG->addEdge(partNodes[e.first], partNodes[e.second]);
+    }
+    return partDAG;
+  }
+
   void makeDeviceDataBuffers(const HostData& dataTemplate, size_t numBuffers) {
     freeDeviceData();
 
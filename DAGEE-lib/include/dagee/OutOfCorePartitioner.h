@@ -0,0 +1,329 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_OUT_OF_CORE_PARTITIONER_H
+#define DAGEE_INCLUDE_DAGEE_OUT_OF_CORE_PARTITIONER_H
+
+#include "dagee/FrozenDAG.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace dagee {
+
+//! a buffer read or written by a task, with its size. Ids need not be dense
+struct BufferUse {
+  uint64_t mId;
+  size_t mBytes;
+};
+
+struct OutOfCoreBudget {
+  //! device memory available for partition data
+  size_t mDeviceBytes;
+  //! partitions resident on the device at a time, 2 to overlap copies of one with the
+  //! kernels of another
+  size_t mNumResident;
+  //! number of ready tasks considered at each step, see OutOfCorePartitioner
+  size_t mLookahead;
+
+  explicit OutOfCoreBudget(size_t deviceBytes, size_t numResident = 2, size_t lookahead = 32)
+      : mDeviceBytes(deviceBytes), mNumResident(numResident), mLookahead(lookahead) {
+    assert(numResident > 0 && lookahead > 0 && "invalid out-of-core budget");
+  }
+
+  size_t bytesPerPartition(void) const noexcept { return mDeviceBytes / mNumResident; }
+};
+
+/**
+ * Splits a fine-grained task DAG into partitions whose buffers fit in a share
+ * of device memory, for OutOfCoreATMIexecutor. A partition copies in the
+ * buffers used by its tasks, runs them, and copies the buffers back out.
+ *
+ * Partitions are packed in topological order: each step picks, among the first
+ * mLookahead ready tasks, the one adding the fewest new bytes to the open
+ * partition, ties going to the task with the most predecessors in it. The
+ * partition is closed when that task doesn't fit. Preferring tasks whose
+ * buffers are resident already keeps the bytes transferred low, and preferring
+ * those whose predecessors are keeps the cut edges low. As partitions follow a
+ * topological order, every edge between partitions goes from an earlier
+ * partition to a later one, so the partition DAG is acyclic.
+ *
+ * A task whose buffers alone exceed the share gets a partition of its own and
+ * is counted by numOversized().
+ */
+template <typename NodePtr_tp, typename AllocFactory>
+class OutOfCorePartitioner {
+ public:
+  using NodePtr = NodePtr_tp;
+  using Frozen = FrozenDAG<NodePtr, AllocFactory>;
+  using Index = typename Frozen::Index;
+  using IndexVec = typename Frozen::IndexVec;
+  using NodeVec = typename Frozen::NodeVec;
+  using BufferUseVec = typename AllocFactory::template Vec<BufferUse>;
+  using BufferIdVec = typename AllocFactory::template Vec<uint64_t>;
+  using SizeVec = typename AllocFactory::template Vec<size_t>;
+  using PartEdge = std::pair<Index, Index>;
+  using PartEdgeVec = typename AllocFactory::template Vec<PartEdge>;
+
+  template <typename T>
+  class Range {
+    const T* mBeg;
+    const T* mEnd;
+
+   public:
+    Range(const T* beg, const T* end) noexcept : mBeg(beg), mEnd(end) {}
+
+    const T* begin(void) const noexcept { return mBeg; }
+    const T* end(void) const noexcept { return mEnd; }
+    size_t size(void) const noexcept { return mEnd - mBeg; }
+  };
+
+ protected:
+  bool mValid = false;
+  //! partition of each task, by frozen index
+  IndexVec mPartOf;
+  //! tasks of each partition, in topological order, delimited by mPartOffsets
+  IndexVec mPartOffsets;
+  NodeVec mNodes;
+  //! buffers of each partition, delimited by mBufOffsets
+  IndexVec mBufOffsets;
+  BufferIdVec mBufIds;
+  SizeVec mPartBytes;
+  PartEdgeVec mPartEdges;
+  size_t mNumCutEdges = 0;
+  size_t mNumOversized = 0;
+
+  //! footprints of all tasks in CSR form, with buffer ids made dense
+  struct Footprints {
+    IndexVec mOffsets;
+    IndexVec mBufs;
+    SizeVec mBufBytes;
+    BufferIdVec mBufIds;
+
+    template <typename F>
+    void build(const Frozen& fz, const F& footprint) {
+      typename AllocFactory::template HashMap<uint64_t, Index> dense;
+      BufferUseVec uses;
+
+      mOffsets.reserve(fz.size() + 1);
+      for (Index i = 0; i < fz.size(); ++i) {
+        mOffsets.emplace_back(static_cast<Index>(mBufs.size()));
+
+        uses.clear();
+        footprint(fz.node(i), uses);
+
+        for (const auto& u : uses) {
+          auto it = dense.find(u.mId);
+          if (it == dense.end()) {
+            it = dense.emplace(u.mId, static_cast<Index>(mBufBytes.size())).first;
+            mBufBytes.emplace_back(u.mBytes);
+            mBufIds.emplace_back(u.mId);
+          }
+          assert(mBufBytes[it->second] == u.mBytes && "buffer reported with different sizes");
+          mBufs.emplace_back(it->second);
+        }
+      }
+      mOffsets.emplace_back(static_cast<Index>(mBufs.size()));
+    }
+
+    Range<Index> of(Index i) const {
+      return Range<Index>(mBufs.data() + mOffsets[i], mBufs.data() + mOffsets[i + 1]);
+    }
+  };
+
+  void openPartition(void) {
+    mPartOffsets.emplace_back(static_cast<Index>(mNodes.size()));
+    mBufOffsets.emplace_back(static_cast<Index>(mBufIds.size()));
+    mPartBytes.emplace_back(0);
+  }
+
+  void closePartitions(void) {
+    mPartOffsets.emplace_back(static_cast<Index>(mNodes.size()));
+    mBufOffsets.emplace_back(static_cast<Index>(mBufIds.size()));
+  }
+
+  void collectPartEdges(const Frozen& fz) {
+    for (Index a = 0; a < fz.size(); ++a) {
+      for (Index b : fz.successors(a)) {
+        if (mPartOf[a] != mPartOf[b]) {
+          assert(mPartOf[a] < mPartOf[b] && "partitions out of topological order");
+          ++mNumCutEdges;
+          mPartEdges.emplace_back(mPartOf[a], mPartOf[b]);
+        }
+      }
+    }
+
+    std::sort(mPartEdges.begin(), mPartEdges.end());
+    mPartEdges.erase(std::unique(mPartEdges.begin(), mPartEdges.end()), mPartEdges.end());
+  }
+
+ public:
+  OutOfCorePartitioner(void) = default;
+
+  /**
+   * @param footprint: footprint(NodePtr n, BufferUseVec& out) appends to out
+   * the buffers used by the task of n, each once
+   */
+  template <typename F>
+  void build(const Frozen& fz, const F& footprint, const OutOfCoreBudget& budget) {
+    clear();
+    const Index N = fz.size();
+    const Index NONE = Frozen::INVALID_INDEX;
+    const size_t maxBytes = budget.bytesPerPartition();
+
+    Footprints fp;
+    fp.build(fz, footprint);
+
+    // partition that last copied in each buffer
+    IndexVec lastPart(fp.mBufBytes.size(), NONE);
+    IndexVec depCounts(N, 0);
+    for (Index i = 0; i < N; ++i) {
+      depCounts[i] = fz.numPreds(i);
+    }
+    mPartOf.assign(N, NONE);
+    mNodes.reserve(N);
+
+    typename AllocFactory::template Deque<Index> ready(fz.sources().cbegin(),
+                                                       fz.sources().cend());
+
+    Index cur = 0;
+    openPartition();
+
+    auto newBytes = [&](Index i) {
+      size_t b = 0;
+      for (Index u : fp.of(i)) {
+        b += (lastPart[u] == cur) ? 0 : fp.mBufBytes[u];
+      }
+      return b;
+    };
+
+    auto numLocalPreds = [&](Index i) {
+      Index n = 0;
+      for (Index p : fz.predecessors(i)) {
+        n += (mPartOf[p] == cur) ? 1 : 0;
+      }
+      return n;
+    };
+
+    while (!ready.empty()) {
+      const size_t numCand = std::min(ready.size(), budget.mLookahead);
+
+      size_t best = 0;
+      size_t bestBytes = newBytes(ready[0]);
+      Index bestLocal = numLocalPreds(ready[0]);
+      for (size_t k = 1; k < numCand; ++k) {
+        size_t b = newBytes(ready[k]);
+        if (b > bestBytes) {
+          continue;
+        }
+        Index l = numLocalPreds(ready[k]);
+        if (b < bestBytes || l > bestLocal) {
+          best = k;
+          bestBytes = b;
+          bestLocal = l;
+        }
+      }
+
+      const bool isEmpty = mNodes.size() == mPartOffsets.back();
+      if (!isEmpty && mPartBytes.back() + bestBytes > maxBytes) {
+        ++cur;
+        openPartition();
+        continue; // pick again, now that nothing is resident
+      }
+
+      const Index i = ready[best];
+      ready.erase(ready.begin() + best);
+
+      mPartOf[i] = cur;
+      mNodes.emplace_back(fz.node(i));
+      for (Index u : fp.of(i)) {
+        if (lastPart[u] != cur) {
+          lastPart[u] = cur;
+          mBufIds.emplace_back(fp.mBufIds[u]);
+        }
+      }
+      mPartBytes.back() += bestBytes;
+
+      if (isEmpty && bestBytes > maxBytes) {
+        ++mNumOversized;
+      }
+
+      for (Index s : fz.successors(i)) {
+        if (--depCounts[s] == 0) {
+          ready.push_back(s);
+        }
+      }
+    }
+
+    closePartitions();
+    assert(mNodes.size() == N && "cycle detected, graph is not a DAG");
+
+    collectPartEdges(fz);
+    mValid = true;
+  }
+
+  void clear(void) {
+    mValid = false;
+    mPartOf.clear();
+    mPartOffsets.clear();
+    mNodes.clear();
+    mBufOffsets.clear();
+    mBufIds.clear();
+    mPartBytes.clear();
+    mPartEdges.clear();
+    mNumCutEdges = 0;
+    mNumOversized = 0;
+  }
+
+  bool valid(void) const noexcept { return mValid; }
+
+  Index numPartitions(void) const noexcept {
+    return mPartOffsets.empty() ? 0 : static_cast<Index>(mPartOffsets.size() - 1);
+  }
+
+  //! partition of the node with frozen index i
+  Index partitionOf(Index i) const { return mPartOf[i]; }
+
+  //! tasks of partition p, in topological order
+  Range<NodePtr> tasks(Index p) const {
+    assert(p < numPartitions() && "partition out of range");
+    return Range<NodePtr>(mNodes.data() + mPartOffsets[p], mNodes.data() + mPartOffsets[p + 1]);
+  }
+
+  //! ids of the buffers partition p copies in and out
+  Range<uint64_t> buffers(Index p) const {
+    assert(p < numPartitions() && "partition out of range");
+    return Range<uint64_t>(mBufIds.data() + mBufOffsets[p], mBufIds.data() + mBufOffsets[p + 1]);
+  }
+
+  size_t partitionBytes(Index p) const { return mPartBytes[p]; }
+
+  size_t maxPartitionBytes(void) const {
+    return mPartBytes.empty() ? 0 : *std::max_element(mPartBytes.cbegin(), mPartBytes.cend());
+  }
+
+  //! edges (src, dst) of the partition DAG, without duplicates, src < dst
+  const PartEdgeVec& partitionEdges(void) const noexcept { return mPartEdges; }
+
+  //! task edges whose ends are in different partitions
+  size_t numCutEdges(void) const noexcept { return mNumCutEdges; }
+
+  //! bytes copied to the device. As many are copied back
+  size_t bytesTransferred(void) const {
+    size_t sum = 0;
+    for (size_t b : mPartBytes) {
+      sum += b;
+    }
+    return sum;
+  }
+
+  size_t numOversized(void) const noexcept { return mNumOversized; }
+
+  //! whether every partition fits in its share of the budget
+  bool fits(void) const noexcept { return mNumOversized == 0; }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_OUT_OF_CORE_PARTITIONER_H
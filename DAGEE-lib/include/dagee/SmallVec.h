@@ -0,0 +1,218 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_SMALL_VEC_H
+#define DAGEE_INCLUDE_DAGEE_SMALL_VEC_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace dagee {
+
+/**
+ * Vector with inline storage for the first N elements. It only allocates from
+ * Alloc once the size exceeds N. Meant for adjacency lists, where most nodes
+ * have a handful of neighbors. Restricted to trivially copyable T (pointers,
+ * indices) so that elements can be moved around with memcpy.
+ */
+template <typename T, size_t N, typename Alloc = std::allocator<T> >
+class SmallVec {
+  static_assert(std::is_trivially_copyable<T>::value, "SmallVec needs trivially copyable T");
+  static_assert(N > 0, "inline capacity must be positive");
+
+  using AllocTraits = std::allocator_traits<Alloc>;
+  using Size = uint32_t;
+
+ public:
+  using value_type = T;
+  using allocator_type = Alloc;
+  using size_type = size_t;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+
+  constexpr static const size_t INLINE_CAPACITY = N;
+
+ private:
+  Alloc mAlloc;
+  T* mData;
+  Size mSize;
+  Size mCap;
+  typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type mInline;
+
+  T* inlineData(void) noexcept { return reinterpret_cast<T*>(&mInline); }
+  const T* inlineData(void) const noexcept { return reinterpret_cast<const T*>(&mInline); }
+
+  bool isInline(void) const noexcept { return mData == inlineData(); }
+
+  void freeHeap(void) noexcept {
+    if (!isInline()) {
+      AllocTraits::deallocate(mAlloc, mData, mCap);
+    }
+  }
+
+  void grow(size_t minCap) {
+    size_t newCap = 2 * size_t(mCap);
+    if (newCap < minCap) {
+      newCap = minCap;
+    }
+    T* p = AllocTraits::allocate(mAlloc, newCap);
+    assert(p && "allocation failed");
+    std::memcpy(p, mData, mSize * sizeof(T));
+    freeHeap();
+    mData = p;
+    mCap = static_cast<Size>(newCap);
+  }
+
+  void copyFrom(const T* src, size_t n) {
+    if (n > mCap) {
+      grow(n);
+    }
+    std::memcpy(mData, src, n * sizeof(T));
+    mSize = static_cast<Size>(n);
+  }
+
+  //! take over that's heap buffer or copy its inline elements
+  void stealFrom(SmallVec& that) noexcept {
+    if (that.isInline()) {
+      std::memcpy(inlineData(), that.inlineData(), that.mSize * sizeof(T));
+      mData = inlineData();
+      mCap = N;
+    } else {
+      mData = that.mData;
+      mCap = that.mCap;
+    }
+    mSize = that.mSize;
+    that.mData = that.inlineData();
+    that.mSize = 0;
+    that.mCap = N;
+  }
+
+ public:
+  explicit SmallVec(const Alloc& a = Alloc()) noexcept
+      : mAlloc(a), mData(inlineData()), mSize(0), mCap(N) {}
+
+  SmallVec(const SmallVec& that)
+      : mAlloc(AllocTraits::select_on_container_copy_construction(that.mAlloc)),
+        mData(inlineData()),
+        mSize(0),
+        mCap(N) {
+    copyFrom(that.mData, that.mSize);
+  }
+
+  SmallVec(SmallVec&& that) noexcept : mAlloc(std::move(that.mAlloc)) { stealFrom(that); }
+
+  SmallVec& operator=(const SmallVec& that) {
+    if (this != &that) {
+      mSize = 0;
+      copyFrom(that.mData, that.mSize);
+    }
+    return *this;
+  }
+
+  SmallVec& operator=(SmallVec&& that) {
+    if (this != &that) {
+      if (mAlloc == that.mAlloc) {
+        freeHeap();
+        stealFrom(that);
+      } else {
+        mSize = 0;
+        copyFrom(that.mData, that.mSize);
+        that.clear();
+      }
+    }
+    return *this;
+  }
+
+  ~SmallVec(void) { freeHeap(); }
+
+  allocator_type get_allocator(void) const { return mAlloc; }
+
+  iterator begin(void) noexcept { return mData; }
+  iterator end(void) noexcept { return mData + mSize; }
+  const_iterator begin(void) const noexcept { return mData; }
+  const_iterator end(void) const noexcept { return mData + mSize; }
+  const_iterator cbegin(void) const noexcept { return mData; }
+  const_iterator cend(void) const noexcept { return mData + mSize; }
+
+  T* data(void) noexcept { return mData; }
+  const T* data(void) const noexcept { return mData; }
+
+  size_t size(void) const noexcept { return mSize; }
+  size_t capacity(void) const noexcept { return mCap; }
+  bool empty(void) const noexcept { return mSize == 0; }
+
+  T& operator[](size_t i) noexcept {
+    assert(i < mSize && "index out of range");
+    return mData[i];
+  }
+
+  const T& operator[](size_t i) const noexcept {
+    assert(i < mSize && "index out of range");
+    return mData[i];
+  }
+
+  T& back(void) noexcept {
+    assert(!empty());
+    return mData[mSize - 1];
+  }
+
+  const T& back(void) const noexcept {
+    assert(!empty());
+    return mData[mSize - 1];
+  }
+
+  void reserve(size_t n) {
+    if (n > mCap) {
+      grow(n);
+    }
+  }
+
+  void push_back(const T& x) {
+    if (mSize == mCap) {
+      grow(mSize + 1);
+    }
+    mData[mSize++] = x;
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    push_back(T(std::forward<Args>(args)...));
+  }
+
+  void pop_back(void) noexcept {
+    assert(!empty());
+    --mSize;
+  }
+
+  //! removes the element at pos, preserving the order of the rest
+  iterator erase(const_iterator pos) noexcept {
+    assert(pos >= cbegin() && pos < cend() && "invalid position");
+    T* p = mData + (pos - mData);
+    std::memmove(p, p + 1, (end() - p - 1) * sizeof(T));
+    --mSize;
+    return p;
+  }
+
+  void clear(void) noexcept { mSize = 0; }
+
+  void swap(SmallVec& that) {
+    SmallVec tmp(std::move(that));
+    that = std::move(*this);
+    *this = std::move(tmp);
+  }
+};
+
+//! inline capacity of adjacency lists: 32 bytes worth of elements, i.e., 4 pointers
+template <typename T>
+struct AdjInlineCapacity {
+  constexpr static const size_t value = sizeof(T) >= 32 ? 1 : 32 / sizeof(T);
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_SMALL_VEC_H
@@ -3,19 +3,30 @@
 #ifndef DAGEE_INCLUDE_DAGEE_TASK_DAG_H
 #define DAGEE_INCLUDE_DAGEE_TASK_DAG_H
 
+#include "dagee/AdjacencyList.h"
 #include "dagee/AllocFactory.h"
+#include "dagee/ChainFusion.h"
+#include "dagee/DepCounters.h"
+#include "dagee/FrozenDAG.h"
+#include "dagee/WorkStealing.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <tuple>
 #include <type_traits>
 #include <vector>
 
 namespace dagee {
 
-using AtomicCounter = std::atomic<unsigned>;
-using AtomicCounterValue = unsigned;
-
 template <typename T, typename AF>
-using AdjList = typename AF::template Vec<T>;
+using AdjList = AdjacencyList<T, AF>;
+
+template <typename DAG>
+class ConcurrentDAGbuilder;
 
 template <typename T = uint32_t>
 struct IDbase {
@@ -43,6 +54,9 @@ struct IDbase<void> {
 template <typename D>
 struct NodeBase {
   D mData;
+  //! position of the node in the owning DAG's FrozenDAG, assigned by DAGbase::freeze() and by
+  //! traversals that index per-node state by it
+  uint32_t mFrozenIndex = 0;
 
   template <typename... Args>
   NodeBase(Args&&... args) : mData(std::forward<Args>(args)...) {}
@@ -50,6 +64,8 @@ struct NodeBase {
   D& data(void) { return mData; }
 
   const D& data(void) const { return mData; }
+
+  uint32_t frozenIndex(void) const { return mFrozenIndex; }
 };
 
 template <typename Derived, typename AllocFactory>
@@ -66,12 +82,14 @@ struct NodeSuccBase {
 
   bool hasSucc(Derived* n) const {
     assert(n && "null pointer arg");
-    return (std::find(mSuccList.cbegin(), mSuccList.cend(), n) != mSuccList.cend());
+    return mSuccList.contains(n);
   }
 
   const AdjListTy& successors(void) const { return mSuccList; }
 
   bool isSink(void) const { return mSuccList.cbegin() == mSuccList.cend(); }
+
+  void clearSuccs(void) { mSuccList.clear(); }
 };
 
 template <typename Derived, typename AllocFactory>
@@ -88,35 +106,32 @@ struct NodePredBase {
 
   bool hasPred(Derived* n) const {
     assert(n && "null pointer arg");
-    return (std::find(mPredList.cbegin(), mPredList.cend(), n) != mPredList.cend());
+    return mPredList.contains(n);
   }
 
   const AdjListTy& predecessors(void) const { return mPredList; }
+
+  void clearPreds(void) { mPredList.clear(); }
 };
 
+/**
+ * Number of predecessors, incremented as the edges are added to the graph. The
+ * counters that traversals decrement are kept outside the node, in
+ * DAGbase::mDepCounters, so that the DAG can be traversed again
+ */
 template <typename __UNUSED = void>
 struct PredCountBase {
-  //! increment the number of predecessors as the edges are added to the graph
   AtomicCounter mNumPred;
-  //! a shadow copy of mNumPred used for forEachNode_TopoOrder. It  allows resetting count and
-  //! reusing the DAG when needed
-  AtomicCounter mDepCounter;
-
-  // using T = typename AtomicCounter::value_type;
 
-  PredCountBase(void) : mNumPred(0), mDepCounter(0) {}
+  PredCountBase(void) : mNumPred(0) {}
 
   bool isSrc(void) const { return mNumPred == 0; }
 
-  void addPred(PredCountBase* b) { ++mNumPred; }
-
-  void resetDepCounter(void) {
-    mDepCounter.store(mNumPred.load(std::memory_order_relaxed), std::memory_order_release);
-  }
+  AtomicCounterValue numPreds(void) const { return mNumPred.load(std::memory_order_relaxed); }
 
-  AtomicCounterValue decrementDepCounter(void) { return --mDepCounter; }
+  void addPred(PredCountBase* b) { ++mNumPred; }
 
-  AtomicCounterValue depCounter(void) const { return mDepCounter; }
+  void clearPreds(void) { mNumPred = 0; }
 };
 
 template <typename D, typename AllocFactory>
@@ -129,31 +144,103 @@ struct NodePush : public PredCountBase<>,
 
   template <typename... Args>
   explicit NodePush(Args&&... args) : PCbase(), NDbase(std::forward<Args>(args)...), SuccBase() {}
+
+  void clearEdges(void) {
+    PCbase::clearPreds();
+    SuccBase::clearSuccs();
+  }
 };
 
+/**
+ * Node that only knows its predecessors. Readiness is tracked in pull mode: a
+ * node scans its predecessors from a cursor that only moves forward, and
+ * parks itself on the first unfinished one. Each node heads an intrusive list
+ * of such waiters, whose head pointer is tagged with a done bit. Finishing a
+ * node sets the bit and hands back the waiters in a single atomic exchange,
+ * so a waiter is either in the list or sees the bit, never neither. See
+ * DAGbase::forEachNode_TopoOrder for the scheduler built on this.
+ */
 template <typename D, typename AllocFactory>
 struct NodePull : public NodeBase<D>, public NodePredBase<NodePull<D, AllocFactory>, AllocFactory> {
   using NDbase = NodeBase<D>;
   using PredBase = NodePredBase<NodePull, AllocFactory>;
 
-  bool mDone = false;
+  constexpr static const uintptr_t DONE_BIT = 1;
+
+  //! head of the list of nodes waiting on this one, tagged with DONE_BIT once this node is done
+  std::atomic<uintptr_t> mWaiters;
+  //! next node in the waiter list this node is parked on
+  NodePull* mNextWaiter = nullptr;
+  //! predecessors before this position are known to be done, during a traversal
+  uint32_t mPredCursor = 0;
 
   template <typename... Args>
-  explicit NodePull(Args&&... args) : NDbase(std::forward<Args>(args)...), PredBase() {}
+  explicit NodePull(Args&&... args) : NDbase(std::forward<Args>(args)...), PredBase(), mWaiters(0) {}
 
   void addSucc(NodePull*) const {}
 
-  // Can store a 1-bit flag on the pointer to indicate whether the predecessor
-  // is
-  // done, to avoid re-reading mDone flag.
-  bool isSrc(void) const {
-    for (NodePull* p : PredBase::mPredList) {
-      if (!p->mDone) {
-        return false;
+  void clearEdges(void) {
+    PredBase::clearPreds();
+    mPredCursor = 0;
+  }
+
+  bool isDone(void) const { return mWaiters.load(std::memory_order_acquire) & DONE_BIT; }
+
+  //! forget the done bit, waiters and cursor, which only mean anything during a traversal
+  void resetPullState(void) {
+    mWaiters.store(0, std::memory_order_relaxed);
+    mNextWaiter = nullptr;
+    mPredCursor = 0;
+  }
+
+  /**
+   * Move the cursor past predecessors that are done. Amortized O(1) per
+   * predecessor over the whole execution, since the cursor never moves back.
+   * @return first predecessor not done yet, nullptr if all are done
+   */
+  NodePull* firstPendingPred(void) {
+    const auto& preds = PredBase::mPredList;
+    while (mPredCursor < preds.size()) {
+      NodePull* p = preds[mPredCursor];
+      if (!p->isDone()) {
+        return p;
       }
+      ++mPredCursor;
     }
+    return nullptr;
+  }
+
+  /**
+   * Park this node in the waiter list of predecessor p.
+   * @return false if p turned out to be done already
+   */
+  bool waitOn(NodePull* p) {
+    assert(p != this && "node can't wait on itself");
+    uintptr_t head = p->mWaiters.load(std::memory_order_acquire);
+    do {
+      if (head & DONE_BIT) {
+        return false;
+      }
+      mNextWaiter = reinterpret_cast<NodePull*>(head);
+    } while (!p->mWaiters.compare_exchange_weak(head, reinterpret_cast<uintptr_t>(this),
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire));
     return true;
   }
+
+  /**
+   * Set the done bit. @return the waiters parked on this node, chained through
+   * mNextWaiter. Read the next pointer of a waiter before re-examining it,
+   * since it may park itself again
+   */
+  NodePull* markDone(void) {
+    uintptr_t head = mWaiters.exchange(DONE_BIT, std::memory_order_acq_rel);
+    assert(!(head & DONE_BIT) && "node finished twice");
+    return reinterpret_cast<NodePull*>(head);
+  }
+
+  //! static: whether the node has predecessors, whatever a traversal has marked done
+  bool isSrc(void) const { return PredBase::mPredList.cbegin() == PredBase::mPredList.cend(); }
 };
 
 template <typename D, typename AllocFactory>
@@ -169,8 +256,6 @@ struct NodeInOut : public PredCountBase<>,
   using AdjListTy = typename SuccBase::AdjListTy; // XXX: Hack to work around the fact that SuccBase
                                                   // and PredBase define AdjListTy separately
 
-  AtomicCounter mNumPred;
-
   template <typename... Args>
   explicit NodeInOut(Args&&... args)
       : PCbase(), NDbase(std::forward<Args>(args)...), SuccBase(), PredBase() {}
@@ -183,6 +268,12 @@ struct NodeInOut : public PredCountBase<>,
   bool isSrc(void) const { return PCbase::isSrc(); }
 
   void addSucc(NodeInOut* a) { SuccBase::addSucc(a); }
+
+  void clearEdges(void) {
+    PCbase::clearPreds();
+    PredBase::clearPreds();
+    SuccBase::clearSuccs();
+  }
 };
 
 namespace impl {
@@ -221,17 +312,282 @@ struct DAGbase {
   using NodePtr = Node*;
   using NodeCptr = const Node*;
   using IDty = size_t;
+  using AllocFactoryTy = AllocFactory;
+  using Frozen = FrozenDAG<NodePtr, AllocFactory>;
+  using Index = typename Frozen::Index;
+  using Levels = DAGlevels<NodePtr, AllocFactory>;
+  using Chains = DAGchains<NodePtr, AllocFactory>;
 
  protected:
   using NodeAlloc = typename AllocFactory::template FixedSizeAlloc<Node>;
   using NodeCont = typename AllocFactory::template Vec<NodePtr>;
   using NodeAllocTraits = dagee::AllocTraits<NodeAlloc>;
   using NodeDeq = typename AllocFactory::template Deque<NodePtr>;
+  using Arena = typename AllocFactory::Arena;
+  using ArenaScope = typename AllocFactory::ArenaScope;
 
   // TODO: add ID optionally
   // IDty mID;
-  NodeAlloc mNodeAlloc;
-  NodeCont mAllNodes;
+  //! memory resource for nodes and their adjacency lists. Must precede the members using it
+  Arena mArena;
+  NodeAlloc mNodeAlloc = AllocFactory::template makeFixedSizeAlloc<Node>(mArena);
+  NodeCont mAllNodes = AllocFactory::template makeVec<NodePtr>(mArena);
+  //! CSR snapshot built by freeze(), invalidated by any modification
+  Frozen mFrozen{mArena};
+  //! built by computeLevels(), invalidated by any modification
+  Levels mLevels{mArena};
+  //! built by computeChains(), invalidated by any modification
+  Chains mChains{mArena};
+  //! set by transitiveReduce(), reset by any modification
+  bool mReduced = false;
+  //! dependency counters of push-mode traversals, by frozen index, apart from the nodes
+  DepCounterArray mDepCounters;
+
+  template <typename>
+  friend class ConcurrentDAGbuilder;
+
+  //! drop all state derived from the topology
+  void thaw(void) {
+    mReduced = false;
+    if (mFrozen.valid()) {
+      mFrozen.clear();
+    }
+    if (mLevels.valid()) {
+      mLevels.clear();
+    }
+    if (mChains.valid()) {
+      mChains.clear();
+    }
+  }
+
+  struct ForEachEdgeByIndex {
+    const DAGbase& mDag;
+
+    template <typename G>
+    void operator()(G&& edgeFn) const {
+      mDag.forEachEdgeByIndex(edgeFn);
+    }
+  };
+
+  template <typename G, bool S = STORE_SUCC>
+  typename std::enable_if<S>::type forEachEdgeByIndex(G& edgeFn) const {
+    for (NodePtr a : mAllNodes) {
+      for (NodePtr b : a->successors()) {
+        edgeFn(a->frozenIndex(), b->frozenIndex());
+      }
+    }
+  }
+
+  template <typename G, bool S = STORE_SUCC>
+  typename std::enable_if<!S>::type forEachEdgeByIndex(G& edgeFn) const {
+    for (NodePtr b : mAllNodes) {
+      for (NodePtr a : b->predecessors()) {
+        edgeFn(a->frozenIndex(), b->frozenIndex());
+      }
+    }
+  }
+
+  //! number the nodes by position in mAllNodes, as freeze() does
+  void indexNodes(void) {
+    if (mFrozen.valid()) {
+      return;
+    }
+    Index i = 0;
+    for (NodePtr p : mAllNodes) {
+      p->mFrozenIndex = i++;
+    }
+  }
+
+  //! index the nodes and set their dependency counters to their number of predecessors
+  template <bool S = STORE_SUCC>
+  typename std::enable_if<S>::type resetDepCounters(void) {
+    indexNodes();
+    mDepCounters.reset(mAllNodes.size(), [this](size_t i) { return mAllNodes[i]->numPreds(); });
+  }
+
+  template <typename F, bool S = STORE_SUCC>
+  typename std::enable_if<S>::type forEachNode_TopoOrderImpl(F& func) {
+    NodeDeq nodeQ;
+
+    resetDepCounters();
+    this->forEachNode([&, this](NodePtr p) {
+      if (isSrc(p)) {
+        nodeQ.emplace_back(p);
+      }
+    });
+
+    while (!nodeQ.empty()) {
+      auto p = nodeQ.back();
+      nodeQ.pop_back();
+
+      assert(mDepCounters.value(p->frozenIndex()) == 0 &&
+             "invariant violation every node in nodeQ must be a source");
+      func(p);
+
+      for (NodePtr d : this->successors(p)) {
+        assert(d && "found null node in successors of a source");
+        if (mDepCounters.decrement(d->frozenIndex()) == 0) {
+          nodeQ.emplace_back(d);
+        }
+      }
+    }
+  }
+
+  template <typename F, bool S = STORE_SUCC>
+  typename std::enable_if<S>::type topoOrderParallelImpl(unsigned numThreads, F& func) {
+    NodeCont sources;
+    resetDepCounters();
+    this->forEachNode([&, this](NodePtr p) {
+      if (isSrc(p)) {
+        sources.emplace_back(p);
+      }
+    });
+
+    auto body = [&func, this](NodePtr p, WorkPusher<NodePtr>& push) {
+      func(p);
+      for (NodePtr d : this->successors(p)) {
+        if (mDepCounters.decrement(d->frozenIndex()) == 0) {
+          push(d);
+        }
+      }
+    };
+    impl::runWorkStealing<NodePtr>(numThreads, sources.cbegin(), sources.cend(), mAllNodes.size(),
+                                   body);
+  }
+
+  template <typename F, bool S = STORE_SUCC>
+  typename std::enable_if<!S>::type topoOrderParallelImpl(unsigned numThreads, F& func) {
+    NodeCont sources;
+    auto addSource = [&sources](NodePtr n) { sources.emplace_back(n); };
+
+    resetPullStates();
+    for (NodePtr p : mAllNodes) {
+      pullReady(p, addSource);
+    }
+
+    auto body = [&func](NodePtr p, WorkPusher<NodePtr>& push) {
+      func(p);
+      pullFinish(p, push);
+    };
+    impl::runWorkStealing<NodePtr>(numThreads, sources.cbegin(), sources.cend(), mAllNodes.size(),
+                                   body);
+    resetPullStates();
+  }
+
+  template <typename F>
+  void topoOrderParallelFrozen(unsigned numThreads, F& func) {
+    const Frozen& fz = mFrozen;
+
+    // only the CSR arrays and the counters are touched besides the nodes visited
+    mDepCounters.reset(fz.size(), [&fz](size_t i) { return fz.numPreds(static_cast<Index>(i)); });
+
+    auto body = [&](Index i, WorkPusher<Index>& push) {
+      func(fz.node(i));
+      for (Index s : fz.successors(i)) {
+        if (mDepCounters.decrement(s) == 0) {
+          push(s);
+        }
+      }
+    };
+    impl::runWorkStealing<Index>(numThreads, fz.sources().cbegin(), fz.sources().cend(), fz.size(),
+                                 body);
+  }
+
+  /**
+   * Same as topoOrderParallelFrozen, with ready nodes pushed so that a worker
+   * takes the one with the largest bottom level next, as far as its own deque
+   * goes: sources are handed out in increasing bottom level, and of the
+   * successors a node makes ready, the one with the largest bottom level is
+   * pushed last. Thieves take the oldest items, i.e., of lower priority
+   */
+  template <typename BL, typename F>
+  void topoOrderParallelPrioritized(unsigned numThreads, const BL& bl, F& func) {
+    const Frozen& fz = mFrozen;
+
+    mDepCounters.reset(fz.size(), [&fz](size_t i) { return fz.numPreds(static_cast<Index>(i)); });
+
+    typename AllocFactory::template Vec<Index> sources;
+    sources.assign(fz.sources().cbegin(), fz.sources().cend());
+    std::stable_sort(sources.begin(), sources.end(),
+                     [&bl](Index a, Index b) { return bl[a] < bl[b]; });
+
+    auto body = [&](Index i, WorkPusher<Index>& push) {
+      func(fz.node(i));
+      Index best = Frozen::INVALID_INDEX;
+      for (Index s : fz.successors(i)) {
+        if (mDepCounters.decrement(s) != 0) {
+          continue;
+        }
+        if (best == Frozen::INVALID_INDEX) {
+          best = s;
+        } else if (bl[s] > bl[best]) {
+          push(best);
+          best = s;
+        } else {
+          push(s);
+        }
+      }
+      if (best != Frozen::INVALID_INDEX) {
+        push(best);
+      }
+    };
+    impl::runWorkStealing<Index>(numThreads, sources.cbegin(), sources.cend(), fz.size(), body);
+  }
+
+  //! clear the done bits, waiters and cursors left by a pull-mode traversal
+  void resetPullStates(void) {
+    for (NodePtr p : mAllNodes) {
+      p->resetPullState();
+    }
+  }
+
+  /**
+   * Pull-mode readiness check, see NodePull. Either parks n on its first
+   * unfinished predecessor or hands it to onReady
+   */
+  template <typename R>
+  static void pullReady(NodePtr n, R& onReady) {
+    while (NodePtr p = n->firstPendingPred()) {
+      if (n->waitOn(p)) {
+        return;
+      }
+    }
+    onReady(n);
+  }
+
+  template <typename R>
+  static void pullFinish(NodePtr n, R& onReady) {
+    NodePtr w = n->markDone();
+    while (w) {
+      NodePtr next = w->mNextWaiter;
+      pullReady(w, onReady);
+      w = next;
+    }
+  }
+
+  //! Without successor lists, nodes wait on predecessors instead, in O(nodes + edges)
+  template <typename F, bool S = STORE_SUCC>
+  typename std::enable_if<!S>::type forEachNode_TopoOrderImpl(F& func) {
+    NodeCont ready;
+    auto onReady = [&ready](NodePtr n) { ready.emplace_back(n); };
+
+    resetPullStates();
+    for (NodePtr p : mAllNodes) {
+      pullReady(p, onReady);
+    }
+
+    while (!ready.empty()) {
+      NodePtr p = ready.back();
+      ready.pop_back();
+      func(p);
+      pullFinish(p, onReady);
+    }
+
+    assert(std::all_of(mAllNodes.cbegin(), mAllNodes.cend(),
+                       [](NodePtr p) { return p->isDone(); }) &&
+           "cycle detected, graph is not a DAG");
+    resetPullStates();
+  }
 
   void destroyNode(NodePtr t) {
     assert(t && "arg must be non-null");
@@ -240,10 +596,23 @@ struct DAGbase {
   }
 
   void destroyAllNodes(void) {
-    for (auto t : mAllNodes) {
-      destroyNode(t);
+    // With an arena that releases in bulk, nodes only need to be destroyed one by
+    // one if the node data has a destructor; adjacency lists live in the arena
+    if (!AllocFactory::RELEASES_IN_BULK || !std::is_trivially_destructible<D>::value) {
+      for (auto t : mAllNodes) {
+        destroyNode(t);
+      }
     }
     mAllNodes.clear();
+    mDepCounters.releaseStorage();
+
+    if (AllocFactory::RELEASES_IN_BULK) {
+      mFrozen.releaseStorage();
+      mLevels.releaseStorage();
+      mChains.releaseStorage();
+      dagee::releaseStorage(mAllNodes);
+      mArena.reset();
+    }
   }
 
  public:
@@ -252,7 +621,258 @@ struct DAGbase {
 
   ~DAGbase(void) { destroyAllNodes(); }
 
-  void clear(void) { destroyAllNodes(); }
+  void clear(void) {
+    thaw();
+    destroyAllNodes();
+  }
+
+  /**
+   * Pack the topology into contiguous CSR arrays (see FrozenDAG). The snapshot is
+   * cached: calling freeze() again is a no-op until the DAG is modified, at which
+   * point it is dropped automatically. Useful for large DAGs that are traversed
+   * or executed more than once.
+   */
+  void freeze(void) {
+    if (mFrozen.valid()) {
+      return;
+    }
+
+    indexNodes();
+    mFrozen.build(mAllNodes, ForEachEdgeByIndex{*this});
+  }
+
+  bool isFrozen(void) const { return mFrozen.valid(); }
+
+  /**
+   * Layout of the dependency counters of forEachNode_TopoOrder(Parallel).
+   * DepCounterLayout::PADDED gives each counter a cache line, so that threads
+   * decrementing the counters of neighboring nodes don't false-share, at 64
+   * bytes per node. PACKED by default.
+   */
+  void setDepCounterLayout(DepCounterLayout layout) noexcept { mDepCounters.setLayout(layout); }
+
+  /**
+   * Remove every edge (a, b) that is implied by a longer path from a to b. The
+   * set of dependencies is preserved, but nodes end up with shorter predecessor
+   * lists, i.e. fewer entries in the requires array of each task.
+   *
+   * For each node, its successors are processed in topological order. A
+   * successor already reached from an earlier successor is redundant; otherwise
+   * its descendants are marked. The walk is bounded by topological positions:
+   * each node is labelled with the interval [pos, maxReachablePos], and a node
+   * is only descended into if its interval can contain a successor that is still
+   * to be processed. Cached until the next modification.
+   *
+   * @return number of edges removed
+   */
+  size_t transitiveReduce(void) {
+    if (mReduced) {
+      return 0;
+    }
+
+    const bool wasFrozen = isFrozen();
+    freeze();
+    const Frozen& fz = mFrozen;
+    const Index N = fz.size();
+
+    using IndexVec = typename Frozen::IndexVec;
+    IndexVec pos(N);
+    for (Index k = 0; k < N; ++k) {
+      pos[fz.topoOrder()[k]] = k;
+    }
+
+    // interval labels: highest topological position reachable from each node
+    IndexVec maxPos(N);
+    for (Index k = N; k > 0; --k) {
+      Index u = fz.topoOrder()[k - 1];
+      Index m = pos[u];
+      for (Index v : fz.successors(u)) {
+        m = std::max(m, maxPos[v]);
+      }
+      maxPos[u] = m;
+    }
+
+    const Index UNMARKED = Frozen::INVALID_INDEX;
+    IndexVec mark(N, UNMARKED);
+    IndexVec succs;
+    IndexVec stack;
+    typename AllocFactory::template Vec<std::pair<Index, Index> > keptEdges;
+    keptEdges.reserve(fz.numEdges());
+
+    auto byPos = [&pos](Index a, Index b) { return pos[a] < pos[b]; };
+
+    for (Index u = 0; u < N; ++u) {
+      succs.assign(fz.successors(u).begin(), fz.successors(u).end());
+      if (succs.size() < 2) {
+        for (Index v : succs) {
+          keptEdges.emplace_back(u, v);
+        }
+        continue;
+      }
+
+      std::sort(succs.begin(), succs.end(), byPos);
+      const Index lastPos = pos[succs.back()];
+
+      for (size_t k = 0; k < succs.size(); ++k) {
+        Index v = succs[k];
+        if (mark[v] == u) {
+          continue; // reachable through an earlier successor
+        }
+        keptEdges.emplace_back(u, v);
+
+        if (k + 1 == succs.size()) {
+          break;
+        }
+        const Index nextPos = pos[succs[k + 1]];
+
+        stack.clear();
+        stack.push_back(v);
+        while (!stack.empty()) {
+          Index w = stack.back();
+          stack.pop_back();
+          for (Index x : fz.successors(w)) {
+            if (mark[x] != u && pos[x] <= lastPos && maxPos[x] >= nextPos) {
+              mark[x] = u;
+              stack.push_back(x);
+            }
+          }
+        }
+      }
+    }
+
+    const size_t numRemoved = fz.numEdges() - keptEdges.size();
+
+    if (numRemoved > 0) {
+      typename AllocFactory::template Vec<NodePtr> nodes(fz.nodes().cbegin(), fz.nodes().cend());
+      for (NodePtr p : nodes) {
+        p->clearEdges();
+      }
+      // invalidates fz
+      for (const auto& e : keptEdges) {
+        addEdge(nodes[e.first], nodes[e.second]);
+      }
+      if (wasFrozen) {
+        freeze();
+      }
+    } else if (!wasFrozen) {
+      thaw();
+    }
+
+    mReduced = true;
+    return numRemoved;
+  }
+
+  bool isReduced(void) const { return mReduced; }
+
+  const Frozen& frozen(void) const {
+    assert(isFrozen() && "DAG must be frozen first");
+    return mFrozen;
+  }
+
+  /**
+   * Split the nodes into levels by longest-path depth (see DAGlevels), for
+   * level-synchronous executors. Freezes the DAG. The result is cached until
+   * the DAG is modified, so repeated calls are free.
+   */
+  const Levels& computeLevels(void) {
+    if (!mLevels.valid()) {
+      freeze();
+      mLevels.build(mFrozen);
+    }
+    return mLevels;
+  }
+
+  /**
+   * Split the nodes into maximal chains (see DAGchains), for executors that
+   * submit a chain as one in-order batch. Freezes the DAG. Cached until the DAG
+   * is modified.
+   */
+  const Chains& computeChains(void) {
+    if (!mChains.valid()) {
+      freeze();
+      mChains.build(mFrozen);
+    }
+    return mChains;
+  }
+
+  /**
+   * Same as above, where only edges a->b with canFuse(nodeData(a), nodeData(b))
+   * may be fused, e.g., to keep chains on one executor. The result goes to
+   * chains and is not cached.
+   */
+  template <typename F>
+  void computeChains(Chains& chains, const F& canFuse) {
+    freeze();
+    const Frozen& fz = mFrozen;
+    chains.build(fz, [this, &fz, &canFuse](Index a, Index b) {
+      return canFuse(nodeData(fz.node(a)), nodeData(fz.node(b)));
+    });
+  }
+
+  /**
+   * Bottom level of every node: the cost of the most expensive path from the
+   * node to a sink, the node included, where cost(const D&) estimates the
+   * duration of one node (see CostModel.h). Nodes with larger bottom levels are
+   * on the critical path. Freezes the DAG. bl is indexed by node index.
+   */
+  template <typename C, typename V>
+  void computeBottomLevels(const C& cost, V& bl) {
+    freeze();
+    const Frozen& fz = mFrozen;
+
+    bl.assign(fz.size(), 0.0);
+    const auto& topo = fz.topoOrder();
+    for (auto it = topo.crbegin(); it != topo.crend(); ++it) {
+      const Index i = *it;
+      double maxSucc = 0.0;
+      for (Index s : fz.successors(i)) {
+        maxSucc = std::max(maxSucc, double(bl[s]));
+      }
+      bl[i] = maxSucc + cost(nodeData(fz.node(i)));
+    }
+  }
+
+  /**
+   * Topological order by list scheduling: of all the ready nodes, the one with
+   * the largest bottom level (see computeBottomLevels) comes next, ties going to
+   * the smaller node index. The DAG must be frozen. Fills order with node
+   * indices.
+   */
+  template <typename BL, typename V>
+  void computePriorityOrder(const BL& bl, V& order) const {
+    const Frozen& fz = frozen();
+    const Index N = fz.size();
+    assert(bl.size() == N && "need one bottom level per node");
+
+    auto lowerPrio = [&bl](Index a, Index b) {
+      return bl[a] < bl[b] || (bl[a] == bl[b] && a > b);
+    };
+
+    typename AllocFactory::template Vec<Index> depCounters(N);
+    typename AllocFactory::template Vec<Index> heap;
+    for (Index i = 0; i < N; ++i) {
+      depCounters[i] = fz.numPreds(i);
+    }
+    heap.assign(fz.sources().cbegin(), fz.sources().cend());
+    std::make_heap(heap.begin(), heap.end(), lowerPrio);
+
+    order.clear();
+    order.reserve(N);
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end(), lowerPrio);
+      const Index i = heap.back();
+      heap.pop_back();
+      order.emplace_back(i);
+
+      for (Index s : fz.successors(i)) {
+        if (--depCounters[s] == 0) {
+          heap.emplace_back(s);
+          std::push_heap(heap.begin(), heap.end(), lowerPrio);
+        }
+      }
+    }
+    assert(order.size() == N && "cycle detected, graph is not a DAG");
+  }
 
   // const IDty& getID(void) const { return mID; }
 
@@ -273,7 +893,12 @@ struct DAGbase {
   template <bool P = STORE_PRED, bool S = STORE_SUCC,
             typename std::enable_if<P && S, int>::type = 0>
   bool hasEdge(const NodePtr& a, const NodePtr& b) const {
-    return a->hasSucc(b) && b->hasPred(a);
+    // both sides hold the edge, so search the shorter list
+    assert(a->hasSucc(b) == b->hasPred(a) && "successor and predecessor lists disagree");
+    if (a->successors().size() <= b->predecessors().size()) {
+      return a->hasSucc(b);
+    }
+    return b->hasPred(a);
   }
 
   template <bool P = STORE_PRED, bool S = STORE_SUCC,
@@ -294,8 +919,11 @@ struct DAGbase {
 
   template <typename... Args>
   Node* addNode(Args&&... args) {
+    thaw();
     Node* t = NodeAllocTraits::allocate(mNodeAlloc, 1);
     assert(t && "node allocation failed");
+    // adjacency lists constructed here pick up mArena
+    ArenaScope scope(mArena);
     NodeAllocTraits::construct(mNodeAlloc, t, std::forward<Args>(args)...);
     mAllNodes.push_back(t);
     return t;
@@ -304,6 +932,7 @@ struct DAGbase {
   void addEdge(NodePtr a, NodePtr b) {
     assert(a && b && "both args should be non-null");
     assert(a != b && "cannot add self edge, i.e., src==dst");
+    thaw();
     a->addSucc(b);
     b->addPred(a);
   }
@@ -345,6 +974,13 @@ struct DAGbase {
 
   template <typename F>
   void forEachSource(F&& func) {
+    if (isFrozen()) {
+      for (Index i : mFrozen.sources()) {
+        func(mFrozen.node(i));
+      }
+      return;
+    }
+
     this->forEachNode([&func, this](NodePtr p) {
       if (isSrc(p)) {
         func(p);
@@ -354,37 +990,91 @@ struct DAGbase {
 
   template <typename F>
   void forEachSink(F&& func) {
+    if (isFrozen()) {
+      for (Index i : mFrozen.sinks()) {
+        func(mFrozen.node(i));
+      }
+      return;
+    }
+
     this->forEachNode([&func](NodePtr p) {
       if (p->isSink()) {
         func(p);
       }
     });
   }
-  template <typename F, bool S = STORE_SUCC>
-  void forEachNode_TopoOrder(F&& func) {
-    NodeDeq nodeQ;
 
-    this->forEachNode([&, this](NodePtr p) {
-      if (isSrc(p)) {
-        nodeQ.emplace_back(p);
+  /**
+   * Visit all nodes such that a node is visited after all its predecessors. A
+   * frozen DAG replays the topological order computed by freeze()
+   */
+  template <typename F>
+  void forEachNode_TopoOrder(F&& func) {
+    if (isFrozen()) {
+      for (Index i : mFrozen.topoOrder()) {
+        func(mFrozen.node(i));
       }
-      p->resetDepCounter();
-    });
+      return;
+    }
 
-    while (!nodeQ.empty()) {
-      auto p = nodeQ.back();
-      nodeQ.pop_back();
+    forEachNode_TopoOrderImpl(func);
+  }
 
-      assert(p->depCounter() == 0 && "invariant violation every node in nodeQ must be a source");
-      func(p);
+  /**
+   * Same as above, with ready nodes picked critical path first: of all the
+   * ready nodes, the one with the largest bottom level under cost (see
+   * computeBottomLevels and CostModel.h) is visited next. Freezes the DAG.
+   */
+  template <typename C, typename F>
+  void forEachNode_TopoOrder(const C& cost, F&& func) {
+    typename AllocFactory::template Vec<double> bl;
+    typename AllocFactory::template Vec<Index> order;
+    computeBottomLevels(cost, bl);
+    computePriorityOrder(bl, order);
+
+    for (Index i : order) {
+      func(mFrozen.node(i));
+    }
+  }
 
-      for (NodePtr d : this->successors(p)) {
-        assert(d && "found null node in successors of a source");
-        if (d->decrementDepCounter() == 0) {
-          nodeQ.emplace_back(d);
-        }
-      }
+  /**
+   * Parallel version of forEachNode_TopoOrder on numThreads host threads (the
+   * calling thread included). func(NodePtr) may be invoked concurrently for
+   * independent nodes, but a node is visited only after all its predecessors'
+   * calls have returned. Ready nodes are distributed using per-thread
+   * work-stealing deques. Dependency counters are kept in an array apart from
+   * the nodes, see setDepCounterLayout. A frozen DAG is scanned through its CSR
+   * arrays only.
+   */
+  template <typename F>
+  void forEachNode_TopoOrderParallel(unsigned numThreads, F&& func) {
+    if (numThreads <= 1) {
+      forEachNode_TopoOrder(func);
+      return;
     }
+
+    if (isFrozen()) {
+      topoOrderParallelFrozen(numThreads, func);
+    } else {
+      topoOrderParallelImpl(numThreads, func);
+    }
+  }
+
+  /**
+   * Same as above, with ready nodes picked critical path first under cost, as
+   * forEachNode_TopoOrder(cost, func) does, on each worker's own deque (see
+   * topoOrderParallelPrioritized). Freezes the DAG.
+   */
+  template <typename C, typename F>
+  void forEachNode_TopoOrderParallel(unsigned numThreads, const C& cost, F&& func) {
+    if (numThreads <= 1) {
+      forEachNode_TopoOrder(cost, func);
+      return;
+    }
+
+    typename AllocFactory::template Vec<double> bl;
+    computeBottomLevels(cost, bl);
+    topoOrderParallelPrioritized(numThreads, bl, func);
   }
 
   /*
@@ -466,65 +1156,137 @@ using MakeIndexSeq = MakeIntSeq<size_t, 0, N>;
 template <typename... Args>
 using MakeIndexSeqFor = MakeIndexSeq<sizeof...(Args)>;
 
+template <size_t V0, size_t... Vs>
+struct MaxOf {
+  constexpr static const size_t value = (V0 > MaxOf<Vs...>::value) ? V0 : MaxOf<Vs...>::value;
+};
+
+template <size_t V0>
+struct MaxOf<V0> {
+  constexpr static const size_t value = V0;
+};
+
+//! tag for constructing a value of type T in place, e.g., inside an InlineVariant
+template <typename T>
+struct InPlaceType {};
+
 /*
- * Some hackery to encode an enum (indicating type)
- * in a pointer. Works because if pointer is aligned to 32-bit or 64-bit
- * boundary, the lower 2 or 3 bits are always 0.
+ * Tagged union of DataTypes, holding its value inline, with the id of its type.
+ * Operations on the value dispatch through a table of function pointers indexed
+ * by the id, i.e., a single indirect call regardless of the number of types.
  */
 template <typename... DataTypes>
-struct MultiTypePtr {
-  using GenericPtr = std::uint64_t;
+class InlineVariant {
+  static_assert(sizeof...(DataTypes) > 0, "InlineVariant needs at least one type");
 
-  constexpr static const size_t MAX_TYPES = alignof(std::uintptr_t);
-  constexpr static const size_t MASK = MAX_TYPES - 1;
+  using Storage = typename std::aligned_storage<MaxOf<sizeof(DataTypes)...>::value,
+                                                MaxOf<alignof(DataTypes)...>::value>::type;
 
-  static_assert(sizeof...(DataTypes) <= MAX_TYPES, "Can't uniquely encode types");
+  Storage mStorage;
+  uint32_t mId;
 
-  GenericPtr mData;
+  template <typename T>
+  static void copyConstruct(void* dst, const void* src) {
+    new (dst) T(*static_cast<const T*>(src));
+  }
 
   template <typename T>
-  explicit MultiTypePtr(T* ptr) noexcept : mData(reinterpret_cast<GenericPtr>(ptr)) {
-    constexpr size_t ID = GetTypeId<T, DataTypes...>::value;
-    mData |= ID;
+  static void destroy(void* p) {
+    static_cast<T*>(p)->~T();
+  }
+
+  template <typename T, typename F>
+  static void invoke(void* p, F& func) {
+    func(*static_cast<T*>(p));
   }
 
-  size_t id() const noexcept { return mData & MASK; }
+  template <typename T, typename F>
+  static void invokeConst(const void* p, F& func) {
+    func(*static_cast<const T*>(p));
+  }
+
+  void copyFrom(const InlineVariant& that) {
+    using Fn = void (*)(void*, const void*);
+    static const Fn table[] = {&copyConstruct<DataTypes>...};
+    table[that.mId](&mStorage, &that.mStorage);
+    mId = that.mId;
+  }
+
+  void destroyValue(void) {
+    using Fn = void (*)(void*);
+    static const Fn table[] = {&destroy<DataTypes>...};
+    table[mId](&mStorage);
+  }
+
+ public:
+  template <typename T, typename... Args>
+  explicit InlineVariant(InPlaceType<T>, Args&&... args)
+      : mId(static_cast<uint32_t>(GetTypeId<T, DataTypes...>::value)) {
+    new (&mStorage) T(std::forward<Args>(args)...);
+  }
+
+  InlineVariant(const InlineVariant& that) { copyFrom(that); }
+
+  InlineVariant& operator=(const InlineVariant& that) {
+    if (this != &that) {
+      destroyValue();
+      copyFrom(that);
+    }
+    return *this;
+  }
+
+  ~InlineVariant(void) { destroyValue(); }
+
+  size_t id() const noexcept { return mId; }
 
   template <typename T>
-  T* ptr() noexcept {
-    return reinterpret_cast<T*>(mData & ~(MASK));
+  bool holds(void) const noexcept {
+    return mId == GetTypeId<T, DataTypes...>::value;
   }
 
   template <typename T>
-  const T* ptr() const {
-    return reinterpret_cast<const T*>(mData & ~MASK);
+  T* ptr() noexcept {
+    assert(holds<T>() && "InlineVariant holds a different type");
+    return reinterpret_cast<T*>(&mStorage);
   }
 
-  template <typename F, size_t... Indices>
-  void applyByTypeImpl(F&& func, IntSeq<size_t, Indices...>) {
-    const auto ID = id();
-    (void)(int[]){(((ID == Indices) ? func(*ptr<DataTypes>()) : void()), 0)...};
+  template <typename T>
+  const T* ptr() const noexcept {
+    assert(holds<T>() && "InlineVariant holds a different type");
+    return reinterpret_cast<const T*>(&mStorage);
   }
 
+  //! call func on the value, as its actual type
   template <typename F>
   void apply(F&& func) {
-    applyByTypeImpl(std::forward<F>(func), MakeIndexSeqFor<DataTypes...>());
+    using Func = typename std::remove_reference<F>::type;
+    using Fn = void (*)(void*, Func&);
+    static const Fn table[] = {&invoke<DataTypes, Func>...};
+    table[mId](&mStorage, func);
   }
 
-  /*
   template <typename F>
   void apply(F&& func) const {
-    applyByTypeImpl(std::forward<F>(func), MakeIndexSeqFor<DataTypes...>());
+    using Func = typename std::remove_reference<F>::type;
+    using Fn = void (*)(const void*, Func&);
+    static const Fn table[] = {&invokeConst<DataTypes, Func>...};
+    table[mId](&mStorage, func);
   }
-  */
 };
 } // end namespace impl
 
+/**
+ * DAG whose nodes hold a task of any of DataTypes, e.g., the TaskInstance
+ * types of several executors. The task is stored inline in the node, so
+ * reaching it from a NodePtr takes no further pointer hop, and there is no
+ * limit on the number of types. A node is as big as its largest DataType
+ * though, so types of very different sizes waste space.
+ */
 template <typename AllocFactory = dagee::StdAllocatorFactory<>, bool STORE_PRED = true,
           bool STORE_SUCC = false, typename... DataTypes>
 class MixedTaskDag
-    : public DAGbase<impl::MultiTypePtr<DataTypes...>, AllocFactory, STORE_PRED, STORE_SUCC> {
-  using GenericNodeData = impl::MultiTypePtr<DataTypes...>;
+    : public DAGbase<impl::InlineVariant<DataTypes...>, AllocFactory, STORE_PRED, STORE_SUCC> {
+  using GenericNodeData = impl::InlineVariant<DataTypes...>;
   using Base = DAGbase<GenericNodeData, AllocFactory, STORE_PRED, STORE_SUCC>;
 
  public:
@@ -540,99 +1302,50 @@ class MixedTaskDag
   using typename Base::NodeData;
   using typename Base::NodePtr;
 
- private:
-  template <typename T>
-  using AllocTy = typename AllocFactory::template FixedSizeAlloc<T>;
-  using AllocTuple = std::tuple<AllocTy<DataTypes>...>;
-
-  AllocTuple mAllocators;
-
-  // TODO(amber): use std::forward with D0&&
-  template <typename A, typename E>
-  static GenericNodeData allocateNodeData(A& alloc, const E& elem) {
-    using Atraits = dagee::AllocTraits<A>;
-    E* ePtr = Atraits::allocate(alloc, 1);
-    assert(ePtr && "allocateNodeData failed");
-    Atraits::construct(alloc, ePtr, elem);
-    return GenericNodeData(ePtr);
-  }
-
-  template <typename A, typename E>
-  static void deallocateNodeData(A& alloc, E* ePtr) {
-    assert(ePtr && "invalid pointer in deallocateNodeData");
-    using Atraits = dagee::AllocTraits<A>;
-    Atraits::destroy(alloc, ePtr);
-    Atraits::deallocate(alloc, ePtr, 1);
-  }
-
-  template <typename A, typename E>
-  NodePtr addNodeImpl(A& alloc, const E& elem) {
-    GenericNodeData gd = allocateNodeData(alloc, elem);
-    return Base::addNode(gd);
-  }
-
-  template <size_t... Indices>
-  void deleteNodeImpl(GenericNodeData& gd, impl::IntSeq<size_t, Indices...>) {
-    const size_t id = gd.id();
-
-    (void)(int[]){(((id == Indices) ? deallocateNodeData(std::get<Indices>(mAllocators),
-                                                         gd.template ptr<DataTypes>())
-                                    : void(0)),
-                   0)...};
-  }
-
-  void destroyAllNodeData() {
-    Base::forEachNode([this](NodePtr p) {
-      GenericNodeData gd = Base::nodeData(p);
-      deleteNodeImpl(gd, impl::MakeIndexSeqFor<DataTypes...>());
-    });
-  }
-
- public:
-  ~MixedTaskDag() { destroyAllNodeData(); }
-
   // TODO(amber): use std::forward with D0&&
   template <typename D>
   NodePtr addNode(const D& d) {
-    constexpr size_t ID = impl::GetTypeId<D, DataTypes...>::value;
-    return addNodeImpl(std::get<ID>(mAllocators), d);
+    return Base::addNode(impl::InPlaceType<D>(), d);
   }
 
   template <typename F>
   void applyToNodeData(NodePtr n, F&& func) {
     assert(n && "null node pointer");
-
-    GenericNodeData& gd = Base::nodeData(n);
-    gd.apply(std::forward<F>(func));
+    Base::nodeData(n).apply(std::forward<F>(func));
   }
 
   template <typename F>
-  void applyToNodeData(NodeCptr cn, F&& func) {
+  void applyToNodeData(NodeCptr cn, F&& func) const {
     assert(cn && "null node pointer");
-
-    NodePtr n = const_cast<NodePtr>(cn);
-
-    GenericNodeData& gd = Base::nodeData(n);
-    gd.apply(std::forward<F>(func));
+    Base::nodeData(cn).apply(std::forward<F>(func));
   }
 
-  /*
+  //! @return data of node, which must hold an E
   template <typename E>
-  const E& nodeData(NodeCptr node) const {
-    const GenericNodeData& x = Base::nodeData(node);
-    return *(x.ptr<E>());
+  E& nodeDataAs(NodePtr node) {
+    return *Base::nodeData(node).template ptr<E>();
   }
 
-  E& nodeData(NodePtr node) {
-    GenericNodeData& x = Base::nodeData(node);
-    return *(x.ptr<E>());
+  template <typename E>
+  const E& nodeDataAs(NodeCptr node) const {
+    return *Base::nodeData(node).template ptr<E>();
   }
-  */
 };
 
 /**
- * DAG class constructor must take a size_t ID as its first arg
- * DAG class must implement size_t getID() method
+ * Owns DAG objects, kept in a slab of slots recycled through a free list, so
+ * that makeDAG and destroyDAG are O(1) and memory stays bounded by the peak
+ * number of DAGs alive at a time. A DAG can also be referred to by a DAGhandle,
+ * its slot tagged with a generation, which goes stale once the DAG is
+ * destroyed, whereas a recycled DAGptr may point to a different DAG.
+ *
+ * With setMaxWarm(n), up to n destroyed DAGs are only cleared, keeping the node
+ * storage they grew (allocator pools, arena chunks, containers' capacity) for
+ * the next makeDAG() without arguments to reuse.
+ *
+ * In ID mode (DAG_ID_FLAG), the DAG class constructor must take a size_t ID as
+ * its first arg, which is the index of its slot. IDs are thus dense, and reused
+ * once their DAG is destroyed.
  */
 template <typename DAG_tp, typename AllocFactory, bool DAG_ID_FLAG = false>
 class DAGmanager {
@@ -644,87 +1357,253 @@ class DAGmanager {
   template <typename AF>
   using withAllocFactory = DAGmanager<DAG_tp, AF, DAG_ID_FLAG>;
 
+  class DAGhandle {
+    friend class DAGmanager;
+
+    uint32_t mIndex;
+    uint32_t mGen;
+
+    DAGhandle(uint32_t index, uint32_t gen) noexcept : mIndex(index), mGen(gen) {}
+
+   public:
+    DAGhandle(void) noexcept : mIndex(~uint32_t(0)), mGen(0) {}
+
+    bool operator==(const DAGhandle& that) const noexcept {
+      return mIndex == that.mIndex && mGen == that.mGen;
+    }
+    bool operator!=(const DAGhandle& that) const noexcept { return !(*this == that); }
+  };
+
  protected:
   using IDty = typename DAG::IDty;
 
-  // XXX: assuming the DAG allocator can be used for vector
-  using DAGalloc = typename AllocFactory::template FixedSizeAlloc<DAG>;
-  using DAGallocTraits = dagee::AllocTraits<DAGalloc>;
-  using DAGmap = typename AllocFactory::template Vec<DAGptr>;
+  enum class SlotState : uint8_t { FREE, LIVE, WARM };
+
+  struct Slot {
+    // first member, so that a DAGptr is also a pointer to its Slot
+    typename std::aligned_storage<sizeof(DAG), alignof(DAG)>::type mDAG;
+    uint32_t mIndex;
+    uint32_t mGen;
+    SlotState mState;
+
+    explicit Slot(uint32_t index) noexcept : mIndex(index), mGen(0), mState(SlotState::FREE) {}
+
+    DAGptr dag(void) noexcept { return reinterpret_cast<DAGptr>(&mDAG); }
+  };
+
+  static_assert(std::is_standard_layout<Slot>::value, "DAGptr to Slot cast needs standard layout");
 
-  DAGalloc mDAGalloc;
-  DAGmap mDAGmap;
+  using Arena = typename AllocFactory::Arena;
+  // a deque, so that DAGs never move
+  using SlotDeq = typename AllocFactory::template Deque<Slot>;
+  using IndexVec = typename AllocFactory::template Vec<uint32_t>;
 
-  template <bool D = DAG_ID_FLAG>
-  typename std::enable_if<D, IDty>::type genID(void) {
-    auto sz = mDAGmap.size();
-    mDAGmap.resize(sz + 1);
-    return sz;
+  Arena mArena;
+  SlotDeq mSlots = AllocFactory::template makeDeque<Slot>(mArena);
+  IndexVec mFreeSlots = AllocFactory::template makeVec<uint32_t>(mArena);
+  //! slots holding a cleared DAG
+  IndexVec mWarmSlots = AllocFactory::template makeVec<uint32_t>(mArena);
+  size_t mMaxWarm = 0;
+  size_t mNumLive = 0;
+  //! makeDAG and destroyDAG may be called from several threads
+  mutable std::mutex mMutex;
+
+  static Slot& slotOf(DAGptr d) noexcept { return *reinterpret_cast<Slot*>(d); }
+
+  Slot& claimSlot(void) {
+    if (mFreeSlots.empty()) {
+      assert(mSlots.size() < ~uint32_t(0) && "too many DAGs");
+      mSlots.emplace_back(static_cast<uint32_t>(mSlots.size()));
+      return mSlots.back();
+    }
+
+    uint32_t i = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    return mSlots[i];
   }
 
-  DAGptr allocDAG(void) {
-    DAGptr d = DAGallocTraits::allocate(mDAGalloc, 1);
-    assert(d && "node allocation failed");
-    return d;
+  //! a warm DAG if there is one, else nullptr
+  DAGptr claimWarm(void) {
+    if (mWarmSlots.empty()) {
+      return nullptr;
+    }
+    Slot& s = mSlots[mWarmSlots.back()];
+    mWarmSlots.pop_back();
+    s.mState = SlotState::LIVE;
+    ++mNumLive;
+    return s.dag();
   }
 
-  void freeDAG(DAGptr d) {
-    assert(d && "arg must be non-null");
-    DAGallocTraits::destroy(mDAGalloc, d);
-    DAGallocTraits::deallocate(mDAGalloc, d, 1);
+  template <typename... Args, bool D = DAG_ID_FLAG>
+  typename std::enable_if<D>::type constructDAG(Slot& s, Args&&... args) {
+    new (&s.mDAG) DAG(IDty(s.mIndex), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args, bool D = DAG_ID_FLAG>
+  typename std::enable_if<!D>::type constructDAG(Slot& s, Args&&... args) {
+    new (&s.mDAG) DAG(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  DAGptr makeDAGimpl(Args&&... args) {
+    Slot& s = claimSlot();
+    constructDAG(s, std::forward<Args>(args)...);
+    s.mState = SlotState::LIVE;
+    ++mNumLive;
+    return s.dag();
+  }
+
+  void freeSlot(Slot& s) {
+    s.dag()->~DAG();
+    s.mState = SlotState::FREE;
+    mFreeSlots.push_back(s.mIndex);
+  }
+
+  void trimWarm(size_t maxWarm) {
+    while (mWarmSlots.size() > maxWarm) {
+      Slot& s = mSlots[mWarmSlots.back()];
+      mWarmSlots.pop_back();
+      freeSlot(s);
+    }
+  }
+
+  //! mMutex must be held
+  void destroyLocked(Slot& s) {
+    assert(s.mState == SlotState::LIVE && "DAG destroyed already");
+
+    // invalidates all handles to the DAG
+    ++s.mGen;
+    --mNumLive;
+
+    if (mWarmSlots.size() < mMaxWarm) {
+      s.dag()->clear();
+      s.mState = SlotState::WARM;
+      mWarmSlots.push_back(s.mIndex);
+    } else {
+      freeSlot(s);
+    }
   }
 
   void destroyAllDAGs(void) {
-    for (auto d : mDAGmap) {
-      if (d) {
-        freeDAG(d);
+    for (auto& s : mSlots) {
+      if (s.mState != SlotState::FREE) {
+        s.dag()->~DAG();
+        s.mState = SlotState::FREE;
       }
     }
-
-    mDAGmap.clear();
+    mSlots.clear();
+    mFreeSlots.clear();
+    mWarmSlots.clear();
+    mNumLive = 0;
   }
 
  public:
-  template <typename... Args, bool D = DAG_ID_FLAG>
-  typename std::enable_if<D, DAGptr>::type makeDAG(Args&&... args) {
-    auto id = genID();
+  DAGmanager(void) = default;
 
-    DAGptr d = allocDAG();
-    DAGallocTraits::construct(mDAGalloc, d, id, std::forward<Args>(args)...);
+  DAGmanager(const DAGmanager&) = delete;
+  DAGmanager& operator=(const DAGmanager&) = delete;
 
-    mDAGmap[id] = d;
+  //! the next makeDAG() without arguments reuses a DAG destroyed earlier, if there is one
+  DAGptr makeDAG(void) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    DAGptr d = claimWarm();
+    return d ? d : makeDAGimpl();
+  }
 
-    return d;
+  //! args are passed to the DAG constructor, so a warm DAG can't be reused
+  template <typename Arg0, typename... Args>
+  DAGptr makeDAG(Arg0&& arg0, Args&&... args) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    return makeDAGimpl(std::forward<Arg0>(arg0), std::forward<Args>(args)...);
   }
 
-  template <typename... Args, bool D = DAG_ID_FLAG>
-  typename std::enable_if<!D, DAGptr>::type makeDAG(Args&&... args) {
-    DAGptr d = allocDAG();
-    DAGallocTraits::construct(mDAGalloc, d, std::forward<Args>(args)...);
-    return d;
+  void destroyDAG(DAGptr d) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    assert(d && "arg must be non-null");
+    Slot& s = slotOf(d);
+    assert(s.mIndex < mSlots.size() && &mSlots[s.mIndex] == &s && "DAG not owned by DAGmanager");
+    destroyLocked(s);
   }
 
-  template <bool D = DAG_ID_FLAG>
-  typename std::enable_if<D>::type destroyDAG(DAGptr d) {
+  /**
+   * Destroy the DAG of h, checking that h is not stale under the same lock, so
+   * that of two threads destroying through copies of h, only one does, even if
+   * the slot is reused in between. @return false if h was stale
+   */
+  bool destroyDAG(const DAGhandle& h) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    if (h.mIndex >= mSlots.size()) {
+      return false;
+    }
+    Slot& s = mSlots[h.mIndex];
+    if (s.mGen != h.mGen || s.mState != SlotState::LIVE) {
+      return false;
+    }
+    destroyLocked(s);
+    return true;
+  }
+
+  //! d must be live, i.e., not destroyed concurrently
+  DAGhandle handleOf(DAGptr d) const {
+    std::lock_guard<std::mutex> lk(mMutex);
     assert(d && "arg must be non-null");
-    auto id = d->ID();
+    const Slot& s = slotOf(d);
+    return DAGhandle(s.mIndex, s.mGen);
+  }
 
-    freeDAG(d);
+  //! @return nullptr if the DAG of h was destroyed
+  DAGptr get(const DAGhandle& h) const {
+    std::lock_guard<std::mutex> lk(mMutex);
+    if (h.mIndex >= mSlots.size()) {
+      return nullptr;
+    }
+    Slot& s = const_cast<Slot&>(mSlots[h.mIndex]);
+    return (s.mGen == h.mGen && s.mState == SlotState::LIVE) ? s.dag() : nullptr;
+  }
+
+  /**
+   * Keep up to maxWarm destroyed DAGs for reuse. 0, the default, frees DAGs on
+   * destroyDAG. Lowering it frees the excess right away.
+   */
+  void setMaxWarm(size_t maxWarm) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    mMaxWarm = maxWarm;
+    trimWarm(maxWarm);
+  }
+
+  size_t maxWarm(void) const {
+    std::lock_guard<std::mutex> lk(mMutex);
+    return mMaxWarm;
+  }
 
-    mDAGmap[id] = nullptr;
+  size_t numLive(void) const {
+    std::lock_guard<std::mutex> lk(mMutex);
+    return mNumLive;
   }
 
-  template <bool D = DAG_ID_FLAG>
-  typename std::enable_if<!D>::type destroyDAG(DAGptr d) {
-    assert(!mDAGmap.empty());
-    assert(std::find(mDAGmap.cbegin(), mDAGmap.cend(), d) != mDAGmap.cend() &&
-           "DAG not found in DAGmanager");
+  size_t numWarm(void) const {
+    std::lock_guard<std::mutex> lk(mMutex);
+    return mWarmSlots.size();
+  }
 
-    auto i = std::remove(mDAGmap.begin(), mDAGmap.end(), d);
-    assert(*i == mDAGmap.back());
-    mDAGmap.pop_back();
+  //! slots allocated so far, i.e., the peak number of DAGs alive or warm
+  size_t numSlots(void) const {
+    std::lock_guard<std::mutex> lk(mMutex);
+    return mSlots.size();
+  }
 
-    freeDAG(d);
+  /**
+   * Make a DAG from a file written by saveDAG, with node data decoded by codec.
+   * Needs dagee/DAGserialize.h. @return nullptr if the file can't be loaded
+   */
+  template <typename C>
+  DAGptr makeDAGfromFile(const char* path, const C& codec) {
+    DAGptr d = makeDAG();
+    if (!loadDAG(*d, path, codec)) {
+      destroyDAG(d);
+      return nullptr;
+    }
+    return d;
   }
 
   ~DAGmanager(void) { destroyAllDAGs(); }
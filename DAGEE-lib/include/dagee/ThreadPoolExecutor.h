@@ -0,0 +1,323 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_THREAD_POOL_EXECUTOR_H
+#define DAGEE_INCLUDE_DAGEE_THREAD_POOL_EXECUTOR_H
+
+#include "dagee/ExecutorAccess.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dagee {
+
+class ThreadPoolExecutor;
+
+namespace impl {
+
+/**
+ * A task of ThreadPoolExecutor. mPending counts the predecessors not done
+ * yet, plus one while the task is being made, and plus one for activation if
+ * the task has no predecessors. The task is queued when it drops to 0.
+ */
+struct PoolTask {
+  using Ptr = std::shared_ptr<PoolTask>;
+
+  std::function<void(void)> mFunc;
+  std::atomic<size_t> mPending;
+  std::atomic<bool> mDone;
+  //! guards mDone against successors registering concurrently
+  std::mutex mMutex;
+  std::vector<Ptr> mSuccs;
+
+  explicit PoolTask(std::function<void(void)>&& func)
+      : mFunc(std::move(func)), mPending(1), mDone(false), mMutex(), mSuccs() {}
+
+  // seq_cst, see ThreadPoolExecutor::run
+  bool isDone(void) const noexcept { return mDone.load(); }
+};
+
+//! opaque handle to a task of ThreadPoolExecutor
+class ThreadPoolTaskHandle {
+  friend class dagee::ThreadPoolExecutor;
+
+  PoolTask::Ptr mTask;
+
+  explicit ThreadPoolTaskHandle(const PoolTask::Ptr& t) noexcept : mTask(t) {}
+
+ public:
+  ThreadPoolTaskHandle(void) noexcept : mTask() {}
+
+  bool valid(void) const noexcept { return bool(mTask); }
+
+  bool isDone(void) const noexcept { return mTask->isDone(); }
+
+  bool operator==(const ThreadPoolTaskHandle& that) const noexcept {
+    return mTask == that.mTask;
+  }
+  bool operator!=(const ThreadPoolTaskHandle& that) const noexcept { return !(*this == that); }
+};
+
+} // end namespace impl
+
+using ThreadPoolTaskHandle = impl::ThreadPoolTaskHandle;
+
+//! a host function registered with ThreadPoolExecutor::registerKernel
+template <typename... Args>
+struct ThreadPoolKernel {
+  void (*mFuncPtr)(Args...);
+};
+
+struct ThreadPoolTaskInstance {
+  std::function<void(void)> mFunc;
+};
+
+/**
+ * Runs host tasks on a pool of worker threads, with dependencies between tasks
+ * tracked in-process. Implements the executor concept of HypotheticalExecutor
+ * (see ATMIbaseExecutor.h) without ATMI, HIP or ROCm, so the DAG executors
+ * built on that concept alone (see DAGexecutor.h) also run on plain hosts.
+ *
+ * A task is queued once its predecessors are done, without a round trip
+ * through a runtime or a device queue. Threads waiting on a task run queued
+ * tasks in the meantime, so a task may wait on others without deadlock.
+ */
+class ThreadPoolExecutor {
+ public:
+  using TaskInstance = ThreadPoolTaskInstance;
+  using TaskHandle = ThreadPoolTaskHandle;
+
+ protected:
+  using PoolTask = impl::PoolTask;
+
+  std::mutex mMutex;
+  std::condition_variable mWork;
+  //! threads blocked in wait(), woken whenever a task completes
+  std::condition_variable mCompletion;
+  std::atomic<size_t> mNumWaiters;
+  std::deque<PoolTask::Ptr> mQueue;
+  std::vector<std::thread> mWorkers;
+  bool mStop = false;
+
+  // make non-copyable or assignable
+  ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+  ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+  template <typename>
+  friend struct ExecutorAccess;
+
+  void enqueue(const PoolTask::Ptr& t) {
+    {
+      std::lock_guard<std::mutex> lk(mMutex);
+      mQueue.push_back(t);
+    }
+    mWork.notify_one();
+  }
+
+  void release(const PoolTask::Ptr& t) {
+    if (t->mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      enqueue(t);
+    }
+  }
+
+  void run(const PoolTask::Ptr& t) {
+    t->mFunc();
+
+    std::vector<PoolTask::Ptr> succs;
+    {
+      std::lock_guard<std::mutex> lk(t->mMutex);
+      t->mDone.store(true);
+      succs.swap(t->mSuccs);
+    }
+
+    for (const auto& s : succs) {
+      release(s);
+    }
+
+    // mDone and mNumWaiters are seq_cst, so either a waiter sees mDone or it is
+    // seen here
+    if (mNumWaiters.load() > 0) {
+      std::lock_guard<std::mutex> lk(mMutex);
+      mCompletion.notify_all();
+    }
+  }
+
+  void workerLoop(void) {
+    std::unique_lock<std::mutex> lk(mMutex);
+    while (true) {
+      mWork.wait(lk, [this] { return mStop || !mQueue.empty(); });
+      if (mQueue.empty()) {
+        return; // stopping, and nothing left to run
+      }
+
+      PoolTask::Ptr t = std::move(mQueue.front());
+      mQueue.pop_front();
+
+      lk.unlock();
+      run(t);
+      lk.lock();
+    }
+  }
+
+  //! make a task that runs once preds are done, and, if preds is empty, once activated
+  template <typename I>
+  TaskHandle makeTaskImpl(const TaskInstance& ti, const I& predBeg, const I& predEnd) {
+    auto func = ti.mFunc;
+    auto t = std::make_shared<PoolTask>(std::move(func));
+
+    size_t numPreds = 0;
+    for (auto i = predBeg; i != predEnd; ++i) {
+      const PoolTask::Ptr& p = i->mTask;
+      assert(p && "invalid predecessor handle");
+      ++numPreds;
+
+      std::lock_guard<std::mutex> lk(p->mMutex);
+      if (!p->isDone()) {
+        t->mPending.fetch_add(1, std::memory_order_relaxed);
+        p->mSuccs.push_back(t);
+      }
+    }
+
+    // drop the guard held while making the task, which a source keeps until activated
+    if (numPreds > 0) {
+      release(t);
+    }
+    return TaskHandle(t);
+  }
+
+  template <typename V = std::initializer_list<TaskHandle> >
+  TaskHandle makeInternalTask(const TaskInstance& ti, const V& predHandles = V()) {
+    static_assert(std::is_same<typename V::value_type, TaskHandle>::value,
+                  "predHandles has the wrong type");
+    return makeTaskImpl(ti, predHandles.begin(), predHandles.end());
+  }
+
+  static void invokeN(unsigned numThreads, const std::function<void(void)>& f) {
+    for (unsigned i = 0; i < numThreads; ++i) {
+      f();
+    }
+  }
+
+ public:
+  //! @param numWorkers: 0 for one per hardware thread
+  explicit ThreadPoolExecutor(unsigned numWorkers = 0) : mNumWaiters(0) {
+    if (numWorkers == 0) {
+      numWorkers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < numWorkers; ++i) {
+      mWorkers.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  //! runs the tasks queued already. Tasks never activated are dropped
+  ~ThreadPoolExecutor(void) {
+    {
+      std::lock_guard<std::mutex> lk(mMutex);
+      mStop = true;
+    }
+    mWork.notify_all();
+    for (auto& w : mWorkers) {
+      w.join();
+    }
+  }
+
+  size_t numWorkers(void) const noexcept { return mWorkers.size(); }
+
+  /**
+   * Same as CpuKernelRegAtmiPolicy::registerKernel, for a uniform interface
+   * across executors. Nothing needs registering, the function is just recorded
+   * with its signature
+   */
+  template <typename... Args>
+  ThreadPoolKernel<Args...> registerKernel(void (*funcPtr)(Args...)) const {
+    return ThreadPoolKernel<Args...>{funcPtr};
+  }
+
+  /**
+   * Task calling the function of kern with args, numThreads times in a row,
+   * like a CPU task of CpuExecutorAtmi. args are copied into the task
+   */
+  template <typename... KArgs, typename... Args>
+  TaskInstance makeTask(unsigned numThreads, const ThreadPoolKernel<KArgs...>& kern,
+                        Args&&... args) const {
+    static_assert(sizeof...(KArgs) == sizeof...(Args), "wrong number of kernel args");
+    std::function<void(void)> f = std::bind(kern.mFuncPtr, std::forward<Args>(args)...);
+    return TaskInstance{[numThreads, f] { invokeN(numThreads, f); }};
+  }
+
+  //! task calling func(), any callable
+  template <typename F>
+  TaskInstance makeTask(F&& func) const {
+    return TaskInstance{std::function<void(void)>(std::forward<F>(func))};
+  }
+
+  template <typename V = std::initializer_list<TaskHandle> >
+  TaskHandle launchTask(const TaskInstance& ti, const V& predHandles = V()) {
+    TaskHandle h = makeInternalTask(ti, predHandles);
+    if (predHandles.size() == 0) {
+      activateTask(h);
+    }
+    return h;
+  }
+
+  //! start a task made without predecessors
+  void activateTask(const TaskHandle& h) {
+    assert(h.valid() && "invalid task handle");
+    release(h.mTask);
+  }
+
+  template <typename I>
+  void activateTasks(const I& beg, const I& end) {
+    for (auto i = beg; i != end; ++i) {
+      activateTask(*i);
+    }
+  }
+
+  //! block until the task of h is done, running queued tasks meanwhile
+  void waitOnTask(const TaskHandle& h) {
+    assert(h.valid() && "invalid task handle");
+    if (h.isDone()) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lk(mMutex);
+    mNumWaiters.fetch_add(1);
+    while (!h.isDone()) {
+      if (mQueue.empty()) {
+        mCompletion.wait(lk);
+        continue;
+      }
+
+      PoolTask::Ptr t = std::move(mQueue.front());
+      mQueue.pop_front();
+
+      lk.unlock();
+      run(t);
+      lk.lock();
+    }
+    mNumWaiters.fetch_sub(1);
+  }
+
+  template <typename I>
+  void waitOnTasks(const I& beg, const I& end) {
+    for (auto i = beg; i != end; ++i) {
+      waitOnTask(*i);
+    }
+  }
+
+  void waitOnTasks(std::initializer_list<TaskHandle> l) { waitOnTasks(l.begin(), l.end()); }
+};
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_THREAD_POOL_EXECUTOR_H
@@ -0,0 +1,244 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGEE_WORK_STEALING_H
+#define DAGEE_INCLUDE_DAGEE_WORK_STEALING_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dagee {
+
+/**
+ * Chase-Lev work-stealing deque (as formulated for C11 atomics by Le et al.,
+ * PPoPP'13). The owner thread pushes and takes at the bottom (LIFO), any other
+ * thread steals from the top (FIFO). The circular buffer grows on demand; old
+ * buffers are retired and freed only when the deque is destroyed, because a
+ * concurrent thief may still be reading from them.
+ *
+ * T must be trivially copyable, e.g. a pointer or an index
+ */
+template <typename T>
+class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+  struct Buffer {
+    const int64_t mCapacity;
+    const int64_t mMask;
+    std::unique_ptr<std::atomic<T>[]> mElems;
+
+    explicit Buffer(int64_t cap)
+        : mCapacity(cap), mMask(cap - 1), mElems(new std::atomic<T>[static_cast<size_t>(cap)]) {
+      assert((cap & (cap - 1)) == 0 && "capacity must be a power of 2");
+    }
+
+    T get(int64_t i) const noexcept { return mElems[i & mMask].load(std::memory_order_relaxed); }
+
+    void put(int64_t i, const T& x) noexcept { mElems[i & mMask].store(x, std::memory_order_relaxed); }
+
+    Buffer* grow(int64_t bottom, int64_t top) const {
+      Buffer* b = new Buffer(2 * mCapacity);
+      for (int64_t i = top; i < bottom; ++i) {
+        b->put(i, get(i));
+      }
+      return b;
+    }
+  };
+
+  constexpr static const size_t CACHE_LINE = 64;
+
+  // padding instead of alignas, since C++11 operator new ignores extended alignment
+  std::atomic<int64_t> mTop;
+  char mPadTop[CACHE_LINE - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> mBottom;
+  char mPadBottom[CACHE_LINE - sizeof(std::atomic<int64_t>)];
+  std::atomic<Buffer*> mBuffer;
+  std::vector<std::unique_ptr<Buffer> > mRetired;
+
+ public:
+  explicit WorkStealingDeque(int64_t initCapacity = 1024) : mTop(0), mBottom(0), mBuffer(nullptr) {
+    mRetired.emplace_back(new Buffer(initCapacity));
+    mBuffer.store(mRetired.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  //! owner only
+  void push(const T& x) {
+    int64_t b = mBottom.load(std::memory_order_relaxed);
+    int64_t t = mTop.load(std::memory_order_acquire);
+    Buffer* a = mBuffer.load(std::memory_order_relaxed);
+
+    if (b - t > a->mCapacity - 1) {
+      a = a->grow(b, t);
+      mRetired.emplace_back(a);
+      mBuffer.store(a, std::memory_order_release);
+    }
+
+    a->put(b, x);
+    std::atomic_thread_fence(std::memory_order_release);
+    mBottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  //! owner only. @return false if the deque was empty
+  bool take(T& out) {
+    int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+    Buffer* a = mBuffer.load(std::memory_order_relaxed);
+    mBottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = mTop.load(std::memory_order_relaxed);
+
+    bool found = false;
+    if (t <= b) {
+      out = a->get(b);
+      found = true;
+      if (t == b) {
+        // last element, race against thieves
+        if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+          found = false;
+        }
+        mBottom.store(b + 1, std::memory_order_relaxed);
+      }
+    } else {
+      mBottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return found;
+  }
+
+  //! any thread. @return false if the deque was empty or the race was lost
+  bool steal(T& out) {
+    int64_t t = mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = mBottom.load(std::memory_order_acquire);
+
+    if (t < b) {
+      Buffer* a = mBuffer.load(std::memory_order_acquire);
+      T x = a->get(t);
+      if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        return false;
+      }
+      out = x;
+      return true;
+    }
+    return false;
+  }
+
+  bool empty(void) const {
+    return mBottom.load(std::memory_order_relaxed) <= mTop.load(std::memory_order_relaxed);
+  }
+};
+
+//! handle passed to the body of runWorkStealing for publishing new work items
+template <typename T>
+class WorkPusher {
+  WorkStealingDeque<T>& mDeq;
+  std::atomic<size_t>& mPending;
+
+ public:
+  WorkPusher(WorkStealingDeque<T>& d, std::atomic<size_t>& pending) noexcept
+      : mDeq(d), mPending(pending) {}
+
+  void operator()(const T& x) const {
+    // counted before a thief can see it, see runWorkStealing
+    mPending.fetch_add(1, std::memory_order_relaxed);
+    mDeq.push(x);
+  }
+};
+
+namespace impl {
+
+/**
+ * Run body(item, push) on numThreads threads (the calling thread is one of them)
+ * until no item is left. Each worker owns a WorkStealingDeque, processes its
+ * own work in LIFO order and steals from randomly chosen victims when it runs
+ * out. body receives a WorkPusher<T>& and calls push(newItem) to make new items
+ * available, e.g., successors that became ready.
+ *
+ * Items pushed but not yet processed, including the ones being processed, are
+ * counted, so workers stop as soon as no work is left anywhere. Nodes on a cycle
+ * never become ready, so fewer than numItems items get processed then, which is
+ * asserted, like the serial traversals do.
+ */
+template <typename T, typename I, typename B>
+void runWorkStealing(unsigned numThreads, I initBeg, I initEnd, size_t numItems, B& body) {
+  assert(numThreads > 0 && "need at least one thread");
+
+  using Deque = WorkStealingDeque<T>;
+  std::vector<std::unique_ptr<Deque> > deques;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    deques.emplace_back(new Deque());
+  }
+
+  // distribute the initial items before any worker starts
+  unsigned next = 0;
+  for (I i = initBeg; i != initEnd; ++i) {
+    deques[next]->push(*i);
+    next = (next + 1) % numThreads;
+  }
+
+  std::atomic<size_t> pending(static_cast<size_t>(std::distance(initBeg, initEnd)));
+  std::vector<size_t> numProcessed(numThreads, 0);
+
+  auto worker = [&](unsigned me) {
+    Deque& myDeq = *deques[me];
+    WorkPusher<T> push(myDeq, pending);
+
+    uint64_t rng = 0x9E3779B97F4A7C15ull * (me + 1);
+    size_t myProcessed = 0;
+
+    T item;
+    while (pending.load(std::memory_order_acquire) > 0) {
+      bool found = myDeq.take(item);
+
+      for (unsigned k = 0; !found && k < 2 * numThreads; ++k) {
+        // xorshift64 to pick a victim
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        unsigned victim = static_cast<unsigned>(rng % numThreads);
+        if (victim != me) {
+          found = deques[victim]->steal(item);
+        }
+      }
+
+      if (found) {
+        body(item, push);
+        ++myProcessed;
+        pending.fetch_sub(1, std::memory_order_acq_rel);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    numProcessed[me] = myProcessed;
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < numThreads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+
+  worker(0);
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  assert(std::accumulate(numProcessed.cbegin(), numProcessed.cend(), size_t(0)) == numItems &&
+         "cycle detected, graph is not a DAG");
+  (void)numItems;
+}
+
+} // end namespace impl
+
+} // end namespace dagee
+
+#endif // DAGEE_INCLUDE_DAGEE_WORK_STEALING_H
@@ -82,6 +82,10 @@ struct ExecutableState {
   }
 
   void init() noexcept {
+#ifdef DAGR_EMULATE_HSA
+    // no code objects to load, one empty executable finds all host kernels
+    loadMemory(std::string());
+#else
     dagee::KernelSectionParser<> kparser;
     kparser.parseKernelSections();
 
@@ -90,6 +94,7 @@ struct ExecutableState {
         loadMemory(blob.bytes());
       }
     }
+#endif
   }
 
   explicit ExecutableState(const Agent& agent) noexcept :
@@ -5,8 +5,8 @@
 
 #include "dagr/executor.h"
 
+#include <algorithm>
 #include <vector>
-#include <unordered_set>
 
 namespace dagr {
 
@@ -34,121 +34,384 @@ struct alignas(alignof(T)) LazyObject {
   }
 };
 
+//! no cost model given: the tasks of a level are dispatched in node index order
+struct NoCostModel {};
+
+/**
+ * Executes a DAG level by level, each level as one batch. Given a cost model
+ * (see dagee/CostModel.h), the tasks of a level are dispatched in decreasing
+ * bottom level (see DAGbase::computeBottomLevels), so that the tasks on the
+ * critical path get the queues first.
+ */
 struct StaticDAGExecutorBFS {
 
   SerialUnorderedExecutor* mUnordExec;
 
+  using BottomLevels = std::vector<double>;
 
   template <typename DAG>
-  void executeFromHost(DAG* dag) {
+  static void computeBottomLevels(DAG*, const NoCostModel&, BottomLevels& bl) {
+    bl.clear();
+  }
 
-    using NodePtr = typename DAG::NodePtr;
+  template <typename DAG, typename C>
+  static void computeBottomLevels(DAG* dag, const C& cost, BottomLevels& bl) {
+    dag->computeBottomLevels(cost, bl);
+  }
 
-    // using LevelBag = std::vector<NodePtr>;
-    // set needed to eliminate duplicates when populating the next level (or
-    // frontier) using the outgoing edges of the current level (or frontier)
-    using LevelBag = std::unordered_set<NodePtr>;
+  //! the nodes of level l in dispatch order, by decreasing bottom level unless bl is empty
+  template <typename L, typename V>
+  static void orderLevel(const L& levels, unsigned l, const BottomLevels& bl, V& order) {
+    auto lev = levels.level(l);
+    order.assign(lev.begin(), lev.end());
+    if (!bl.empty()) {
+      using NodePtr = typename V::value_type;
+      std::stable_sort(order.begin(), order.end(), [&bl] (NodePtr a, NodePtr b) {
+        return bl[a->frozenIndex()] > bl[b->frozenIndex()];
+      });
+    }
+  }
 
-    LevelBag currLevel;
-    LevelBag nextLevel;
+  template <typename DAG, typename C = NoCostModel>
+  void executeFromHost(DAG* dag, const C& cost = C()) {
+
+    using NodePtr = typename DAG::NodePtr;
 
-    LevelBag* currPtr = &currLevel;
-    LevelBag* nextPtr = &nextLevel;
+    // levels by longest-path depth, so that a node only runs after all of its
+    // predecessors. Computed once and cached by the DAG
+    const auto& levels = dag->computeLevels();
 
-    dag->forEachSource( [&] (NodePtr n) {
-          // currLevel.emplace_back(n);
-          currLevel.emplace(n);
-        });
+    BottomLevels bl;
+    computeBottomLevels(dag, cost, bl);
+    std::vector<NodePtr> order;
 
-    while (!currPtr->empty()) {
+    for (unsigned l = 0; l < levels.numLevels(); ++l) {
 
       auto batchState = mUnordExec->startBatch();
 
-      for (NodePtr n: *currPtr) {
+      orderLevel(levels, l, bl, order);
+      for (NodePtr n: order) {
         const auto& nodeData = dag->nodeData(n);
         mUnordExec->addToBatch(batchState, nodeData);
       }
 
       auto th = mUnordExec->launchBatch(batchState);
 
-      // prepare next level
-      nextPtr->clear();
-      for (NodePtr n: *currPtr) {
-        for (NodePtr succ: dag->successors(n)) {
-          // nextPtr->emplace_back(succ);
-          nextPtr->emplace(succ);
-        }
-      }
-
-      std::swap(currPtr, nextPtr);
-
       mUnordExec->waitOnTask(th);
     }
   }
 
 
-  template <typename DAG>
-  void executeFromCP(DAG* dag) {
+  template <typename DAG, typename C = NoCostModel>
+  void executeFromCP(DAG* dag, const C& cost = C()) {
 
     using NodePtr = typename DAG::NodePtr;
 
-    // using LevelBag = std::vector<NodePtr>;
-    // set needed to eliminate duplicates when populating the next level (or
-    // frontier) using the outgoing edges of the current level (or frontier)
-    using LevelBag = std::unordered_set<NodePtr>;
-
-    LevelBag currLevel;
-    LevelBag nextLevel;
+    const auto& levels = dag->computeLevels();
 
-    LevelBag* currPtr = &currLevel;
-    LevelBag* nextPtr = &nextLevel;
-
-    dag->forEachSource([&] (NodePtr n) {
-          currLevel.emplace(n);
-        });
+    BottomLevels bl;
+    computeBottomLevels(dag, cost, bl);
+    std::vector<NodePtr> order;
 
     auto prevBatchSig = impl::NULL_SIGNAL;
 
-    bool first = true;
-    while (!currPtr->empty()) {
+    for (unsigned l = 0; l < levels.numLevels(); ++l) {
 
       using BatchState = SerialUnorderedExecutor::BatchState;
       LazyObject<BatchState> batchState;
 
-      if (first) {
-        first = false;
+      if (l == 0) {
         batchState.init(mUnordExec->startBatch());
       } else {
         batchState.init(mUnordExec->startBatchWithDep(prevBatchSig));
       }
 
-      for (NodePtr n: *currPtr) {
+      orderLevel(levels, l, bl, order);
+      for (NodePtr n: order) {
         auto& nodeData = dag->nodeData(n);
         mUnordExec->addToBatch(batchState.get(), nodeData);
       }
 
       auto taskHand = mUnordExec->launchBatch(batchState.get());
       prevBatchSig = taskHand.mSignal;
+    }
 
-      // prepare next level
-      nextPtr->clear();
-      for (NodePtr n: *currPtr) {
-        for (NodePtr succ: dag->successors(n)) {
-          nextPtr->emplace(succ);
-        }
+    if (prevBatchSig != impl::NULL_SIGNAL) {
+      impl::waitOnSignalAcquire(prevBatchSig);
+    }
+
+  }
+
+  /**
+   * Add to the batch the chains (see DAGbase::computeChains) whose head is in
+   * order, the nodes of a level (see orderLevel), each as an in-order
+   * macro-task. Chains run within the batch of their head: every successor of
+   * a chain is in a later level than its tail, hence than its head.
+   */
+  template <typename DAG, typename V, typename C>
+  void addChainsToBatch(DAG* dag, const V& order, const C& chains,
+      SerialUnorderedExecutor::BatchState& batchState) {
+
+    for (auto n: order) {
+      const auto i = n->frozenIndex();
+      if (!chains.isHead(i)) {
+        continue;
+      }
+
+      auto chain = chains.chain(chains.chainOf(i));
+
+      if (chain.size() == 1) {
+        mUnordExec->addToBatch(batchState, dag->nodeData(n));
+        continue;
       }
 
-      std::swap(currPtr, nextPtr);
+      auto chainState = mUnordExec->startChain(batchState);
+      for (auto c = chain.begin(); c != chain.end() - 1; ++c) {
+        mUnordExec->addToChain(batchState, chainState, dag->nodeData(*c));
+      }
+      mUnordExec->finishChain(batchState, chainState, dag->nodeData(chain.tail()));
+    }
+  }
+
+  //! levels made only of chain interiors have nothing to launch
+  template <typename L, typename C>
+  static bool hasChainHeads(const L& levels, const C& chains, unsigned l) {
+    for (auto n: levels.level(l)) {
+      if (chains.isHead(n->frozenIndex())) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //! same as executeFromHost, with chains fused into macro-tasks
+  template <typename DAG, typename C = NoCostModel>
+  void executeFusedFromHost(DAG* dag, const C& cost = C()) {
+
+    const auto& chains = dag->computeChains();
+    const auto& levels = dag->computeLevels();
+
+    BottomLevels bl;
+    computeBottomLevels(dag, cost, bl);
+    std::vector<typename DAG::NodePtr> order;
+
+    for (unsigned l = 0; l < levels.numLevels(); ++l) {
+
+      if (!hasChainHeads(levels, chains, l)) {
+        continue;
+      }
+
+      auto batchState = mUnordExec->startBatch();
+
+      orderLevel(levels, l, bl, order);
+      addChainsToBatch(dag, order, chains, batchState);
+
+      auto th = mUnordExec->launchBatch(batchState);
+
+      mUnordExec->waitOnTask(th);
+    }
+  }
+
+  //! same as executeFromCP, with chains fused into macro-tasks
+  template <typename DAG, typename C = NoCostModel>
+  void executeFusedFromCP(DAG* dag, const C& cost = C()) {
+
+    const auto& chains = dag->computeChains();
+    const auto& levels = dag->computeLevels();
+
+    BottomLevels bl;
+    computeBottomLevels(dag, cost, bl);
+    std::vector<typename DAG::NodePtr> order;
+
+    auto prevBatchSig = impl::NULL_SIGNAL;
+
+    for (unsigned l = 0; l < levels.numLevels(); ++l) {
+
+      if (!hasChainHeads(levels, chains, l)) {
+        continue;
+      }
+
+      using BatchState = SerialUnorderedExecutor::BatchState;
+      LazyObject<BatchState> batchState;
+
+      if (prevBatchSig == impl::NULL_SIGNAL) {
+        batchState.init(mUnordExec->startBatch());
+      } else {
+        batchState.init(mUnordExec->startBatchWithDep(prevBatchSig));
+      }
+
+      orderLevel(levels, l, bl, order);
+      addChainsToBatch(dag, order, chains, batchState.get());
+
+      auto taskHand = mUnordExec->launchBatch(batchState.get());
+      prevBatchSig = taskHand.mSignal;
     }
 
     if (prevBatchSig != impl::NULL_SIGNAL) {
-      impl::waitOnSignalRelaxed(prevBatchSig);
+      impl::waitOnSignalAcquire(prevBatchSig);
     }
 
   }
 };
 
 
+/**
+ * Executes a DAG as dataflow on the command processor: instead of a barrier
+ * between levels, as StaticDAGExecutorBFS::executeFromCP, each task waits on
+ * its own predecessors only, so a slow task holds back only its successors.
+ *
+ * Tasks are placed on the queues of the executor in topological order. Every
+ * dispatch sets the barrier bit, so an edge within a queue costs nothing: the
+ * chains of the DAG (see DAGbase::computeChains) stay on one queue, and a
+ * chain whose predecessor is the last task placed on a queue continues that
+ * queue. Other chains go round robin. A task with predecessors on other
+ * queues is preceded by a barrier-AND on their signals (a tree beyond 5, see
+ * PacketFactory::makeBarrierTree). By the barrier bit, a predecessor done
+ * implies those before it in its queue are done too, so only the last one
+ * from each queue is waited on. Only tasks with successors on other queues,
+ * or last in their queue, get a signal.
+ *
+ * As tasks are placed in topological order, a packet only waits on packets
+ * placed before it, so queues can't deadlock each other.
+ */
+struct StaticDAGExecutorDataflow {
+
+  SerialUnorderedExecutor* mUnordExec;
+
+  template <typename DAG>
+  void executeFromCP(DAG* dag) {
+
+    using Index = typename DAG::Index;
+    using IndexVec = std::vector<Index>;
+    using SignalVec = std::vector<Signal>;
+
+    const auto& chains = dag->computeChains();
+    const auto& fz = dag->frozen();
+
+    const Index numNodes = fz.size();
+    if (numNodes == 0) {
+      return;
+    }
+
+    const Index NONE = DAG::Frozen::INVALID_INDEX;
+    const size_t numQs = mUnordExec->numQueues();
+    auto& sigPool = mUnordExec->execResource().signalPool();
+
+    IndexVec queueOf(numNodes, 0);
+    IndexVec posOf(numNodes, 0);
+    IndexVec lastOn(numQs, NONE);
+    IndexVec queueLen(numQs, 0);
+    size_t nextQ = 0ul;
+
+    // assign queues, in the order the tasks will be placed
+    for (Index i: fz.topoOrder()) {
+      size_t q = numQs;
+
+      for (Index p: fz.predecessors(i)) {
+        bool sameChain = chains.chainOf(p) == chains.chainOf(i);
+        if (sameChain || (chains.isHead(i) && lastOn[queueOf[p]] == p)) {
+          q = queueOf[p];
+          break;
+        }
+      }
+
+      if (q == numQs) {
+        q = nextQ;
+        nextQ = (nextQ + 1) % numQs;
+      }
+
+      queueOf[i] = q;
+      posOf[i] = queueLen[q]++;
+      lastOn[q] = i;
+    }
+
+    SignalVec sigOf(numNodes, impl::NULL_SIGNAL);
+    SignalVec usedSigs;
+
+    auto takeSignal = [&] () {
+      Signal sig = sigPool.takeUserSignal();
+      hsa_signal_store_relaxed(sig, 1);
+      usedSigs.emplace_back(sig);
+      return sig;
+    };
+
+    for (Index i = 0; i < numNodes; ++i) {
+      bool needSig = lastOn[queueOf[i]] == i;
+      for (Index s: fz.successors(i)) {
+        needSig = needSig || queueOf[s] != queueOf[i];
+      }
+      if (needSig) {
+        sigOf[i] = takeSignal();
+      }
+    }
+
+    // last predecessor from each other queue, for the task being placed
+    IndexVec lastPredFrom(numQs, NONE);
+    IndexVec predQueues;
+    SignalVec predSigs;
+    SignalVec treeSigs;
+
+    auto addJoin = [&] (size_t q, const Signal& compSig, const FenceScope& scope) {
+      treeSigs.clear();
+      const size_t numTreeSigs = PacketFactory::barrierTreeNumSignals(predSigs.size());
+      for (size_t k = 0; k < numTreeSigs; ++k) {
+        treeSigs.emplace_back(takeSignal());
+      }
+      mUnordExec->addJoin(q, compSig, predSigs, predSigs.size(), treeSigs.data(), scope);
+    };
+
+    for (Index i: fz.topoOrder()) {
+      const size_t q = queueOf[i];
+
+      for (Index p: fz.predecessors(i)) {
+        const size_t r = queueOf[p];
+        if (r == q) {
+          continue;
+        }
+        if (lastPredFrom[r] == NONE) {
+          predQueues.emplace_back(r);
+          lastPredFrom[r] = p;
+        } else if (posOf[p] > posOf[lastPredFrom[r]]) {
+          lastPredFrom[r] = p;
+        }
+      }
+
+      predSigs.clear();
+      for (Index r: predQueues) {
+        predSigs.emplace_back(sigOf[lastPredFrom[r]]);
+        lastPredFrom[r] = NONE;
+      }
+      predQueues.clear();
+
+      if (!predSigs.empty()) {
+        addJoin(q, impl::NULL_SIGNAL, FenceScope::AGENT);
+      }
+
+      mUnordExec->addInOrder(q, dag->nodeData(fz.node(i)), sigOf[i]);
+    }
+
+    // the DAG is done when the last task of each queue is
+    predSigs.clear();
+    for (Index last: lastOn) {
+      if (last != NONE) {
+        predSigs.emplace_back(sigOf[last]);
+      }
+    }
+
+    Signal finalSig = takeSignal();
+    addJoin(0ul, finalSig, FenceScope::SYSTEM);
+
+    mUnordExec->flush();
+    impl::waitOnSignalAcquire(finalSig);
+
+    // the pool hands out signals set to 1
+    for (const auto& sig: usedSigs) {
+      hsa_signal_store_relaxed(sig, 1);
+      sigPool.returnUserSignal(sig);
+    }
+  }
+};
+
 
 } // end namespace dagr
 
@@ -9,6 +9,10 @@
 #include "dagr/queue.h"
 
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -122,12 +126,14 @@ struct SerialGpuExecutorBase {
     assert(pkt);
 
     PacketFactory::init(reinterpret_cast<KernelDispatchPkt*>(pkt), header, ki, compSig);
+    dispatchQ.addPendingBytes(ki.mKernInfoPtr->kernArgBufSize());
   }
 
   void waitOnTask(const TaskHandle& th) noexcept {
-    impl::waitOnSignalRelaxed(th.mSignal);
+    // acquire, so that the caller sees what the task wrote
+    impl::waitOnSignalAcquire(th.mSignal);
+    // impl::waitOnSignalRelaxed(th.mSignal);
     //impl::waitOnSignalBusy(th.mSignal);
-    // impl::waitOnSignalAcquire(th.mSignal);
     // FIXME: figure out the right logic to return signals efficiently
     //hsa_signal_store_relaxed(th.mSignal, 1);
     // execResource().signalPool().returnUserSignal(th.mSignal);
@@ -153,9 +159,29 @@ struct SerialOrderedExecutor: public SerialGpuExecutorBase {
   {}
 
   ~SerialOrderedExecutor() {
+    flush();
     execResource().queuePool().returnSerialQueue(mDispQueue.hsaQueue());
   }
 
+  //! see SubmitPolicy. Pending packets are submitted first
+  void setSubmitPolicy(const SubmitPolicy& policy) noexcept {
+    mDispQueue.setSubmitPolicy(policy);
+  }
+
+  SubmitStats submitStats() const noexcept {
+    return mDispQueue.submitStats();
+  }
+
+  //! ring the doorbell for packets held back by the submit policy
+  void flush() noexcept {
+    mDispQueue.submitPackets();
+  }
+
+  void waitOnTask(const TaskHandle& th) noexcept {
+    flush();
+    Base::waitOnTask(th);
+  }
+
   void addTaskImpl(const GpuKernInstance& ki, const Signal& compSig, const FenceScope& scope) noexcept {
 
     PacketHeader header(PacketKind::KERNEL_DISPATCH, scope, BarrierBit::ENABLE);
@@ -166,14 +192,14 @@ struct SerialOrderedExecutor: public SerialGpuExecutorBase {
     Signal compSig = execResource().signalPool().takeUserSignal();
     addTaskImpl(ki, compSig, FenceScope::SYSTEM);
     // addTaskImpl(ki, compSig, FenceScope::AGENT);
-    mDispQueue.submitPackets();
+    mDispQueue.submitIfDue();
 
     return TaskHandle {compSig};
   }
 
   void launchAndForget(const GpuKernInstance& ki) noexcept {
     addTaskImpl(ki, impl::NULL_SIGNAL, FenceScope::SYSTEM);
-    mDispQueue.submitPackets();
+    mDispQueue.submitIfDue();
   }
 
   struct BatchState {
@@ -213,23 +239,73 @@ class SerialUnorderedExecutor: public SerialGpuExecutorBase {
 
   constexpr static const size_t MAX_ACTIVE_QUEUES = 64ul;
 
+  using SignalVec = std::vector<Signal>;
+
+  /**
+   * Signals of a launched batch other than its final one, i.e., the per queue
+   * ones and those of its barrier tree, returned to the pool once the final
+   * one is seen done (see recycleSignals)
+   */
+  struct InFlightBatch {
+    Signal mFinalSig;
+    SignalVec mSignals;
+  };
+
   size_t mNumQueues;
   QueuesVec mQueues;
   size_t mCurrQid = 0ul;
+  std::vector<InFlightBatch> mInFlight;
 
   size_t nextQid() noexcept {
-    do {
+    // prefer a queue with free slots. If all are full, giveOneSlot submits
+    // the pending packets of the one picked and waits
+    for (size_t i = 0; i < mNumQueues; ++i) {
       mCurrQid = (mCurrQid + 1) % mNumQueues;
-    } while (mQueues[mCurrQid].full());
+      if (!mQueues[mCurrQid].full()) {
+        break;
+      }
+    }
 
     assert(mCurrQid < mQueues.size());
     return mCurrQid;
   }
 
+  /**
+   * A barrier packet in one queue may wait on pending packets of another, so
+   * all queues are submitted before waiting for a slot in a full one
+   */
+  DispatchQueueSerial& makeRoom(size_t qid) noexcept {
+    if (mQueues[qid].full()) {
+      flush();
+    }
+    return mQueues[qid];
+  }
+
   void addTaskImpl(size_t qid, const GpuKernInstance& ki, const Signal& compSig, const FenceScope& scope) noexcept {
 
     PacketHeader header(PacketKind::KERNEL_DISPATCH, scope, BarrierBit::DISABLE);
-    Base::addTaskToQ(mQueues[qid], ki, header, compSig);
+    Base::addTaskToQ(makeRoom(qid), ki, header, compSig);
+  }
+
+  void recycleSignals() noexcept {
+    auto& pool = execResource().signalPool();
+
+    auto isDone = [] (const InFlightBatch& b) {
+      // acquire, the packet processor is done with the other signals too
+      return hsa_signal_load_scacquire(b.mFinalSig) == 0;
+    };
+
+    for (const auto& b: mInFlight) {
+      if (isDone(b)) {
+        for (const auto& sig: b.mSignals) {
+          // the pool hands out signals set to 1
+          hsa_signal_store_relaxed(sig, 1);
+          pool.returnUserSignal(sig);
+        }
+      }
+    }
+
+    mInFlight.erase(std::remove_if(mInFlight.begin(), mInFlight.end(), isDone), mInFlight.end());
   }
 
 public:
@@ -247,23 +323,51 @@ public:
   }
 
   ~SerialUnorderedExecutor() noexcept {
+    flush();
     for (auto& q: mQueues) {
       execResource().queuePool().returnSerialQueue(q.hsaQueue());
     }
   }
 
+  //! see SubmitPolicy, applied to each queue. Pending packets are submitted first
+  void setSubmitPolicy(const SubmitPolicy& policy) noexcept {
+    for (auto& q: mQueues) {
+      q.setSubmitPolicy(policy);
+    }
+  }
+
+  SubmitStats submitStats() const noexcept {
+    SubmitStats s;
+    for (const auto& q: mQueues) {
+      s += q.submitStats();
+    }
+    return s;
+  }
+
+  //! ring the doorbells for packets held back by the submit policy
+  void flush() noexcept {
+    for (auto& q: mQueues) {
+      q.submitPackets();
+    }
+  }
+
+  void waitOnTask(const TaskHandle& th) noexcept {
+    flush();
+    Base::waitOnTask(th);
+  }
+
   TaskHandle launchTask(const GpuKernInstance& ki) noexcept {
     auto qid = nextQid();
     Signal compSig = execResource().signalPool().takeUserSignal();
     addTaskImpl(qid, ki, compSig, FenceScope::SYSTEM);
-    mQueues[qid].submitPackets();
+    mQueues[qid].submitIfDue();
     return TaskHandle {compSig};
   }
 
   void launchAndForget(const GpuKernInstance& ki) noexcept {
     auto qid = nextQid();
     addTaskImpl(qid, ki, impl::NULL_SIGNAL, FenceScope::SYSTEM);
-    mQueues[qid].submitPackets();
+    mQueues[qid].submitIfDue();
   }
 
   struct BatchState {
@@ -288,13 +392,15 @@ public:
       }
     }
 
-    // TODO(amber): add a destructor that returns signals to pool
+    // TODO(amber): add a destructor that returns signals to pool, for
+    // batches never launched. Launched ones are recycled by the executor
     // TODO(amber): make class moveable only (in order to achieve the above
     // correctly)
 
   };
 
   BatchState startBatch() {
+    recycleSignals();
     return BatchState(*this);
   }
 
@@ -323,20 +429,37 @@ public:
     addTaskImpl(qid, ki, batchState.mPerQcompSig[qid], FenceScope::AGENT);
   }
 
+  /**
+   * Join the per queue signals into the final one, with a tree of barrier
+   * packets when there are more queues than a barrier packet has
+   * dependencies (see PacketFactory::makeBarrierTree). The tree is spread
+   * round robin over the queues
+   */
   TaskHandle launchBatch(BatchState& batchState) noexcept {
-    size_t numBarrierPkts = PacketFactory::barrierTreeSize(mNumQueues);
-    assert(numBarrierPkts == 1);
+    InFlightBatch inFlight {batchState.mFinalSig, std::move(batchState.mPerQcompSig)};
+
+    const size_t numTreeSigs = PacketFactory::barrierTreeNumSignals(mNumQueues);
+    for (size_t i = 0; i < numTreeSigs; ++i) {
+      inFlight.mSignals.emplace_back(execResource().signalPool().takeUserSignal());
+    }
+
+    size_t qid = 0ul;
+    auto nextPkt = [this, &qid] () {
+      AqlPacket* pkt = makeRoom(qid).giveOneSlot();
+      qid = (qid + 1) % mNumQueues;
+      return reinterpret_cast<BarrierAndPkt*>(pkt);
+    };
 
-    // std::printf("Adding the last barrier pkt\n");
-   
-    AqlPacket* pkt = mQueues[0].giveOneSlot();
     PacketHeader header(PacketKind::BARRIER_AND, FenceScope::SYSTEM, BarrierBit::ENABLE);
-    PacketFactory::init(reinterpret_cast<BarrierAndPkt*>(pkt), header, batchState.mFinalSig, batchState.mPerQcompSig, mNumQueues);
+    PacketHeader innerHeader(PacketKind::BARRIER_AND, FenceScope::AGENT, BarrierBit::ENABLE);
+    PacketFactory::makeBarrierTree(nextPkt, inFlight.mSignals.data() + mNumQueues, header, innerHeader,
+        batchState.mFinalSig, inFlight.mSignals, mNumQueues);
     
     for (auto& q: mQueues) {
       q.submitPackets();
     }
 
+    mInFlight.emplace_back(std::move(inFlight));
     return TaskHandle {batchState.mFinalSig};
   }
 
@@ -345,9 +468,193 @@ public:
     return launchBatch(batchState);
   }
 
+  size_t numQueues() const noexcept {
+    return mNumQueues;
+  }
+
+  /**
+   * For callers placing tasks on queues themselves, e.g.,
+   * StaticDAGExecutorDataflow: add ki to queue qid with the barrier bit set,
+   * so that it starts after every packet before it in that queue. Packets are
+   * submitted by flush, or by the next wait
+   */
+  void addInOrder(size_t qid, const GpuKernInstance& ki, const Signal& compSig) noexcept {
+    PacketHeader header(PacketKind::KERNEL_DISPATCH, FenceScope::AGENT, BarrierBit::ENABLE);
+    Base::addTaskToQ(makeRoom(qid), ki, header, compSig);
+  }
+
+  /**
+   * Add to queue qid a join of numPreds signals into compSig, i.e., barrier
+   * packets holding back the packets after them in that queue until preds are
+   * done. treeSigs holds PacketFactory::barrierTreeNumSignals(numPreds)
+   * signals for the inner nodes of the tree, if numPreds is more than one
+   * barrier packet takes
+   */
+  template <typename A>
+  void addJoin(size_t qid, const Signal& compSig, const A& preds, size_t numPreds, Signal* treeSigs
+      , const FenceScope& scope = FenceScope::AGENT) noexcept {
+
+    auto nextPkt = [this, qid] () {
+      return reinterpret_cast<BarrierAndPkt*>(makeRoom(qid).giveOneSlot());
+    };
+
+    PacketHeader header(PacketKind::BARRIER_AND, scope, BarrierBit::ENABLE);
+    PacketHeader innerHeader(PacketKind::BARRIER_AND, FenceScope::AGENT, BarrierBit::ENABLE);
+    PacketFactory::makeBarrierTree(nextPkt, treeSigs, header, innerHeader, compSig, preds, numPreds);
+  }
+
+  /**
+   * A chain is a sequence of tasks that must run in order, added to a batch as
+   * one macro-task: all of its packets go to one queue, and every packet but
+   * the first has the barrier bit set, so it starts only after the packets
+   * before it are done. Only the last packet signals the batch. Chains sharing
+   * a queue are serialized as well, which the round robin over queues keeps
+   * in check.
+   */
+  struct ChainState {
+    size_t mQid;
+    bool mFirst;
+  };
+
+  ChainState startChain(BatchState&) noexcept {
+    return ChainState {nextQid(), true};
+  }
+
+  void addToChain(BatchState&, ChainState& chainState, const GpuKernInstance& ki) noexcept {
+    addChainTaskImpl(chainState, ki, impl::NULL_SIGNAL);
+  }
+
+  void finishChain(BatchState& batchState, ChainState& chainState, const GpuKernInstance& ki) noexcept {
+    hsa_signal_add_relaxed(batchState.mPerQcompSig[chainState.mQid], 1);
+    addChainTaskImpl(chainState, ki, batchState.mPerQcompSig[chainState.mQid]);
+  }
+
+private:
+
+  void addChainTaskImpl(ChainState& chainState, const GpuKernInstance& ki, const Signal& compSig) noexcept {
+    PacketHeader header(PacketKind::KERNEL_DISPATCH, FenceScope::AGENT,
+        chainState.mFirst ? BarrierBit::DISABLE : BarrierBit::ENABLE);
+    Base::addTaskToQ(makeRoom(chainState.mQid), ki, header, compSig);
+    chainState.mFirst = false;
+  }
+
 };
 constexpr size_t SerialUnorderedExecutor::MAX_ACTIVE_QUEUES;
 
+
+/**
+ * Executor that many host threads can share, e.g., one per request thread of
+ * a server, instead of a serial queue per thread or a lock around a shared
+ * one. Submits to multi-producer queues (see DispatchQueueConcurrent), picked
+ * round robin, without locking. Tasks are unordered: dispatch packets don't
+ * set the barrier bit. Kernel argument buffers and signals come from pools
+ * that are not thread-safe, so taking them, in makeTask and when launching,
+ * is serialized by a lock.
+ */
+class ConcurrentExecutor: public SerialGpuExecutorBase {
+
+  using Base = SerialGpuExecutorBase;
+
+  using QueuesVec = std::deque<DispatchQueueConcurrent>;
+
+  constexpr static const size_t MAX_ACTIVE_QUEUES = 64ul;
+
+  QueuesVec mQueues;
+  std::atomic<size_t> mNextQid;
+  std::mutex mRsrcMutex;
+
+  DispatchQueueConcurrent& nextQueue() noexcept {
+    return mQueues[mNextQid.fetch_add(1, std::memory_order_relaxed) % mQueues.size()];
+  }
+
+  Signal takeSignal() noexcept {
+    std::lock_guard<std::mutex> lk(mRsrcMutex);
+    return execResource().signalPool().takeUserSignal();
+  }
+
+  void submit(const GpuKernInstance& ki, const Signal& compSig, const FenceScope& scope) noexcept {
+    auto& q = nextQueue();
+    uint64_t index = q.reserve();
+
+    PacketFactory::initBody(reinterpret_cast<KernelDispatchPkt*>(q.slot(index)), ki, compSig);
+    q.publish(index, PacketHeader(PacketKind::KERNEL_DISPATCH, scope, BarrierBit::DISABLE));
+  }
+
+public:
+
+  ConcurrentExecutor(GpuExecutionResource* e, size_t numQs = 1ul) noexcept:
+    Base(e),
+    mQueues(),
+    mNextQid(0ul),
+    mRsrcMutex()
+  {
+    numQs = std::min(std::max(1ul, numQs), MAX_ACTIVE_QUEUES);
+
+    for (size_t i = 0; i < numQs; ++i) {
+      mQueues.emplace_back(execResource().queuePool().takeConcurrentQueue());
+    }
+  }
+
+  ~ConcurrentExecutor() noexcept {
+    for (auto& q: mQueues) {
+      execResource().queuePool().returnConcurrentQueue(q.hsaQueue());
+    }
+  }
+
+  template <typename... Args>
+  GpuKernInstance makeTask(const dim3& blks, const dim3& thrdsPerBlk, const GpuKernInfo* kinfo, Args&&... args) noexcept  {
+    std::lock_guard<std::mutex> lk(mRsrcMutex);
+    return Base::makeTask(blks, thrdsPerBlk, kinfo, std::forward<Args>(args)...);
+  }
+
+  TaskHandle launchTask(const GpuKernInstance& ki) noexcept {
+    Signal compSig = takeSignal();
+    submit(ki, compSig, FenceScope::SYSTEM);
+    return TaskHandle {compSig};
+  }
+
+  void launchAndForget(const GpuKernInstance& ki) noexcept {
+    submit(ki, impl::NULL_SIGNAL, FenceScope::SYSTEM);
+  }
+
+  //! return the signal of a task waited on already. th can't be used afterwards
+  void releaseTask(const TaskHandle& th) noexcept {
+    hsa_signal_store_relaxed(th.mSignal, 1);
+    std::lock_guard<std::mutex> lk(mRsrcMutex);
+    execResource().signalPool().returnUserSignal(th.mSignal);
+  }
+
+  /**
+   * A batch belongs to the thread that started it. Its tasks share one
+   * completion signal, counting the tasks not done yet
+   */
+  struct BatchState {
+    Signal mSig;
+  };
+
+  BatchState startBatch() noexcept {
+    BatchState b {takeSignal()};
+    hsa_signal_store_relaxed(b.mSig, 0);
+    return b;
+  }
+
+  void addToBatch(BatchState& batchState, const GpuKernInstance& ki) noexcept {
+    hsa_signal_add_relaxed(batchState.mSig, 1);
+    submit(ki, batchState.mSig, FenceScope::SYSTEM);
+  }
+
+  //! tasks are submitted as they are added, this only returns the handle to wait on
+  TaskHandle launchBatch(BatchState& batchState) noexcept {
+    return TaskHandle {batchState.mSig};
+  }
+
+  TaskHandle finishBatch(BatchState& batchState, const GpuKernInstance& ki) noexcept {
+    addToBatch(batchState, ki);
+    return launchBatch(batchState);
+  }
+};
+constexpr size_t ConcurrentExecutor::MAX_ACTIVE_QUEUES;
+
 }// end namespace dagr
 
 
@@ -6,8 +6,12 @@
 #include "cpputils/Heap.h"
 #include "cpputils/Allocator.h"
 
+#ifdef DAGR_EMULATE_HSA
+#include "dagr/hsaEmu.h"
+#else
 #include <hsa/hsa.h>
 #include <hsa/hsa_ext_amd.h>
+#endif
 
 #include <cassert>
 #include <cstddef>
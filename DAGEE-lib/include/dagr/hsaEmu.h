@@ -0,0 +1,907 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#ifndef DAGEE_INCLUDE_DAGR__HSA_EMU_H_
+#define DAGEE_INCLUDE_DAGR__HSA_EMU_H_
+
+/**
+ * Host-side emulation of the subset of HSA used by dagr, selected by defining
+ * DAGR_EMULATE_HSA (see hsaCore.h). Provides the same types, constants and
+ * functions as hsa/hsa.h and hsa/hsa_ext_amd.h, so the rest of dagr compiles
+ * unchanged, and runs on any Linux box without a GPU or ROCm:
+ *
+ * - one GPU agent and one CPU agent, with kernarg, coarse and fine grained
+ *   regions backed by host memory
+ * - signals with load, store, add, subtract and wait
+ * - AQL queues: a ring buffer of packets with read and write indices and a
+ *   doorbell signal. Each queue has a packet processor thread that consumes
+ *   the packets up to the doorbell value in order, honoring the barrier bit,
+ *   barrier-AND and barrier-OR packets, and decrementing completion signals
+ * - kernels are host functions, registered with dagr::emu::registerHostKernel.
+ *   A kernel dispatch calls its function once, see dagr::emu::currentDispatch
+ *
+ * Packets of one queue run one at a time, which is a valid AQL implementation
+ * as the barrier bit only permits overlap. Queues run concurrently.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+#ifndef DAGR_EMU_QUEUE_SIZE
+//! number of packets in an emulated queue, a power of 2
+#define DAGR_EMU_QUEUE_SIZE 4096u
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// types and constants, same names and values as hsa.h and hsa_ext_amd.h
+//////////////////////////////////////////////////////////////////////////////
+
+typedef enum {
+  HSA_STATUS_SUCCESS = 0x0,
+  HSA_STATUS_INFO_BREAK = 0x1,
+  HSA_STATUS_ERROR = 0x1000,
+  HSA_STATUS_ERROR_INVALID_ARGUMENT = 0x1001
+} hsa_status_t;
+
+typedef struct hsa_agent_s { uint64_t handle; } hsa_agent_t;
+typedef struct hsa_signal_s { uint64_t handle; } hsa_signal_t;
+typedef struct hsa_region_s { uint64_t handle; } hsa_region_t;
+typedef struct hsa_code_object_reader_s { uint64_t handle; } hsa_code_object_reader_t;
+typedef struct hsa_executable_s { uint64_t handle; } hsa_executable_t;
+typedef struct hsa_executable_symbol_s { uint64_t handle; } hsa_executable_symbol_t;
+
+typedef int64_t hsa_signal_value_t;
+
+typedef enum {
+  HSA_DEVICE_TYPE_CPU = 0,
+  HSA_DEVICE_TYPE_GPU = 1,
+  HSA_DEVICE_TYPE_DSP = 2
+} hsa_device_type_t;
+
+typedef enum {
+  HSA_AGENT_INFO_NAME = 0,
+  HSA_AGENT_INFO_WAVEFRONT_SIZE = 6,
+  HSA_AGENT_INFO_QUEUES_MAX = 12,
+  HSA_AGENT_INFO_QUEUE_MIN_SIZE = 13,
+  HSA_AGENT_INFO_QUEUE_MAX_SIZE = 14,
+  HSA_AGENT_INFO_DEVICE = 17
+} hsa_agent_info_t;
+
+typedef enum {
+  HSA_PACKET_TYPE_VENDOR_SPECIFIC = 0,
+  HSA_PACKET_TYPE_INVALID = 1,
+  HSA_PACKET_TYPE_KERNEL_DISPATCH = 2,
+  HSA_PACKET_TYPE_BARRIER_AND = 3,
+  HSA_PACKET_TYPE_AGENT_DISPATCH = 4,
+  HSA_PACKET_TYPE_BARRIER_OR = 5
+} hsa_packet_type_t;
+
+typedef enum {
+  HSA_FENCE_SCOPE_NONE = 0,
+  HSA_FENCE_SCOPE_AGENT = 1,
+  HSA_FENCE_SCOPE_SYSTEM = 2
+} hsa_fence_scope_t;
+
+typedef enum {
+  HSA_PACKET_HEADER_TYPE = 0,
+  HSA_PACKET_HEADER_BARRIER = 8,
+  HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE = 9,
+  HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE = 11
+} hsa_packet_header_t;
+
+typedef enum {
+  HSA_PACKET_HEADER_WIDTH_TYPE = 8,
+  HSA_PACKET_HEADER_WIDTH_BARRIER = 1
+} hsa_packet_header_width_t;
+
+typedef enum {
+  HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS = 0
+} hsa_kernel_dispatch_packet_setup_t;
+
+typedef struct hsa_kernel_dispatch_packet_s {
+  uint16_t header;
+  uint16_t setup;
+  uint16_t workgroup_size_x;
+  uint16_t workgroup_size_y;
+  uint16_t workgroup_size_z;
+  uint16_t reserved0;
+  uint32_t grid_size_x;
+  uint32_t grid_size_y;
+  uint32_t grid_size_z;
+  uint32_t private_segment_size;
+  uint32_t group_segment_size;
+  uint64_t kernel_object;
+  void* kernarg_address;
+  uint64_t reserved2;
+  hsa_signal_t completion_signal;
+} hsa_kernel_dispatch_packet_t;
+
+typedef struct hsa_barrier_and_packet_s {
+  uint16_t header;
+  uint16_t reserved0;
+  uint32_t reserved1;
+  hsa_signal_t dep_signal[5];
+  uint64_t reserved2;
+  hsa_signal_t completion_signal;
+} hsa_barrier_and_packet_t;
+
+typedef struct hsa_barrier_or_packet_s {
+  uint16_t header;
+  uint16_t reserved0;
+  uint32_t reserved1;
+  hsa_signal_t dep_signal[5];
+  uint64_t reserved2;
+  hsa_signal_t completion_signal;
+} hsa_barrier_or_packet_t;
+
+static_assert(sizeof(hsa_kernel_dispatch_packet_t) == 64, "AQL packets are 64 bytes");
+static_assert(sizeof(hsa_barrier_and_packet_t) == 64, "AQL packets are 64 bytes");
+
+typedef enum {
+  HSA_QUEUE_TYPE_MULTI = 0,
+  HSA_QUEUE_TYPE_SINGLE = 1,
+  HSA_QUEUE_TYPE_COOPERATIVE = 2
+} hsa_queue_type_t;
+
+typedef uint32_t hsa_queue_type32_t;
+
+typedef struct hsa_queue_s {
+  hsa_queue_type32_t type;
+  uint32_t features;
+  void* base_address;
+  hsa_signal_t doorbell_signal;
+  uint32_t size;
+  uint32_t reserved1;
+  uint64_t id;
+} hsa_queue_t;
+
+typedef enum {
+  HSA_SIGNAL_CONDITION_EQ = 0,
+  HSA_SIGNAL_CONDITION_NE = 1,
+  HSA_SIGNAL_CONDITION_LT = 2,
+  HSA_SIGNAL_CONDITION_GTE = 3
+} hsa_signal_condition_t;
+
+typedef enum { HSA_WAIT_STATE_BLOCKED = 0, HSA_WAIT_STATE_ACTIVE = 1 } hsa_wait_state_t;
+
+typedef enum {
+  HSA_REGION_SEGMENT_GLOBAL = 0,
+  HSA_REGION_SEGMENT_READONLY = 1,
+  HSA_REGION_SEGMENT_PRIVATE = 2,
+  HSA_REGION_SEGMENT_GROUP = 3,
+  HSA_REGION_SEGMENT_KERNARG = 4
+} hsa_region_segment_t;
+
+typedef enum {
+  HSA_REGION_GLOBAL_FLAG_KERNARG = 1,
+  HSA_REGION_GLOBAL_FLAG_FINE_GRAINED = 2,
+  HSA_REGION_GLOBAL_FLAG_COARSE_GRAINED = 4
+} hsa_region_global_flag_t;
+
+typedef enum {
+  HSA_REGION_INFO_SEGMENT = 0,
+  HSA_REGION_INFO_GLOBAL_FLAGS = 1,
+  HSA_REGION_INFO_SIZE = 2,
+  HSA_REGION_INFO_ALLOC_MAX_SIZE = 4,
+  HSA_REGION_INFO_RUNTIME_ALLOC_ALLOWED = 5,
+  HSA_REGION_INFO_RUNTIME_ALLOC_GRANULE = 6,
+  HSA_REGION_INFO_RUNTIME_ALLOC_ALIGNMENT = 7
+} hsa_region_info_t;
+
+typedef enum { HSA_PROFILE_BASE = 0, HSA_PROFILE_FULL = 1 } hsa_profile_t;
+
+typedef enum {
+  HSA_DEFAULT_FLOAT_ROUNDING_MODE_DEFAULT = 0,
+  HSA_DEFAULT_FLOAT_ROUNDING_MODE_ZERO = 1,
+  HSA_DEFAULT_FLOAT_ROUNDING_MODE_NEAR = 2
+} hsa_default_float_rounding_mode_t;
+
+typedef enum { HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_OBJECT = 22 } hsa_executable_symbol_info_t;
+
+typedef enum {
+  HSA_AMD_SIGNAL_AMD_GPU_ONLY = 1,
+  HSA_AMD_SIGNAL_IPC = 2
+} hsa_amd_signal_attribute_t;
+
+//! same as dim3 of HIP, which kernel.h can't include without ROCm
+struct dim3 {
+  uint32_t x;
+  uint32_t y;
+  uint32_t z;
+
+  dim3(uint32_t _x = 1, uint32_t _y = 1, uint32_t _z = 1) noexcept : x(_x), y(_y), z(_z) {}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// emulated runtime
+//////////////////////////////////////////////////////////////////////////////
+
+namespace dagr {
+namespace emu {
+
+using HostFuncPtr = void (*)(void);
+
+//! a host function standing for a GPU kernel. Its address is the kernel object
+struct HostKernel {
+  using Invoker = void (*)(HostFuncPtr, const void*);
+
+  //! calls mFunc with the args unpacked from a kernarg buffer
+  Invoker mInvoke;
+  HostFuncPtr mFunc;
+};
+
+namespace impl {
+
+enum class AgentId : uint64_t { GPU = 1, CPU = 2 };
+
+enum class RegionKind : uint64_t { KERNARG = 1, COARSE = 2, FINE = 3 };
+
+constexpr static const size_t REGION_SIZE = size_t(1) << 34;
+constexpr static const size_t ALLOC_GRANULE = 4096ul;
+constexpr static const uint32_t QUEUE_SIZE = DAGR_EMU_QUEUE_SIZE;
+constexpr static const uint32_t MAX_NUM_QUEUES = 128u;
+
+static_assert((QUEUE_SIZE & (QUEUE_SIZE - 1)) == 0, "queue size must be a power of 2");
+
+inline hsa_region_t makeRegion(AgentId a, RegionKind k) noexcept {
+  return hsa_region_t{(uint64_t(a) << 8) | uint64_t(k)};
+}
+
+inline RegionKind regionKind(const hsa_region_t& r) noexcept {
+  return static_cast<RegionKind>(r.handle & 0xffu);
+}
+
+/**
+ * Blocked waiters are counted, so that updates only take the mutex when some
+ * thread sleeps on the signal. A waiter counts itself before checking the
+ * value and an update fences before checking the count, so either the update
+ * sees the waiter or the waiter sees the update.
+ */
+struct Signal {
+  std::atomic<hsa_signal_value_t> mValue;
+  std::atomic<unsigned> mNumWaiters;
+  //! updates still in notify, which may follow a waiter seeing the value and
+  //! destroying the signal, see hsa_signal_destroy
+  std::atomic<unsigned> mNumUpdaters;
+  std::mutex mMutex;
+  std::condition_variable mCond;
+
+  explicit Signal(hsa_signal_value_t init) noexcept
+      : mValue(init), mNumWaiters(0), mNumUpdaters(0) {}
+
+  void notify(void) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mNumWaiters.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lk(mMutex);
+      mCond.notify_all();
+    }
+  }
+
+  void store(hsa_signal_value_t v, std::memory_order mo) {
+    mNumUpdaters.fetch_add(1);
+    mValue.store(v, mo);
+    notify();
+    mNumUpdaters.fetch_sub(1, std::memory_order_release);
+  }
+
+  void add(hsa_signal_value_t v, std::memory_order mo) {
+    mNumUpdaters.fetch_add(1);
+    mValue.fetch_add(v, mo);
+    notify();
+    mNumUpdaters.fetch_sub(1, std::memory_order_release);
+  }
+
+  void waitForUpdaters(void) const {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (mNumUpdaters.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  //! block until pred(value) holds. @return the value
+  template <typename P>
+  hsa_signal_value_t waitBlocked(const P& pred, std::memory_order mo) {
+    hsa_signal_value_t v = mValue.load(mo);
+    if (pred(v)) {
+      return v;
+    }
+
+    mNumWaiters.fetch_add(1);
+    {
+      std::unique_lock<std::mutex> lk(mMutex);
+      mCond.wait(lk, [&] { return pred(v = mValue.load(mo)); });
+    }
+    mNumWaiters.fetch_sub(1);
+    return v;
+  }
+
+  template <typename P>
+  hsa_signal_value_t waitActive(const P& pred, std::memory_order mo) const {
+    hsa_signal_value_t v = mValue.load(mo);
+    while (!pred(v)) {
+      std::this_thread::yield();
+      v = mValue.load(mo);
+    }
+    return v;
+  }
+};
+
+inline Signal* toSignal(const hsa_signal_t& s) noexcept {
+  assert(s.handle != 0 && "null signal");
+  return reinterpret_cast<Signal*>(s.handle);
+}
+
+inline bool satisfies(hsa_signal_condition_t cond, hsa_signal_value_t v, hsa_signal_value_t cmp) {
+  switch (cond) {
+    case HSA_SIGNAL_CONDITION_EQ:
+      return v == cmp;
+    case HSA_SIGNAL_CONDITION_NE:
+      return v != cmp;
+    case HSA_SIGNAL_CONDITION_LT:
+      return v < cmp;
+    case HSA_SIGNAL_CONDITION_GTE:
+      return v >= cmp;
+  }
+  std::abort();
+}
+
+inline void signalDone(const hsa_signal_t& s) {
+  if (s.handle != 0) {
+    toSignal(s)->add(-1, std::memory_order_release);
+  }
+}
+
+inline const hsa_kernel_dispatch_packet_t*& currentDispatchRef(void) noexcept {
+  static thread_local const hsa_kernel_dispatch_packet_t* curr = nullptr;
+  return curr;
+}
+
+/**
+ * An AQL queue. mHsaQueue comes first, so that the hsa_queue_t* handed out
+ * converts back. The doorbell holds the id of the last packet submitted, -1
+ * initially.
+ */
+struct Queue {
+  hsa_queue_t mHsaQueue;
+  std::unique_ptr<hsa_kernel_dispatch_packet_t[]> mPackets;
+  std::atomic<uint64_t> mReadIndex;
+  std::atomic<uint64_t> mWriteIndex;
+  Signal mDoorbell;
+  std::atomic<bool> mStop;
+  std::thread mProcessor;
+
+  Queue(uint32_t size, hsa_queue_type32_t type)
+      : mHsaQueue(),
+        mPackets(new hsa_kernel_dispatch_packet_t[size]),
+        mReadIndex(0),
+        mWriteIndex(0),
+        mDoorbell(-1),
+        mStop(false),
+        mProcessor() {
+    std::memset(mPackets.get(), 0, size * sizeof(hsa_kernel_dispatch_packet_t));
+    for (uint32_t i = 0; i < size; ++i) {
+      mPackets[i].header = HSA_PACKET_TYPE_INVALID << HSA_PACKET_HEADER_TYPE;
+    }
+
+    mHsaQueue.type = type;
+    mHsaQueue.base_address = mPackets.get();
+    mHsaQueue.doorbell_signal = hsa_signal_t{reinterpret_cast<uint64_t>(&mDoorbell)};
+    mHsaQueue.size = size;
+    mHsaQueue.id = reinterpret_cast<uint64_t>(this);
+
+    mProcessor = std::thread([this] { processLoop(); });
+  }
+
+  ~Queue(void) {
+    mStop.store(true);
+    mDoorbell.notify();
+    mProcessor.join();
+  }
+
+  static void waitAll(const hsa_signal_t* deps, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      if (deps[i].handle != 0) {
+        toSignal(deps[i])->waitBlocked([](hsa_signal_value_t v) { return v == 0; },
+                                       std::memory_order_acquire);
+      }
+    }
+  }
+
+  static void waitAny(const hsa_signal_t* deps, size_t n) {
+    bool any = false;
+    for (size_t i = 0; i < n; ++i) {
+      any = any || deps[i].handle != 0;
+    }
+    if (!any) {
+      return;
+    }
+
+    while (true) {
+      for (size_t i = 0; i < n; ++i) {
+        if (deps[i].handle != 0 && toSignal(deps[i])->mValue.load(std::memory_order_acquire) == 0) {
+          return;
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  void process(const hsa_kernel_dispatch_packet_t& pkt) {
+    switch (pkt.header & ((1u << HSA_PACKET_HEADER_WIDTH_TYPE) - 1u)) {
+      case HSA_PACKET_TYPE_KERNEL_DISPATCH: {
+        assert(pkt.kernel_object != 0 && "invalid kernel object");
+        const auto* k = reinterpret_cast<const HostKernel*>(pkt.kernel_object);
+
+        currentDispatchRef() = &pkt;
+        k->mInvoke(k->mFunc, pkt.kernarg_address);
+        currentDispatchRef() = nullptr;
+
+        signalDone(pkt.completion_signal);
+        break;
+      }
+      case HSA_PACKET_TYPE_BARRIER_AND: {
+        const auto& b = reinterpret_cast<const hsa_barrier_and_packet_t&>(pkt);
+        waitAll(b.dep_signal, 5);
+        signalDone(b.completion_signal);
+        break;
+      }
+      case HSA_PACKET_TYPE_BARRIER_OR: {
+        const auto& b = reinterpret_cast<const hsa_barrier_or_packet_t&>(pkt);
+        waitAny(b.dep_signal, 5);
+        signalDone(b.completion_signal);
+        break;
+      }
+      default:
+        assert(false && "unsupported packet type");
+        std::abort();
+    }
+  }
+
+  void processLoop(void) {
+    const uint64_t mask = mHsaQueue.size - 1u;
+
+    while (true) {
+      const uint64_t r = mReadIndex.load(std::memory_order_relaxed);
+
+      mDoorbell.waitBlocked(
+          [&](hsa_signal_value_t db) { return db >= int64_t(r) || mStop.load(); },
+          std::memory_order_acquire);
+
+      if (mDoorbell.mValue.load(std::memory_order_acquire) < int64_t(r)) {
+        return; // stopping, and nothing left to run
+      }
+
+      // copy the packet out and free its slot, as a packet processor does once
+      // it has launched a packet
+      auto& slot = mPackets[r & mask];
+      hsa_kernel_dispatch_packet_t pkt = slot;
+      assert((pkt.header & 0xffu) != HSA_PACKET_TYPE_INVALID && "doorbell rung on invalid packet");
+      slot.header = HSA_PACKET_TYPE_INVALID << HSA_PACKET_HEADER_TYPE;
+      mReadIndex.store(r + 1, std::memory_order_release);
+
+      // packets run one at a time, which meets the barrier bit trivially
+      process(pkt);
+    }
+  }
+};
+
+inline Queue* toQueue(const hsa_queue_t* q) noexcept {
+  assert(q && "null queue");
+  return reinterpret_cast<Queue*>(const_cast<hsa_queue_t*>(q));
+}
+
+//! host kernels by name, i.e., the symbols of every emulated executable
+struct KernelTable {
+  std::mutex mMutex;
+  std::unordered_map<std::string, std::unique_ptr<HostKernel> > mByName;
+
+  static KernelTable& get(void) {
+    static KernelTable t;
+    return t;
+  }
+
+  const HostKernel* find(const char* name) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    auto it = mByName.find(name);
+    return it == mByName.end() ? nullptr : it->second.get();
+  }
+
+  void insert(const std::string& name, const HostKernel& k) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    auto& p = mByName[name];
+    if (!p) {
+      p.reset(new HostKernel(k));
+    }
+  }
+};
+
+template <typename T>
+T readKernArg(const char* buf, size_t& offset) noexcept {
+  // same layout as dagr::impl::packKernArgs
+  offset = (offset + alignof(T) - 1) & ~(alignof(T) - 1);
+  T ret;
+  std::memcpy(&ret, buf + offset, sizeof(T));
+  offset += sizeof(T);
+  return ret;
+}
+
+template <typename... Args>
+struct HostKernelCall {
+  // a braced init list evaluates args left to right, in kernarg order
+  HostKernelCall(void (*func)(Args...), typename std::decay<Args>::type... args) {
+    func(args...);
+  }
+};
+
+template <typename... Args>
+void invokeHostKernel(HostFuncPtr func, const void* kernArgs) {
+  const char* buf = static_cast<const char*>(kernArgs);
+  size_t offset = 0ul;
+  (void)buf;
+  (void)offset;
+  HostKernelCall<Args...>{reinterpret_cast<void (*)(Args...)>(func),
+                          readKernArg<typename std::decay<Args>::type>(buf, offset)...};
+}
+
+} // end namespace impl
+
+/**
+ * Register func as a kernel with arguments Args..., which must be trivially
+ * copyable. @return its symbol name, for hsa_executable_get_symbol_by_name
+ */
+template <typename... Args>
+std::string registerHostKernel(void (*func)(Args...)) {
+  std::string name = "host-kernel@" + std::to_string(reinterpret_cast<uintptr_t>(func));
+  impl::KernelTable::get().insert(
+      name, HostKernel{&impl::invokeHostKernel<Args...>, reinterpret_cast<HostFuncPtr>(func)});
+  return name;
+}
+
+//! the dispatch packet of the kernel running on the calling thread, null outside kernels
+inline const hsa_kernel_dispatch_packet_t* currentDispatch(void) noexcept {
+  return impl::currentDispatchRef();
+}
+
+} // end namespace emu
+} // end namespace dagr
+
+//////////////////////////////////////////////////////////////////////////////
+// emulated API
+//////////////////////////////////////////////////////////////////////////////
+
+inline hsa_status_t hsa_init(void) { return HSA_STATUS_SUCCESS; }
+
+inline hsa_status_t hsa_shut_down(void) { return HSA_STATUS_SUCCESS; }
+
+inline hsa_status_t hsa_iterate_agents(hsa_status_t (*callback)(hsa_agent_t, void*), void* data) {
+  using dagr::emu::impl::AgentId;
+  for (AgentId a : {AgentId::GPU, AgentId::CPU}) {
+    hsa_status_t s = callback(hsa_agent_t{uint64_t(a)}, data);
+    if (s != HSA_STATUS_SUCCESS) {
+      return s == HSA_STATUS_INFO_BREAK ? HSA_STATUS_SUCCESS : s;
+    }
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_agent_get_info(hsa_agent_t agent, hsa_agent_info_t attr, void* value) {
+  using namespace dagr::emu::impl;
+  const bool isGpu = agent.handle == uint64_t(AgentId::GPU);
+
+  switch (attr) {
+    case HSA_AGENT_INFO_NAME:
+      std::strncpy(static_cast<char*>(value), isGpu ? "emulated-gpu" : "emulated-cpu", 64);
+      break;
+    case HSA_AGENT_INFO_DEVICE:
+      *static_cast<hsa_device_type_t*>(value) = isGpu ? HSA_DEVICE_TYPE_GPU : HSA_DEVICE_TYPE_CPU;
+      break;
+    case HSA_AGENT_INFO_WAVEFRONT_SIZE:
+      *static_cast<uint32_t*>(value) = isGpu ? 64u : 1u;
+      break;
+    case HSA_AGENT_INFO_QUEUES_MAX:
+      *static_cast<uint32_t*>(value) = MAX_NUM_QUEUES;
+      break;
+    case HSA_AGENT_INFO_QUEUE_MIN_SIZE:
+      *static_cast<uint32_t*>(value) = std::min(64u, QUEUE_SIZE);
+      break;
+    case HSA_AGENT_INFO_QUEUE_MAX_SIZE:
+      *static_cast<uint32_t*>(value) = QUEUE_SIZE;
+      break;
+    default:
+      return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_agent_iterate_regions(hsa_agent_t agent,
+                                              hsa_status_t (*callback)(hsa_region_t, void*),
+                                              void* data) {
+  using namespace dagr::emu::impl;
+  const auto a = static_cast<AgentId>(agent.handle);
+  for (RegionKind k : {RegionKind::KERNARG, RegionKind::COARSE, RegionKind::FINE}) {
+    hsa_status_t s = callback(makeRegion(a, k), data);
+    if (s != HSA_STATUS_SUCCESS) {
+      return s == HSA_STATUS_INFO_BREAK ? HSA_STATUS_SUCCESS : s;
+    }
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_region_get_info(hsa_region_t region, hsa_region_info_t attr, void* value) {
+  using namespace dagr::emu::impl;
+
+  switch (attr) {
+    case HSA_REGION_INFO_SEGMENT:
+      *static_cast<hsa_region_segment_t*>(value) = HSA_REGION_SEGMENT_GLOBAL;
+      break;
+    case HSA_REGION_INFO_GLOBAL_FLAGS: {
+      uint32_t flags = 0;
+      switch (regionKind(region)) {
+        case RegionKind::KERNARG:
+          flags = HSA_REGION_GLOBAL_FLAG_KERNARG | HSA_REGION_GLOBAL_FLAG_FINE_GRAINED;
+          break;
+        case RegionKind::COARSE:
+          flags = HSA_REGION_GLOBAL_FLAG_COARSE_GRAINED;
+          break;
+        case RegionKind::FINE:
+          flags = HSA_REGION_GLOBAL_FLAG_FINE_GRAINED;
+          break;
+      }
+      *static_cast<hsa_region_global_flag_t*>(value) = static_cast<hsa_region_global_flag_t>(flags);
+      break;
+    }
+    case HSA_REGION_INFO_SIZE:
+    case HSA_REGION_INFO_ALLOC_MAX_SIZE:
+      *static_cast<size_t*>(value) = REGION_SIZE;
+      break;
+    case HSA_REGION_INFO_RUNTIME_ALLOC_ALLOWED:
+      *static_cast<bool*>(value) = true;
+      break;
+    case HSA_REGION_INFO_RUNTIME_ALLOC_GRANULE:
+    case HSA_REGION_INFO_RUNTIME_ALLOC_ALIGNMENT:
+      *static_cast<size_t*>(value) = ALLOC_GRANULE;
+      break;
+    default:
+      return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_memory_allocate(hsa_region_t region, size_t size, void** ptr) {
+  (void)region;
+  if (!ptr || size == 0) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+  constexpr size_t GRANULE = dagr::emu::impl::ALLOC_GRANULE;
+  if (posix_memalign(ptr, GRANULE, (size + GRANULE - 1) & ~(GRANULE - 1)) != 0) {
+    return HSA_STATUS_ERROR;
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_memory_free(void* ptr) {
+  std::free(ptr);
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_memory_copy(void* dst, const void* src, size_t size) {
+  std::memcpy(dst, src, size);
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_signal_create(hsa_signal_value_t initial, uint32_t numConsumers,
+                                      const hsa_agent_t* consumers, hsa_signal_t* signal) {
+  (void)numConsumers;
+  (void)consumers;
+  if (!signal) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+  signal->handle = reinterpret_cast<uint64_t>(new dagr::emu::impl::Signal(initial));
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_amd_signal_create(hsa_signal_value_t initial, uint32_t numConsumers,
+                                          const hsa_agent_t* consumers, uint64_t attributes,
+                                          hsa_signal_t* signal) {
+  (void)attributes;
+  return hsa_signal_create(initial, numConsumers, consumers, signal);
+}
+
+inline hsa_status_t hsa_signal_destroy(hsa_signal_t signal) {
+  auto* sig = dagr::emu::impl::toSignal(signal);
+  sig->waitForUpdaters();
+  delete sig;
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_signal_value_t hsa_signal_load_relaxed(hsa_signal_t signal) {
+  return dagr::emu::impl::toSignal(signal)->mValue.load(std::memory_order_relaxed);
+}
+
+inline hsa_signal_value_t hsa_signal_load_scacquire(hsa_signal_t signal) {
+  return dagr::emu::impl::toSignal(signal)->mValue.load(std::memory_order_acquire);
+}
+
+inline void hsa_signal_store_relaxed(hsa_signal_t signal, hsa_signal_value_t value) {
+  dagr::emu::impl::toSignal(signal)->store(value, std::memory_order_relaxed);
+}
+
+inline void hsa_signal_store_screlease(hsa_signal_t signal, hsa_signal_value_t value) {
+  dagr::emu::impl::toSignal(signal)->store(value, std::memory_order_release);
+}
+
+inline void hsa_signal_add_relaxed(hsa_signal_t signal, hsa_signal_value_t value) {
+  dagr::emu::impl::toSignal(signal)->add(value, std::memory_order_relaxed);
+}
+
+inline void hsa_signal_add_screlease(hsa_signal_t signal, hsa_signal_value_t value) {
+  dagr::emu::impl::toSignal(signal)->add(value, std::memory_order_release);
+}
+
+inline void hsa_signal_subtract_relaxed(hsa_signal_t signal, hsa_signal_value_t value) {
+  dagr::emu::impl::toSignal(signal)->add(-value, std::memory_order_relaxed);
+}
+
+inline void hsa_signal_subtract_screlease(hsa_signal_t signal, hsa_signal_value_t value) {
+  dagr::emu::impl::toSignal(signal)->add(-value, std::memory_order_release);
+}
+
+namespace dagr {
+namespace emu {
+namespace impl {
+//! timeoutHint is ignored: waits return once the condition holds
+inline hsa_signal_value_t signalWait(hsa_signal_t signal, hsa_signal_condition_t cond,
+                                     hsa_signal_value_t cmp, hsa_wait_state_t waitState,
+                                     std::memory_order mo) {
+  auto pred = [cond, cmp](hsa_signal_value_t v) { return satisfies(cond, v, cmp); };
+  Signal* s = toSignal(signal);
+  return waitState == HSA_WAIT_STATE_BLOCKED ? s->waitBlocked(pred, mo) : s->waitActive(pred, mo);
+}
+} // end namespace impl
+} // end namespace emu
+} // end namespace dagr
+
+inline hsa_signal_value_t hsa_signal_wait_relaxed(hsa_signal_t signal, hsa_signal_condition_t cond,
+                                                  hsa_signal_value_t cmp, uint64_t timeoutHint,
+                                                  hsa_wait_state_t waitState) {
+  (void)timeoutHint;
+  return dagr::emu::impl::signalWait(signal, cond, cmp, waitState, std::memory_order_relaxed);
+}
+
+inline hsa_signal_value_t hsa_signal_wait_scacquire(hsa_signal_t signal,
+                                                    hsa_signal_condition_t cond,
+                                                    hsa_signal_value_t cmp, uint64_t timeoutHint,
+                                                    hsa_wait_state_t waitState) {
+  (void)timeoutHint;
+  return dagr::emu::impl::signalWait(signal, cond, cmp, waitState, std::memory_order_acquire);
+}
+
+inline hsa_status_t hsa_queue_create(hsa_agent_t agent, uint32_t size, hsa_queue_type32_t type,
+                                     void (*callback)(hsa_status_t, hsa_queue_t*, void*),
+                                     void* data, uint32_t privateSegmentSize,
+                                     uint32_t groupSegmentSize, hsa_queue_t** queue) {
+  (void)agent;
+  (void)callback;
+  (void)data;
+  (void)privateSegmentSize;
+  (void)groupSegmentSize;
+  if (!queue || size == 0 || (size & (size - 1)) != 0 || size > dagr::emu::impl::QUEUE_SIZE) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+  *queue = &(new dagr::emu::impl::Queue(size, type))->mHsaQueue;
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_queue_destroy(hsa_queue_t* queue) {
+  delete dagr::emu::impl::toQueue(queue);
+  return HSA_STATUS_SUCCESS;
+}
+
+inline uint64_t hsa_queue_load_read_index_relaxed(const hsa_queue_t* queue) {
+  return dagr::emu::impl::toQueue(queue)->mReadIndex.load(std::memory_order_relaxed);
+}
+
+inline uint64_t hsa_queue_load_read_index_scacquire(const hsa_queue_t* queue) {
+  return dagr::emu::impl::toQueue(queue)->mReadIndex.load(std::memory_order_acquire);
+}
+
+inline uint64_t hsa_queue_load_write_index_relaxed(const hsa_queue_t* queue) {
+  return dagr::emu::impl::toQueue(queue)->mWriteIndex.load(std::memory_order_relaxed);
+}
+
+inline uint64_t hsa_queue_load_write_index_scacquire(const hsa_queue_t* queue) {
+  return dagr::emu::impl::toQueue(queue)->mWriteIndex.load(std::memory_order_acquire);
+}
+
+//! @return the write index before the addition
+inline uint64_t hsa_queue_add_write_index_relaxed(const hsa_queue_t* queue, uint64_t value) {
+  return dagr::emu::impl::toQueue(queue)->mWriteIndex.fetch_add(value, std::memory_order_relaxed);
+}
+
+inline uint64_t hsa_queue_add_write_index_scacquire(const hsa_queue_t* queue, uint64_t value) {
+  return dagr::emu::impl::toQueue(queue)->mWriteIndex.fetch_add(value, std::memory_order_acquire);
+}
+
+// executables hold no code: kernels are host functions, and every executable
+// finds every kernel registered with dagr::emu::registerHostKernel
+
+inline hsa_status_t hsa_executable_create_alt(hsa_profile_t profile,
+                                              hsa_default_float_rounding_mode_t rounding,
+                                              const char* options, hsa_executable_t* exe) {
+  (void)profile;
+  (void)rounding;
+  (void)options;
+  static std::atomic<uint64_t> nextId(1);
+  exe->handle = nextId.fetch_add(1);
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_code_object_reader_create_from_memory(const void* codeObj, size_t size,
+                                                              hsa_code_object_reader_t* reader) {
+  (void)size;
+  reader->handle = reinterpret_cast<uint64_t>(codeObj);
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_code_object_reader_destroy(hsa_code_object_reader_t reader) {
+  (void)reader;
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_executable_load_agent_code_object(hsa_executable_t exe, hsa_agent_t agent,
+                                                          hsa_code_object_reader_t reader,
+                                                          const char* options,
+                                                          void* loadedCodeObject) {
+  (void)exe;
+  (void)agent;
+  (void)reader;
+  (void)options;
+  (void)loadedCodeObject;
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_executable_freeze(hsa_executable_t exe, const char* options) {
+  (void)exe;
+  (void)options;
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_executable_destroy(hsa_executable_t exe) {
+  (void)exe;
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_executable_get_symbol_by_name(hsa_executable_t exe, const char* name,
+                                                      const hsa_agent_t* agent,
+                                                      hsa_executable_symbol_t* sym) {
+  (void)exe;
+  (void)agent;
+  const auto* k = dagr::emu::impl::KernelTable::get().find(name);
+  if (!k) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+  sym->handle = reinterpret_cast<uint64_t>(k);
+  return HSA_STATUS_SUCCESS;
+}
+
+inline hsa_status_t hsa_executable_symbol_get_info(hsa_executable_symbol_t sym,
+                                                   hsa_executable_symbol_info_t attr,
+                                                   void* value) {
+  if (attr != HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_OBJECT) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+  *static_cast<uint64_t*>(value) = sym.handle;
+  return HSA_STATUS_SUCCESS;
+}
+
+#endif// DAGEE_INCLUDE_DAGR__HSA_EMU_H_
@@ -7,7 +7,9 @@
 #include "dagr/binary.h"
 #include "dagr/memory.h"
 
+#ifndef DAGR_EMULATE_HSA
 #include "hip/hip_runtime.h"
+#endif
 
 #include <unordered_map>
 
@@ -18,8 +20,13 @@ namespace impl {
   template <typename U>
   using BareTy = typename std::remove_reference<typename std::remove_cv<U>::type>::type;
 
+  template <size_t CURR_SZ, typename... Args>
+  struct ArgBufSizeImpl {
+    constexpr static const size_t value = CURR_SZ;
+  };
+
   template <size_t CURR_SZ, typename U, typename... Args>
-  class ArgBufSizeImpl {
+  class ArgBufSizeImpl<CURR_SZ, U, Args...> {
     using T = BareTy<U>;
     constexpr static const size_t ROUNDED = (CURR_SZ + alignof(T) - 1) & ~(alignof(T) - 1);
     constexpr static const size_t NEXT_SZ = ROUNDED + sizeof(T);
@@ -28,11 +35,6 @@ namespace impl {
     constexpr static const size_t value = ArgBufSizeImpl<NEXT_SZ, Args...>::value;
   };
 
-  template <size_t CURR_SZ> 
-  struct ArgBufSizeImpl<CURR_SZ, void, void> {
-    constexpr static const size_t value = CURR_SZ;
-  };
-
   template <typename... Args>
   struct ArgBufSize {
     constexpr static const size_t value = ArgBufSizeImpl<0ul, Args...>::value;
@@ -63,7 +65,8 @@ namespace impl {
   template <typename BufT, typename... Args>
   void packKernArgs(BufT& buffer, Args&&... args) noexcept {
     size_t offset = 0ul;
-    void((int [] ) { (0, copyArgUpdateOffset(buffer, offset, args))... });
+    int expandInOrder[] = {0, (copyArgUpdateOffset(buffer, offset, args), 0)...};
+    (void) expandInOrder;
   }
 
 } // end naamespace impl
@@ -183,10 +186,15 @@ struct GpuKernInfoState {
 
     } else {
 
+#ifdef DAGR_EMULATE_HSA
+      // kernels are host functions, see hsaEmu.h
+      auto kname = emu::registerHostKernel<Args...>(funcPtr);
+#else
       const auto& name = mKernelPtrLookup.name(fptr);
       // TODO(amber): FIXME: hip-clang related change where kernels have a .kd
       // suffix added to the name
       auto kname  = name + ".kd";
+#endif
 
       const GpuKernInfo* kinfo = registerKernel<Args...>(kname.c_str());
       mKernInfoByPtr.insert(it, std::make_pair(fptr, kinfo));
@@ -244,7 +252,12 @@ private:
 
 public:
 
-  static void init(KernelDispatchPkt* pkt, const PacketHeader& header, const dim3& numBlks, const dim3& threadsPerBlk, 
+  /**
+   * initBody fills in everything but the header, which is left 0, for queues
+   * that publish headers themselves (see DispatchQueueConcurrent). init
+   * writes the header too
+   */
+  static void initBody(KernelDispatchPkt* pkt, const dim3& numBlks, const dim3& threadsPerBlk,
       size_t sharedMem, const KernelObject& kobj, const MemBlock& kernArgBuf, const Signal& sig) noexcept {
 
     zeroOut(pkt);
@@ -268,19 +281,30 @@ public:
     pkt->kernarg_address = kernArgBuf.begin();
 
     pkt->completion_signal = sig;
+  }
 
+  static void init(KernelDispatchPkt* pkt, const PacketHeader& header, const dim3& numBlks, const dim3& threadsPerBlk, 
+      size_t sharedMem, const KernelObject& kobj, const MemBlock& kernArgBuf, const Signal& sig) noexcept {
+
+    initBody(pkt, numBlks, threadsPerBlk, sharedMem, kobj, kernArgBuf, sig);
     updateHeaderSimple(pkt, header);
   }
 
-  static void init(KernelDispatchPkt* pkt, const PacketHeader& header, const GpuKernInstance& ki, const Signal& compSig) noexcept {
+  static void initBody(KernelDispatchPkt* pkt, const GpuKernInstance& ki, const Signal& compSig) noexcept {
 
-    init(pkt, header, ki.mBlocks, ki.mThreadsPerBlock, 0ul,
+    initBody(pkt, ki.mBlocks, ki.mThreadsPerBlock, 0ul,
         ki.mKernInfoPtr->kernObj(), ki.mKernArgBuf, compSig);
   }
 
+  static void init(KernelDispatchPkt* pkt, const PacketHeader& header, const GpuKernInstance& ki, const Signal& compSig) noexcept {
+
+    initBody(pkt, ki, compSig);
+    updateHeaderSimple(pkt, header);
+  }
+
 
   template <typename A>
-  static void init(BarrierAndPkt* pkt, const PacketHeader& header, const Signal& compSig, const A& preds, const size_t numPreds) noexcept {
+  static void initBody(BarrierAndPkt* pkt, const Signal& compSig, const A& preds, const size_t numPreds) noexcept {
 
     zeroOut(pkt);
     pkt->completion_signal = compSig;
@@ -290,51 +314,78 @@ public:
     if (numPreds > 0) {
       std::copy_n(&preds[0], std::min(numPreds, BARRIER_PKT_NUM_PREDS), &pkt->dep_signal[0]);
     }
+  }
 
+  template <typename A>
+  static void init(BarrierAndPkt* pkt, const PacketHeader& header, const Signal& compSig, const A& preds, const size_t numPreds) noexcept {
+
+    initBody(pkt, compSig, preds, numPreds);
     updateHeaderSimple(pkt, header);
   }
 
 
   /**
-   * Given numPreds predecessors, how many barrier packets would be needed to 
+   * Given numPreds predecessors, how many barrier packets are needed to
    * reduce these to a single barrier packet if we use tree reduction where each
-   * node is a barrier packet monitoring BARRIER_PKT_NUM_PREDS predecessors
+   * node is a barrier packet monitoring BARRIER_PKT_NUM_PREDS predecessors.
+   * There are ceil(log5(numPreds)) levels, and at least one packet
    */
   static size_t barrierTreeSize(const size_t numPreds) noexcept {
     size_t ret = 0ul;
+    size_t val = numPreds > 0ul ? numPreds : 1ul;
 
-    for (size_t val = numPreds; val > 0; val /= BARRIER_PKT_NUM_PREDS) {
+    do {
       // divide by BARRIER_PKT_NUM_PREDS rounding up
-      ret += (val + BARRIER_PKT_NUM_PREDS - 1) / BARRIER_PKT_NUM_PREDS;
-    }
+      val = (val + BARRIER_PKT_NUM_PREDS - 1) / BARRIER_PKT_NUM_PREDS;
+      ret += val;
+    } while (val > 1ul);
 
     return ret;
   }
 
-  //! assumes that pktArray has space for P = barrierTreeSize(numPreds) packets,
-  //! and similarly sigArray has P free signals to use. 
-  template <typename A>
-  static void makeBarrierTree(BarrierAndPkt* pktArray, Signal* sigArray, const PacketHeader& header, const A& preds, const size_t numPreds) noexcept {
+  //! signals, other than the final one, used by the tree of numPreds predecessors
+  static size_t barrierTreeNumSignals(const size_t numPreds) noexcept {
+    return barrierTreeSize(numPreds) - 1ul;
+  }
 
-    // termination condition 
-    if (numPreds < 2) {
+  /**
+   * Join numPreds signals into compSig with a tree of barrierTreeSize(numPreds)
+   * barrier-AND packets, so that the packet processor resolves joins of any
+   * width. The tree is made level by level, from the leaves, and nextPkt()
+   * gives the slot of each packet in turn. Slots may be spread over queues, as
+   * long as each queue gets them in the order given: a packet then only
+   * waits on packets before it in its queue or on other queues, which can't
+   * deadlock. sigArray holds barrierTreeNumSignals(numPreds) signals for the
+   * inner nodes, which are reset to 1 here.
+   *
+   * Inner nodes use innerHeader. Only the root, completing compSig, uses
+   * header, e.g., to release at system scope
+   */
+  template <typename A, typename F>
+  static void makeBarrierTree(const F& nextPkt, Signal* sigArray, const PacketHeader& header
+      , const PacketHeader& innerHeader, const Signal& compSig, const A& preds
+      , const size_t numPreds) noexcept {
+
+    // termination condition
+    if (numPreds <= BARRIER_PKT_NUM_PREDS) {
+      init(nextPkt(), header, compSig, preds, numPreds);
       return;
     }
 
-    // locations in pktArray and sigArray that have been used or consumed
+    // locations in sigArray that have been used or consumed
     size_t usedIndex = 0ul;
 
     // generate packets for one level of the tree
     for (size_t i = 0; i < numPreds; i += BARRIER_PKT_NUM_PREDS) {
-      size_t remSz = std::min(BARRIER_PKT_NUM_PREDS, i - numPreds);
-      Signal compSig = sigArray[usedIndex];
-      init(&pktArray[usedIndex], compSig, header, &preds[i], remSz);
+      size_t remSz = std::min(BARRIER_PKT_NUM_PREDS, numPreds - i);
+      Signal sig = sigArray[usedIndex];
+      hsa_signal_store_relaxed(sig, 1);
+      init(nextPkt(), innerHeader, sig, &preds[i], remSz);
       ++usedIndex;
     }
 
     // recurse to the next level
-    makeBarrierTree(&pktArray[usedIndex], &sigArray[usedIndex], header, &sigArray[0], usedIndex);
-
+    makeBarrierTree(nextPkt, &sigArray[usedIndex], header, innerHeader, compSig, &sigArray[0], usedIndex);
   }
 };
 constexpr size_t PacketFactory::BARRIER_PKT_NUM_PREDS;
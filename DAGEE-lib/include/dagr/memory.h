@@ -281,7 +281,7 @@ struct DeviceMemManager {
     assert(numElem > 0);
 
     T* ret = nullptr;
-    ASSERT_HSA(hsa_memory_allocate(mCoarseRegion, sizeof(T) * numElem, &ret));
+    ASSERT_HSA(hsa_memory_allocate(mCoarseRegion, sizeof(T) * numElem, reinterpret_cast<void**>(&ret)));
     assert(ret);
 
     mAllocated.insert(ret);
@@ -304,6 +304,7 @@ struct DeviceMemManager {
     T* devBuf = allocate<T>(vec.size());
     assert(devBuf);
     dagr::memCopy(devBuf, &vec[0], vec.size());
+    return devBuf;
   }
 
   template <typename V, typename T = typename V::value_type>
@@ -7,6 +7,9 @@
 
 #include "cpputils/Container.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <vector>
 #include <utility>
 
@@ -116,14 +119,67 @@ struct AqlPacket {
 };
 
 
+/**
+ * Decides when DispatchQueueSerial rings the doorbell for packets launched one at a
+ * time (see submitIfDue). A doorbell is an MMIO write, which dominates the
+ * cost of launching tiny kernels, so bursts of them can share one by leaving
+ * packets pending until mMaxPackets of them, or packets and kernel args
+ * totalling mMaxBytes, are pending, or until the oldest has waited mMaxDelay.
+ * A limit of 0 is no limit.
+ *
+ * There is no timer: mMaxDelay is checked when packets are launched, and
+ * packets pending when the host stops launching are submitted by the next
+ * wait (see the executors) or flush. Batches ring once when launched,
+ * whatever the policy.
+ */
+struct SubmitPolicy {
+  size_t mMaxPackets;
+  size_t mMaxBytes;
+  std::chrono::nanoseconds mMaxDelay;
+
+  //! ring for every packet, the default
+  static SubmitPolicy eager() noexcept {
+    return SubmitPolicy {1ul, 0ul, std::chrono::nanoseconds(0)};
+  }
+
+  static SubmitPolicy coalesce(size_t maxPackets, size_t maxBytes = 0ul
+      , std::chrono::nanoseconds maxDelay = std::chrono::microseconds(20)) noexcept {
+    return SubmitPolicy {maxPackets, maxBytes, maxDelay};
+  }
+};
+
+struct SubmitStats {
+  uint64_t mPackets = 0ul;
+  uint64_t mDoorbells = 0ul;
+
+  SubmitStats& operator += (const SubmitStats& that) noexcept {
+    mPackets += that.mPackets;
+    mDoorbells += that.mDoorbells;
+    return *this;
+  }
+
+  double packetsPerDoorbell() const noexcept {
+    return mDoorbells == 0ul ? 0.0 : double(mPackets) / double(mDoorbells);
+  }
+};
+
+
 class DispatchQueueSerial {
 
+  using Clock = std::chrono::steady_clock;
+
   HsaQueue* mHsaQueue;
+  //! index of the next packet. Packets before mSubmitted have been rung for
   size_t mWriteIndex;
+  size_t mSubmitted;
+  size_t mPendingBytes = 0ul;
+  Clock::time_point mOldestPending;
+  SubmitPolicy mPolicy = SubmitPolicy::eager();
+  SubmitStats mStats;
   
   size_t readIndex() const noexcept {
-    // return hsa_queue_load_read_index_scacquire(mHsaQueue);
-    return hsa_queue_load_read_index_relaxed(mHsaQueue);
+    // acquire, so that a slot is reused only after the packet processor has read it
+    return hsa_queue_load_read_index_scacquire(mHsaQueue);
   }
 
   size_t writeIndex() const noexcept {
@@ -147,17 +203,12 @@ public:
   bool empty() const noexcept {
     return writeIndex() == readIndex();
   }
-  
-private:
 
-  size_t incWriteIndex() noexcept {
-    // return (mWriteIndex = (mWriteIndex + 1) % size());
-    // since size() is a power of 2, we can use bit-wise and
-    // return (mWriteIndex = (mWriteIndex + N) & sizeMinus1());
-    // mWriteIndex = hsa_queue_add_write_index_scacquire(mHsaQueue, N) & sizeMinus1();
-    mWriteIndex = hsa_queue_add_write_index_relaxed(mHsaQueue, 1u);
-    return mWriteIndex;
+  size_t numPending() const noexcept {
+    return mWriteIndex - mSubmitted;
   }
+  
+private:
 
   AqlPacket* headSlot() noexcept {
     return reinterpret_cast<AqlPacket*>(mHsaQueue->base_address) + (writeIndex() & sizeMinus1());
@@ -165,22 +216,49 @@ private:
 
   AqlPacket* giveOneSlotImpl() noexcept {
 
-    while (full()) {
-      // busy wait
-      // std::printf("numEmptySlots() = %zu, readIndex = %zu, writeIndex = %zu\n" , numEmptySlots(), readIndex(), writeIndex());
+    if (full()) {
+      // the packet processor stops at the doorbell, so the slots we wait
+      // for may be held by our own pending packets
+      submitPackets();
+      while (full()) {
+        // busy wait
+      }
+    }
+
+    if (numPending() == 0ul && mPolicy.mMaxDelay.count() > 0) {
+      mOldestPending = Clock::now();
     }
 
-    incWriteIndex();
+    // single producer, so the old value is mWriteIndex
+    hsa_queue_add_write_index_relaxed(mHsaQueue, 1u);
     AqlPacket* head = headSlot();
-    // std::printf("Packet address = %p\n", head);
+    ++mWriteIndex;
+    ++mStats.mPackets;
+    mPendingBytes += sizeof(AqlPacket);
     return head;
   }
 
+  bool submitDue() const noexcept {
+    const size_t n = numPending();
+    if (n == 0ul) {
+      return false;
+    }
+    if (mPolicy.mMaxPackets != 0ul && n >= mPolicy.mMaxPackets) {
+      return true;
+    }
+    if (mPolicy.mMaxBytes != 0ul && mPendingBytes >= mPolicy.mMaxBytes) {
+      return true;
+    }
+    return mPolicy.mMaxDelay.count() > 0 && Clock::now() - mOldestPending >= mPolicy.mMaxDelay;
+  }
+
 public:
 
   explicit DispatchQueueSerial(HsaQueue* q) noexcept :
     mHsaQueue(q),
-    mWriteIndex(hsa_queue_load_write_index_scacquire(q))
+    mWriteIndex(hsa_queue_load_write_index_scacquire(q)),
+    mSubmitted(mWriteIndex),
+    mOldestPending()
   {
     assert(q);
   }
@@ -189,16 +267,40 @@ public:
     return giveOneSlotImpl();
   }
 
-  /*
-  AqlPacket* giveSlots(const size_t N) noexcept {
-    assert(N < size());
-    return giveSlotsImpl(N);
+  //! count towards SubmitPolicy::mMaxBytes the kernel args of the last packet
+  void addPendingBytes(size_t bytes) noexcept {
+    mPendingBytes += bytes;
   }
-  */
 
+  //! ring the doorbell for the pending packets, if any
   void submitPackets() noexcept {
-    // std::printf("Ringing doorbell on index=%zu, readIndex=%zu\n", mWriteIndex, readIndex());
-    hsa_signal_store_screlease(mHsaQueue->doorbell_signal, mWriteIndex);
+    if (numPending() == 0ul) {
+      return;
+    }
+    hsa_signal_store_screlease(mHsaQueue->doorbell_signal, mWriteIndex - 1ul);
+    mSubmitted = mWriteIndex;
+    mPendingBytes = 0ul;
+    ++mStats.mDoorbells;
+  }
+
+  //! ring the doorbell if the pending packets reach a limit of the policy
+  void submitIfDue() noexcept {
+    if (submitDue()) {
+      submitPackets();
+    }
+  }
+
+  void setSubmitPolicy(const SubmitPolicy& policy) noexcept {
+    submitPackets();
+    mPolicy = policy;
+  }
+
+  const SubmitPolicy& submitPolicy() const noexcept {
+    return mPolicy;
+  }
+
+  const SubmitStats& submitStats() const noexcept {
+    return mStats;
   }
 
   const HsaQueue* hsaQueue() const noexcept {
@@ -213,6 +315,107 @@ public:
 
 
 
+/**
+ * Dispatch queue that many host threads can submit to at once, on a
+ * multi-producer HSA queue. A producer reserves slots with an atomic add on
+ * the write index, writes the packet bodies (see PacketFactory::initBody) and
+ * then publishes them.
+ *
+ * Headers are published in the order slots were reserved, each followed by a
+ * doorbell ring with its index, so the doorbell never moves backwards nor past
+ * a packet whose header is not valid yet. Producers write bodies in parallel,
+ * and only publishing waits on the producers that reserved earlier slots.
+ */
+class DispatchQueueConcurrent {
+
+  HsaQueue* mHsaQueue;
+  //! packets before this index have been published
+  std::atomic<uint64_t> mPublished;
+
+  uint64_t readIndex() const noexcept {
+    return hsa_queue_load_read_index_scacquire(mHsaQueue);
+  }
+
+  uint64_t sizeMinus1() const noexcept {
+    return mHsaQueue->size - 1ul;
+  }
+
+  //! header and setup make up the first 32 bits, published with one store
+  static void publishHeader(AqlPacket* pkt, const PacketHeader& header) noexcept {
+    uint32_t* word = reinterpret_cast<uint32_t*>(pkt);
+    assert((*word & 0xffffu) == 0 && "header field should be 0");
+    __atomic_store_n(word, *word | uint32_t(header.value()), __ATOMIC_RELEASE);
+  }
+
+public:
+
+  explicit DispatchQueueConcurrent(HsaQueue* q) noexcept :
+    mHsaQueue(q),
+    mPublished(hsa_queue_load_write_index_scacquire(q))
+  {
+    assert(q);
+  }
+
+  DispatchQueueConcurrent(const DispatchQueueConcurrent&) = delete;
+  DispatchQueueConcurrent& operator = (const DispatchQueueConcurrent&) = delete;
+
+  size_t size() const noexcept {
+    return mHsaQueue->size;
+  }
+
+  /**
+   * Reserve n consecutive slots, waiting for the packet processor to free
+   * them. @return the index of the first
+   */
+  uint64_t reserve(size_t n = 1ul) noexcept {
+    assert(n > 0 && n <= size());
+    uint64_t first = hsa_queue_add_write_index_scacquire(mHsaQueue, n);
+
+    while (first + n > readIndex() + size()) {
+      // producers may outnumber cores, let the ones holding us up run
+      std::this_thread::yield();
+    }
+    return first;
+  }
+
+  AqlPacket* slot(uint64_t index) noexcept {
+    return reinterpret_cast<AqlPacket*>(mHsaQueue->base_address) + (index & sizeMinus1());
+  }
+
+  /**
+   * Publish packets [first, first + n), reserved by one call to reserve and
+   * written already, with headers headerOf(i) for i in [0, n), and ring the
+   * doorbell once
+   */
+  template <typename F>
+  void publish(uint64_t first, size_t n, const F& headerOf) noexcept {
+    while (mPublished.load(std::memory_order_acquire) != first) {
+      // wait for the producers ahead
+      std::this_thread::yield();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      publishHeader(slot(first + i), headerOf(i));
+    }
+
+    hsa_signal_store_screlease(mHsaQueue->doorbell_signal, first + n - 1);
+    mPublished.store(first + n, std::memory_order_release);
+  }
+
+  void publish(uint64_t index, const PacketHeader& header) noexcept {
+    publish(index, 1ul, [&header] (size_t) { return header; });
+  }
+
+  const HsaQueue* hsaQueue() const noexcept {
+    return mHsaQueue;
+  }
+
+  HsaQueue* hsaQueue() noexcept {
+    return mHsaQueue;
+  }
+};
+
+
 }// end namespace dagr
 
 
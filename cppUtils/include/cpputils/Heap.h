@@ -5,6 +5,7 @@
 #include <cassert>
 #include <cstdio>
 #include <cstddef>
+#include <cstdlib>
 
 #include <vector>
 
@@ -0,0 +1,139 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks AdjacencyList against a plain vector under random push_back and
+// remove, across the degree at which the hashed neighbor index is built, and
+// edge lookups of DAGs with high-degree nodes
+
+#include "dagee/AdjacencyList.h"
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace dageeTests;
+
+template <typename T>
+using AdjList = dagee::AdjacencyList<T, dagee::StdAllocatorFactory<> >;
+
+template <typename T>
+void checkSame(const AdjList<T>& l, const std::vector<T>& m, const std::vector<T>& universe) {
+  TEST_CHECK(l.size() == m.size() && std::equal(m.cbegin(), m.cend(), l.cbegin()));
+  for (const T& x : universe) {
+    TEST_CHECK(l.contains(x) == (std::find(m.cbegin(), m.cend(), x) != m.cend()));
+  }
+}
+
+/**
+ * Elements come from a universe a few times larger than the index threshold,
+ * so that lists grow past it, get indexed, and removals shift entries back
+ * within probe sequences that collide and wrap around
+ */
+template <typename T>
+void testRandomOps(const std::vector<T>& universe, unsigned seed) {
+  std::mt19937 rng(seed);
+  AdjList<T> l;
+  std::vector<T> m;
+
+  for (int step = 0; step < 6000; ++step) {
+    const T x = universe[rng() % universe.size()];
+    const bool present = std::find(m.cbegin(), m.cend(), x) != m.cend();
+
+    // grow for the first half, shrink for the second
+    const unsigned pushPercent = step < 3000 ? 70 : 30;
+    if (rng() % 100 < pushPercent) {
+      if (!present) {
+        l.push_back(x);
+        m.push_back(x);
+      }
+    } else {
+      TEST_CHECK(l.remove(x) == present);
+      m.erase(std::remove(m.begin(), m.end(), x), m.end());
+    }
+
+    if (step % 97 == 0) {
+      checkSame(l, m, universe);
+    }
+    if (m.size() > 32) {
+      TEST_CHECK(l.isIndexed());
+    }
+  }
+  checkSame(l, m, universe);
+
+  // copies and moves keep the order and the index
+  AdjList<T> c(l);
+  checkSame(c, m, universe);
+  AdjList<T> moved(std::move(c));
+  checkSame(moved, m, universe);
+
+  AdjList<T> other;
+  other.push_back(universe[0]);
+  other.swap(moved);
+  checkSame(other, m, universe);
+  checkSame(moved, std::vector<T>{universe[0]}, universe);
+
+  other.clear();
+  TEST_CHECK(other.empty() && !other.isIndexed());
+  checkSame(other, std::vector<T>{}, universe);
+}
+
+//! hasEdge of a hub with thousands of neighbors, in both directions
+template <typename DAG>
+void testHub(void) {
+  constexpr uint32_t FAN = 2000;
+
+  DAG dag;
+  auto hub = dag.addNode(0u);
+  auto sink = dag.addNode(1u);
+  std::vector<typename DAG::NodePtr> leaves;
+  for (uint32_t i = 0; i < FAN; ++i) {
+    leaves.push_back(dag.addNode(2 + i));
+    if (i % 2 == 0) {
+      dag.addEdge(hub, leaves.back());
+      dag.addEdge(leaves.back(), sink);
+    }
+  }
+
+  for (uint32_t i = 0; i < FAN; ++i) {
+    TEST_CHECK(dag.hasEdge(hub, leaves[i]) == (i % 2 == 0));
+    TEST_CHECK(dag.hasEdge(leaves[i], sink) == (i % 2 == 0));
+    TEST_CHECK(!dag.hasEdge(leaves[i], hub));
+  }
+
+  // adds only the missing half
+  for (auto l : leaves) {
+    dag.addEdgeIfAbsent(hub, l);
+  }
+  for (auto l : leaves) {
+    TEST_CHECK(dag.hasEdge(hub, l));
+  }
+}
+
+int main(int, char**) {
+  std::vector<uint32_t> ints(150);
+  for (uint32_t i = 0; i < ints.size(); ++i) {
+    ints[i] = i;
+  }
+  std::vector<uint64_t*> ptrs;
+  std::vector<uint64_t> storage(150);
+  for (auto& s : storage) {
+    ptrs.push_back(&s);
+  }
+
+  for (unsigned seed = 1; seed <= 4; ++seed) {
+    testRandomOps(ints, seed);
+    testRandomOps(ptrs, seed);
+  }
+
+  using DAG = dagee::DAGbase<uint32_t>;
+  testHub<DAG::WithPred>();
+  testHub<DAG::WithSucc>();
+  testHub<DAG::WithPredSucc>();
+
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks MonotonicArena and DAGs built with ArenaAllocatorFactory: node data is
+// destroyed, and clearing a DAG gives its memory back for the next build
+
+#include "dagee/ArenaAllocFactory.h"
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace dageeTests;
+
+void testArena(void) {
+  constexpr size_t CHUNK = 4096;
+  dagee::MonotonicArena arena(CHUNK);
+  TEST_CHECK(arena.numChunks() == 0);
+
+  void* a = arena.allocate(24, 8);
+  void* b = arena.allocate(40, 64);
+  TEST_CHECK(reinterpret_cast<uintptr_t>(b) % 64 == 0 && arena.numChunks() == 1);
+
+  // freeing the last allocation rolls back, freeing an older one is a no-op
+  arena.deallocate(b, 40);
+  TEST_CHECK(arena.allocate(40, 64) == b);
+  arena.deallocate(a, 24);
+  TEST_CHECK(arena.allocate(24, 8) != a);
+
+  // fixed size blocks are recycled per size class
+  void* f = arena.allocateFixed(48, 8);
+  arena.deallocateFixed(f, 48, 8);
+  TEST_CHECK(arena.allocateFixed(40, 8) == f);
+
+  // larger than a chunk, and chunks growing geometrically
+  std::vector<uint8_t*> blocks;
+  for (int i = 0; i < 64; ++i) {
+    auto* p = static_cast<uint8_t*>(arena.allocate(3 * CHUNK / 2));
+    p[0] = p[3 * CHUNK / 2 - 1] = uint8_t(i);
+    blocks.push_back(p);
+  }
+  const size_t numChunks = arena.numChunks();
+  TEST_CHECK(numChunks > 1 && numChunks < 16);
+  for (int i = 0; i < 64; ++i) {
+    TEST_CHECK(blocks[i][0] == uint8_t(i) && blocks[i][3 * CHUNK / 2 - 1] == uint8_t(i));
+  }
+
+  arena.reset();
+  TEST_CHECK(arena.numChunks() == 1);
+  arena.release();
+  TEST_CHECK(arena.numChunks() == 0);
+}
+
+void testScope(void) {
+  dagee::MonotonicArena a0;
+  dagee::MonotonicArena a1;
+
+  TEST_CHECK(dagee::MonotonicArena::current() == nullptr);
+  {
+    dagee::MonotonicArena::Scope s0(a0);
+    TEST_CHECK(dagee::MonotonicArena::current() == &a0);
+    {
+      dagee::MonotonicArena::Scope s1(a1);
+      dagee::ArenaAllocator<int> alloc;
+      TEST_CHECK(alloc.mArena == &a1);
+    }
+    TEST_CHECK(dagee::MonotonicArena::current() == &a0);
+  }
+
+  // outside of any scope, allocators fall back to the heap
+  dagee::ArenaAllocator<int> heapAlloc;
+  TEST_CHECK(heapAlloc.mArena == nullptr);
+  int* p = heapAlloc.allocate(4);
+  p[3] = 3;
+  heapAlloc.deallocate(p, 4);
+}
+
+//! node data with a destructor, counting live instances
+struct Counted {
+  static int sNumLive;
+  uint32_t mId;
+  std::vector<uint32_t> mPayload;
+
+  Counted(uint32_t id) : mId(id), mPayload(id % 7, id) { ++sNumLive; }
+  Counted(const Counted& that) : mId(that.mId), mPayload(that.mPayload) { ++sNumLive; }
+  ~Counted(void) { --sNumLive; }
+
+  operator uint32_t(void) const { return mId; }
+};
+int Counted::sNumLive = 0;
+
+template <typename DAG>
+void testArenaDAG(void) {
+  constexpr uint32_t N = 3000;
+
+  DAG dag;
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    const EdgeVec edges = randomEdges(N, 6, seed);
+    buildDAG(dag, N, edges);
+    TEST_CHECK(Counted::sNumLive == int(N));
+
+    std::vector<uint32_t> order;
+    dag.forEachNode_TopoOrder([&](typename DAG::NodePtr n) { order.push_back(dag.nodeData(n)); });
+    checkTopoOrder(N, edges, order);
+
+    dag.freeze();
+    TEST_CHECK(dag.frozen().numEdges() == edges.size());
+
+    // nodes are destroyed one by one since Counted has a destructor, the rest in bulk
+    dag.clear();
+    TEST_CHECK(Counted::sNumLive == 0);
+  }
+
+  // the destructor releases whatever was built last
+  buildDAG(dag, N, randomEdges(N, 6, 4));
+}
+
+int main(int, char**) {
+  testArena();
+  testScope();
+
+  using DAG = dagee::DAGbase<Counted, dagee::ArenaAllocatorFactory<4096> >;
+  testArenaDAG<DAG::WithPred>();
+  testArenaDAG<DAG::WithSucc>();
+  testArenaDAG<DAG::WithPredSucc>();
+  TEST_CHECK(Counted::sNumLive == 0);
+
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Builds DAGs from several producer threads with ConcurrentDAGbuilder, with
+// edges between the nodes of different producers, and checks the result
+
+#include "dagee/ConcurrentDAGbuilder.h"
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <cstdio>
+#include <set>
+#include <vector>
+
+using namespace dageeTests;
+
+template <typename DAG>
+void testBuilder(unsigned numProducers, uint32_t nodesPerProducer, unsigned seed) {
+  using NodePtr = typename DAG::NodePtr;
+
+  const uint32_t N = numProducers * nodesPerProducer;
+  // node ids are global, so most edges connect nodes of different producers
+  const EdgeVec edges = randomEdges(N, 6, seed);
+
+  DAG dag;
+  dagee::ConcurrentDAGbuilder<DAG> builder(dag, numProducers);
+  std::vector<NodePtr> nodes(N, nullptr);
+
+  // producer p adds the nodes p * nodesPerProducer onwards
+  builder.runProducers([&](typename dagee::ConcurrentDAGbuilder<DAG>::Producer& prod, unsigned p) {
+    for (uint32_t k = 0; k < nodesPerProducer; ++k) {
+      const uint32_t id = p * nodesPerProducer + k;
+      nodes[id] = prod.addNode(id);
+    }
+  });
+  for (unsigned p = 0; p < numProducers; ++p) {
+    TEST_CHECK(builder.producer(p).numNodes() == nodesPerProducer);
+  }
+
+  // then each producer adds every numProducers-th edge, so that the lists of a
+  // node are updated by several threads at once
+  builder.runProducers([&](typename dagee::ConcurrentDAGbuilder<DAG>::Producer& prod, unsigned p) {
+    for (size_t i = p; i < edges.size(); i += numProducers) {
+      prod.addEdge(nodes[edges[i].first], nodes[edges[i].second]);
+    }
+  });
+
+  builder.finalize(true);
+  TEST_CHECK(dag.isFrozen());
+
+  const auto& fz = dag.frozen();
+  TEST_CHECK(fz.size() == N);
+  TEST_CHECK(fz.numEdges() == edges.size());
+
+  // nodes are spliced in producer order
+  for (uint32_t i = 0; i < N; ++i) {
+    TEST_CHECK(fz.node(i) == nodes[i] && dag.nodeData(fz.node(i)) == i);
+  }
+
+  std::set<Edge> built;
+  std::set<Edge> builtByPred;
+  for (uint32_t i = 0; i < N; ++i) {
+    for (uint32_t s : fz.successors(i)) {
+      built.emplace(i, s);
+    }
+    for (uint32_t p : fz.predecessors(i)) {
+      builtByPred.emplace(p, i);
+    }
+  }
+  TEST_CHECK(built == std::set<Edge>(edges.cbegin(), edges.cend()) && built == builtByPred);
+
+  std::vector<uint32_t> order;
+  dag.forEachNode_TopoOrder([&](NodePtr n) { order.push_back(dag.nodeData(n)); });
+  checkTopoOrder(N, edges, order);
+
+  // a reused builder appends to the DAG; unfinalized nodes are handed over on destruction
+  builder.producer(numProducers - 1).addNode(N);
+  builder.finalize();
+  TEST_CHECK(!dag.isFrozen());
+  {
+    dagee::ConcurrentDAGbuilder<DAG> other(dag, 1);
+    other.producer(0).addNode(N + 1);
+  }
+  dag.freeze();
+  TEST_CHECK(dag.frozen().size() == N + 2 && dag.frozen().numEdges() == edges.size());
+}
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    testBuilder<DAG::WithPred>(4, 500, seed);
+    testBuilder<DAG::WithSucc>(4, 500, seed);
+    testBuilder<DAG::WithPredSucc>(4, 500, seed);
+  }
+  testBuilder<DAG::WithPredSucc>(1, 1000, 4);
+  testBuilder<DAG::WithPredSucc>(7, 100, 5);
+
+  std::printf("PASSED!\n");
+  return 0;
+}
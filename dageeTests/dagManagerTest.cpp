@@ -0,0 +1,156 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks that DAGmanager rejects stale handles, also when the slot was reused,
+// reuses warm DAGs up to setMaxWarm, and that of several threads destroying
+// the same DAG through its handle, exactly one does
+
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace dageeTests;
+
+using DAG = dagee::DAGbase<uint32_t>::WithPredSucc;
+using Manager = dagee::DAGmanager<DAG, dagee::StdAllocatorFactory<> >;
+
+constexpr unsigned NUM_THREADS = 4;
+
+size_t numNodes(DAG& dag) {
+  size_t n = 0;
+  dag.forEachNode([&n](DAG::NodePtr) { ++n; });
+  return n;
+}
+
+void testHandles(void) {
+  Manager mgr;
+  TEST_CHECK(mgr.get(Manager::DAGhandle()) == nullptr);
+
+  DAG* d = mgr.makeDAG();
+  const auto h = mgr.handleOf(d);
+  TEST_CHECK(mgr.get(h) == d && mgr.numLive() == 1 && mgr.numSlots() == 1);
+
+  TEST_CHECK(mgr.destroyDAG(h));
+  TEST_CHECK(mgr.get(h) == nullptr && mgr.numLive() == 0);
+  TEST_CHECK(!mgr.destroyDAG(h));
+
+  // the slot is reused, but not the handle
+  DAG* e = mgr.makeDAG();
+  const auto g = mgr.handleOf(e);
+  TEST_CHECK(e == d && mgr.numSlots() == 1 && g != h);
+  TEST_CHECK(mgr.get(h) == nullptr && !mgr.destroyDAG(h));
+  TEST_CHECK(mgr.get(g) == e && mgr.numLive() == 1);
+
+  mgr.destroyDAG(e);
+  TEST_CHECK(mgr.get(g) == nullptr && !mgr.destroyDAG(g));
+}
+
+void testWarm(void) {
+  Manager mgr;
+  mgr.setMaxWarm(2);
+  TEST_CHECK(mgr.maxWarm() == 2);
+
+  std::vector<DAG*> dags;
+  std::vector<Manager::DAGhandle> handles;
+  for (uint32_t i = 0; i < 3; ++i) {
+    dags.push_back(mgr.makeDAG());
+    handles.push_back(mgr.handleOf(dags.back()));
+    auto a = dags.back()->addNode(i);
+    dags.back()->addEdge(a, dags.back()->addNode(i + 1));
+  }
+
+  for (const auto& h : handles) {
+    TEST_CHECK(mgr.destroyDAG(h));
+  }
+  TEST_CHECK(mgr.numLive() == 0 && mgr.numWarm() == 2 && mgr.numSlots() == 3);
+
+  // warm DAGs come back cleared, and their handles stay stale
+  for (int k = 0; k < 2; ++k) {
+    DAG* d = mgr.makeDAG();
+    TEST_CHECK(numNodes(*d) == 0);
+    TEST_CHECK(d == dags[0] || d == dags[1] || d == dags[2]);
+    TEST_CHECK(mgr.handleOf(d) != handles[d == dags[0] ? 0 : d == dags[1] ? 1 : 2]);
+    for (const auto& h : handles) {
+      TEST_CHECK(mgr.get(h) == nullptr);
+    }
+    d->addNode(0u);
+  }
+  TEST_CHECK(mgr.numWarm() == 0 && mgr.numLive() == 2 && mgr.numSlots() == 3);
+
+  // the third one reuses the freed slot
+  DAG* d = mgr.makeDAG();
+  TEST_CHECK(mgr.numSlots() == 3 && mgr.numLive() == 3 && numNodes(*d) == 0);
+
+  mgr.destroyDAG(d);
+  TEST_CHECK(mgr.numWarm() == 1);
+  mgr.setMaxWarm(0);
+  TEST_CHECK(mgr.numWarm() == 0 && mgr.numLive() == 2);
+}
+
+/**
+ * Threads destroy DAGs through copies of the same handles while making new
+ * DAGs, which reuse the slots: each DAG must be destroyed exactly once
+ */
+void testConcurrentDestroy(size_t maxWarm) {
+  constexpr size_t NUM_DAGS = 2000;
+
+  Manager mgr;
+  mgr.setMaxWarm(maxWarm);
+
+  std::vector<Manager::DAGhandle> handles;
+  for (size_t i = 0; i < NUM_DAGS; ++i) {
+    DAG* d = mgr.makeDAG();
+    d->addNode(uint32_t(i));
+    handles.push_back(mgr.handleOf(d));
+  }
+
+  std::atomic<size_t> numDestroyed(0);
+  std::vector<std::vector<DAG*> > made(NUM_THREADS);
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < NUM_THREADS; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < NUM_DAGS; ++i) {
+        if (mgr.destroyDAG(handles[(i + t) % NUM_DAGS])) {
+          numDestroyed.fetch_add(1);
+        }
+        if (i % 4 == t) {
+          made[t].push_back(mgr.makeDAG());
+          made[t].back()->addNode(uint32_t(i));
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  TEST_CHECK(numDestroyed.load() == NUM_DAGS);
+
+  size_t numMade = 0;
+  for (const auto& m : made) {
+    numMade += m.size();
+    for (DAG* d : m) {
+      TEST_CHECK(numNodes(*d) == 1);
+      TEST_CHECK(mgr.get(mgr.handleOf(d)) == d);
+    }
+  }
+  TEST_CHECK(mgr.numLive() == numMade && mgr.numSlots() <= NUM_DAGS);
+  for (const auto& h : handles) {
+    TEST_CHECK(mgr.get(h) == nullptr);
+  }
+}
+
+int main(int, char**) {
+  testHandles();
+  testWarm();
+  testConcurrentDestroy(0);
+  testConcurrentDestroy(64);
+
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Helpers shared by the host tests of dagee: checks that stay on in release
+// builds, and random DAGs to run them on
+
+#ifndef DAGEE_TESTS_DAG_TEST_UTIL_H
+#define DAGEE_TESTS_DAG_TEST_UTIL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+//! like assert, but not compiled out by NDEBUG
+#define TEST_CHECK(cond)                                                          \
+  do {                                                                            \
+    if (!(cond)) {                                                                \
+      std::fprintf(stderr, "Failed: '%s' at %s:%d\n", #cond, __FILE__, __LINE__); \
+      std::abort();                                                               \
+    }                                                                             \
+  } while (0)
+
+namespace dageeTests {
+
+using Edge = std::pair<uint32_t, uint32_t>;
+using EdgeVec = std::vector<Edge>;
+
+/**
+ * Edges of a random DAG over nodes 0..numNodes-1, each node getting up to
+ * maxPreds predecessors. Edges follow a random ranking of the nodes rather
+ * than their ids, so that insertion order is not a topological order
+ */
+inline EdgeVec randomEdges(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint32_t> byRank(numNodes);
+  std::iota(byRank.begin(), byRank.end(), 0u);
+  std::shuffle(byRank.begin(), byRank.end(), rng);
+
+  std::set<Edge> edges;
+  for (uint32_t r = 1; r < numNodes; ++r) {
+    const uint32_t numPreds = rng() % (maxPreds + 1);
+    for (uint32_t k = 0; k < numPreds; ++k) {
+      edges.emplace(byRank[rng() % r], byRank[r]);
+    }
+  }
+  return EdgeVec(edges.cbegin(), edges.cend());
+}
+
+//! add nodes with data 0..numNodes-1 and the edges between them to dag
+template <typename DAG>
+std::vector<typename DAG::NodePtr> buildDAG(DAG& dag, uint32_t numNodes, const EdgeVec& edges) {
+  std::vector<typename DAG::NodePtr> nodes;
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    nodes.push_back(dag.addNode(i));
+  }
+  for (const Edge& e : edges) {
+    dag.addEdge(nodes[e.first], nodes[e.second]);
+  }
+  return nodes;
+}
+
+//! check that order lists every node once, each after its predecessors
+inline void checkTopoOrder(uint32_t numNodes, const EdgeVec& edges,
+                           const std::vector<uint32_t>& order) {
+  TEST_CHECK(order.size() == numNodes);
+  std::vector<uint32_t> pos(numNodes, numNodes);
+  for (uint32_t k = 0; k < order.size(); ++k) {
+    TEST_CHECK(order[k] < numNodes && pos[order[k]] == numNodes);
+    pos[order[k]] = k;
+  }
+  for (const Edge& e : edges) {
+    TEST_CHECK(pos[e.first] < pos[e.second]);
+  }
+}
+
+} // end namespace dageeTests
+
+#endif // DAGEE_TESTS_DAG_TEST_UTIL_H
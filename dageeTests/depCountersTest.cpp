@@ -0,0 +1,145 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks DepCounterArray in both layouts, under concurrent decrements too, and
+// that the topological traversals are right whatever the layout set by
+// DAGbase::setDepCounterLayout, including when it changes between traversals
+
+#include "dagee/DepCounters.h"
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace dageeTests;
+
+using dagee::DepCounterLayout;
+
+constexpr unsigned NUM_THREADS = 4;
+
+void testArray(DepCounterLayout layout) {
+  dagee::DepCounterArray counters(layout);
+  TEST_CHECK(counters.layout() == layout && counters.size() == 0);
+
+  // growing, then shrinking, which reuses the storage
+  for (size_t n : {10ul, 1000ul, 5ul}) {
+    counters.reset(n, [](size_t i) { return unsigned(i % 5 + 1); });
+    TEST_CHECK(counters.size() == n);
+    for (size_t i = 0; i < n; ++i) {
+      TEST_CHECK(counters.value(i) == i % 5 + 1);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      TEST_CHECK(counters.decrement(i) == i % 5);
+      TEST_CHECK(counters.value(i) == i % 5);
+    }
+  }
+
+  // every thread decrements every counter once; only the last one sees 0
+  constexpr size_t N = 4096;
+  counters.reset(N, [](size_t) { return NUM_THREADS; });
+  std::vector<std::atomic<unsigned> > numZero(N);
+  for (auto& z : numZero) {
+    z = 0;
+  }
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < NUM_THREADS; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t k = 0; k < N; ++k) {
+        // threads start at different counters, so that neighbors get hit at once
+        const size_t i = (k + t) % N;
+        if (counters.decrement(i) == 0) {
+          numZero[i].fetch_add(1);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (size_t i = 0; i < N; ++i) {
+    TEST_CHECK(counters.value(i) == 0 && numZero[i].load() == 1);
+  }
+
+  counters.releaseStorage();
+  TEST_CHECK(counters.size() == 0);
+  counters.reset(3, [](size_t) { return 2u; });
+  TEST_CHECK(counters.value(2) == 2);
+}
+
+//! ids of the nodes in the order visited by the serial traversal
+template <typename DAG>
+std::vector<uint32_t> serialOrder(DAG& dag) {
+  std::vector<uint32_t> order;
+  dag.forEachNode_TopoOrder([&](typename DAG::NodePtr n) { order.push_back(dag.nodeData(n)); });
+  return order;
+}
+
+//! ids of the nodes in the order the parallel traversal started visiting them
+template <typename DAG>
+std::vector<uint32_t> parallelOrder(DAG& dag, uint32_t numNodes) {
+  std::vector<uint32_t> order(numNodes);
+  std::atomic<uint32_t> next(0);
+  dag.forEachNode_TopoOrderParallel(NUM_THREADS, [&](typename DAG::NodePtr n) {
+    const uint32_t k = next.fetch_add(1);
+    TEST_CHECK(k < numNodes);
+    order[k] = dag.nodeData(n);
+  });
+  TEST_CHECK(next.load() == numNodes);
+  return order;
+}
+
+/**
+ * Traversals with layout first, unfrozen then frozen, then with layout second
+ * on the same DAG, and again once nodes are added, i.e., with more counters
+ */
+template <typename DAG>
+void testTraversals(DepCounterLayout first, DepCounterLayout second, uint32_t numNodes,
+                    uint32_t maxPreds, unsigned seed) {
+  EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+
+  DAG dag;
+  auto nodes = buildDAG(dag, numNodes, edges);
+
+  dag.setDepCounterLayout(first);
+  checkTopoOrder(numNodes, edges, serialOrder(dag));
+  checkTopoOrder(numNodes, edges, parallelOrder(dag, numNodes));
+  dag.freeze();
+  checkTopoOrder(numNodes, edges, parallelOrder(dag, numNodes));
+
+  dag.setDepCounterLayout(second);
+  checkTopoOrder(numNodes, edges, parallelOrder(dag, numNodes));
+
+  for (uint32_t i = numNodes; i < 2 * numNodes; ++i) {
+    nodes.push_back(dag.addNode(i));
+    dag.addEdge(nodes[i - numNodes], nodes[i]);
+    edges.emplace_back(i - numNodes, i);
+  }
+  TEST_CHECK(!dag.isFrozen());
+  checkTopoOrder(2 * numNodes, edges, parallelOrder(dag, 2 * numNodes));
+  checkTopoOrder(2 * numNodes, edges, serialOrder(dag));
+}
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+
+  testArray(DepCounterLayout::PACKED);
+  testArray(DepCounterLayout::PADDED);
+
+  const DepCounterLayout PACKED = DepCounterLayout::PACKED;
+  const DepCounterLayout PADDED = DepCounterLayout::PADDED;
+
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    testTraversals<DAG::WithSucc>(PADDED, PACKED, 2000, 3, seed);
+    testTraversals<DAG::WithSucc>(PACKED, PADDED, 2000, 3, seed);
+    testTraversals<DAG::WithPredSucc>(PADDED, PADDED, 2000, 3, seed);
+    testTraversals<DAG::WithPredSucc>(PACKED, PADDED, 2000, 3, seed);
+  }
+
+  std::printf("PASSED!\n");
+  return 0;
+}
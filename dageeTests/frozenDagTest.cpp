@@ -0,0 +1,101 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks the CSR snapshot built by DAGbase::freeze() against the edges the DAG
+// was built from, for every node kind, and that modifications drop it
+
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace dageeTests;
+
+template <typename DAG>
+void testFreeze(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  using Index = typename DAG::Index;
+
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  DAG dag;
+  auto nodes = buildDAG(dag, numNodes, edges);
+
+  TEST_CHECK(!dag.isFrozen());
+  dag.freeze();
+  TEST_CHECK(dag.isFrozen());
+
+  const auto& fz = dag.frozen();
+  TEST_CHECK(fz.size() == numNodes);
+  TEST_CHECK(fz.numEdges() == edges.size());
+
+  // nodes are numbered in insertion order
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    TEST_CHECK(fz.node(i) == nodes[i] && nodes[i]->frozenIndex() == i);
+  }
+
+  std::vector<std::set<uint32_t> > succs(numNodes);
+  std::vector<std::set<uint32_t> > preds(numNodes);
+  for (const Edge& e : edges) {
+    succs[e.first].insert(e.second);
+    preds[e.second].insert(e.first);
+  }
+
+  for (Index i = 0; i < numNodes; ++i) {
+    TEST_CHECK(std::set<uint32_t>(fz.successors(i).begin(), fz.successors(i).end()) == succs[i]);
+    TEST_CHECK(std::set<uint32_t>(fz.predecessors(i).begin(), fz.predecessors(i).end()) ==
+               preds[i]);
+    TEST_CHECK(fz.isSrc(i) == preds[i].empty() && fz.isSink(i) == succs[i].empty());
+  }
+
+  size_t numSources = 0;
+  for (Index i : fz.sources()) {
+    TEST_CHECK(preds[i].empty());
+    ++numSources;
+  }
+  auto noPreds = [](const std::set<uint32_t>& p) { return p.empty(); };
+  TEST_CHECK(numSources == size_t(std::count_if(preds.cbegin(), preds.cend(), noPreds)));
+
+  checkTopoOrder(numNodes, edges,
+                 std::vector<uint32_t>(fz.topoOrder().cbegin(), fz.topoOrder().cend()));
+
+  // a frozen DAG replays the cached order
+  std::vector<uint32_t> order;
+  dag.forEachNode_TopoOrder([&](typename DAG::NodePtr n) { order.push_back(dag.nodeData(n)); });
+  checkTopoOrder(numNodes, edges, order);
+
+  // freeze is cached until the next modification
+  const Index* succData = fz.successors(0).begin();
+  dag.freeze();
+  TEST_CHECK(dag.isFrozen() && fz.successors(0).begin() == succData);
+
+  auto extra = dag.addNode(numNodes);
+  TEST_CHECK(!dag.isFrozen());
+  dag.freeze();
+  TEST_CHECK(dag.frozen().size() == numNodes + 1 && dag.frozen().isSrc(numNodes));
+
+  dag.addEdge(nodes[0], extra);
+  TEST_CHECK(!dag.isFrozen());
+  dag.freeze();
+  TEST_CHECK(dag.frozen().numEdges() == edges.size() + 1 && !dag.frozen().isSrc(numNodes));
+
+  dag.clear();
+  TEST_CHECK(!dag.isFrozen());
+  dag.freeze();
+  TEST_CHECK(dag.frozen().size() == 0 && dag.frozen().topoOrder().empty());
+}
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+
+  for (unsigned seed = 1; seed <= 4; ++seed) {
+    testFreeze<DAG::WithPred>(500, 4, seed);
+    testFreeze<DAG::WithSucc>(500, 4, seed);
+    testFreeze<DAG::WithPredSucc>(500, 4, seed);
+  }
+  // no edges, and a single chain
+  testFreeze<DAG::WithPredSucc>(64, 0, 5);
+  testFreeze<DAG::WithPredSucc>(64, 1, 6);
+
+  std::printf("PASSED!\n");
+  return 0;
+}
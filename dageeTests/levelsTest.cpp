@@ -0,0 +1,107 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks DAGbase::computeLevels against longest-path depths computed by brute
+// force, and that the levels are cached until the DAG is modified
+
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace dageeTests;
+
+//! longest path from a source to each node, in edges, by relaxing edges N times
+std::vector<uint32_t> depths(uint32_t numNodes, const EdgeVec& edges) {
+  std::vector<uint32_t> d(numNodes, 0);
+  for (uint32_t round = 0; round < numNodes; ++round) {
+    bool changed = false;
+    for (const Edge& e : edges) {
+      if (d[e.second] < d[e.first] + 1) {
+        d[e.second] = d[e.first] + 1;
+        changed = true;
+      }
+    }
+    if (!changed) {
+      break;
+    }
+  }
+  return d;
+}
+
+template <typename DAG>
+void testLevels(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  const std::vector<uint32_t> expected = depths(numNodes, edges);
+
+  DAG dag;
+  auto nodes = buildDAG(dag, numNodes, edges);
+
+  const auto& levels = dag.computeLevels();
+  TEST_CHECK(dag.isFrozen());
+
+  const uint32_t numLevels = *std::max_element(expected.cbegin(), expected.cend()) + 1;
+  TEST_CHECK(levels.numLevels() == numLevels);
+
+  std::vector<uint32_t> seen(numNodes, 0);
+  size_t maxWidth = 0;
+  for (uint32_t l = 0; l < levels.numLevels(); ++l) {
+    const auto level = levels.level(l);
+    TEST_CHECK(!level.empty());
+    maxWidth = std::max(maxWidth, level.size());
+
+    uint32_t prev = 0;
+    for (size_t k = 0; k < level.size(); ++k) {
+      const uint32_t id = dag.nodeData(level[k]);
+      TEST_CHECK(expected[id] == l && levels.levelOf(level[k]->frozenIndex()) == l);
+      // stable w.r.t. insertion order
+      TEST_CHECK(k == 0 || prev < id);
+      prev = id;
+      ++seen[id];
+    }
+  }
+  TEST_CHECK(std::all_of(seen.cbegin(), seen.cend(), [](uint32_t s) { return s == 1; }));
+  TEST_CHECK(levels.maxWidth() == maxWidth && levels.nodes().size() == numNodes);
+
+  // cached until the next modification
+  const auto* firstLevel = levels.level(0).begin();
+  TEST_CHECK(&dag.computeLevels() == &levels && levels.level(0).begin() == firstLevel);
+
+  // a new node below the deepest one adds a level
+  auto deepest = nodes[std::max_element(expected.cbegin(), expected.cend()) - expected.cbegin()];
+  dag.addEdge(deepest, dag.addNode(numNodes));
+  TEST_CHECK(!dag.isFrozen());
+  const auto& relevelled = dag.computeLevels();
+  TEST_CHECK(relevelled.numLevels() == numLevels + 1);
+  TEST_CHECK(relevelled.level(numLevels).size() == 1 &&
+             dag.nodeData(relevelled.level(numLevels)[0]) == numNodes);
+}
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+
+  for (unsigned seed = 1; seed <= 4; ++seed) {
+    testLevels<DAG::WithPred>(1000, 3, seed);
+    testLevels<DAG::WithSucc>(1000, 3, seed);
+    testLevels<DAG::WithPredSucc>(1000, 3, seed);
+  }
+  // a single level, and one level per node
+  testLevels<DAG::WithPredSucc>(100, 0, 5);
+  {
+    DAG::WithPredSucc chain;
+    EdgeVec edges;
+    for (uint32_t i = 1; i < 50; ++i) {
+      edges.emplace_back(i - 1, i);
+    }
+    buildDAG(chain, 50, edges);
+    TEST_CHECK(chain.computeLevels().numLevels() == 50 && chain.computeLevels().maxWidth() == 1);
+  }
+
+  DAG::WithPredSucc empty;
+  TEST_CHECK(empty.computeLevels().numLevels() == 0 && empty.computeLevels().maxWidth() == 0);
+
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks the partitions of OutOfCorePartitioner against the DAG and the task
+// footprints: every task in one partition, partitions in topological order,
+// their buffers, bytes and cut edges, and the budget, oversized tasks aside
+
+#include "dagee/OutOfCorePartitioner.h"
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+using namespace dageeTests;
+
+using DAG = dagee::DAGbase<uint32_t>::WithPredSucc;
+using Partitioner = dagee::OutOfCorePartitioner<DAG::NodePtr, dagee::StdAllocatorFactory<> >;
+
+constexpr uint32_t NUM_BUFFERS = 64;
+
+size_t bufferBytes(uint64_t b) { return (b % 5 + 1) * 100; }
+
+//! buffers of task id: 1 to 3 of them, spread over NUM_BUFFERS, with sparse ids
+std::vector<uint64_t> buffersOf(uint32_t id) {
+  std::vector<uint64_t> bufs;
+  for (uint32_t k = 0; k <= id % 3; ++k) {
+    const uint64_t b = ((id * 7 + k * 13) % NUM_BUFFERS) * 1000 + 3;
+    if (std::find(bufs.cbegin(), bufs.cend(), b) == bufs.cend()) {
+      bufs.push_back(b);
+    }
+  }
+  return bufs;
+}
+
+struct Footprint {
+  const DAG& mDag;
+
+  void operator()(DAG::NodePtr n, Partitioner::BufferUseVec& out) const {
+    for (uint64_t b : buffersOf(mDag.nodeData(n))) {
+      out.push_back(dagee::BufferUse{b, bufferBytes(b)});
+    }
+  }
+};
+
+size_t footprintBytes(uint32_t id) {
+  size_t sum = 0;
+  for (uint64_t b : buffersOf(id)) {
+    sum += bufferBytes(b);
+  }
+  return sum;
+}
+
+void check(DAG& dag, uint32_t numNodes, const EdgeVec& edges, const Partitioner& plan,
+           size_t share) {
+  TEST_CHECK(plan.valid());
+
+  // tasks, by id, of each partition; all of them in order are a topological order
+  std::vector<uint32_t> partOf(numNodes, ~0u);
+  std::vector<uint32_t> order;
+  size_t numOversized = 0;
+  size_t bytesTransferred = 0;
+
+  for (uint32_t p = 0; p < plan.numPartitions(); ++p) {
+    TEST_CHECK(plan.tasks(p).size() > 0);
+
+    std::set<uint64_t> bufs;
+    for (DAG::NodePtr n : plan.tasks(p)) {
+      const uint32_t id = dag.nodeData(n);
+      TEST_CHECK(partOf[id] == ~0u);
+      partOf[id] = p;
+      TEST_CHECK(plan.partitionOf(n->frozenIndex()) == p);
+      order.push_back(id);
+      for (uint64_t b : buffersOf(id)) {
+        bufs.insert(b);
+      }
+    }
+
+    // each buffer used by the partition, once
+    const auto pb = plan.buffers(p);
+    TEST_CHECK(std::set<uint64_t>(pb.begin(), pb.end()) == bufs && pb.size() == bufs.size());
+
+    size_t bytes = 0;
+    for (uint64_t b : bufs) {
+      bytes += bufferBytes(b);
+    }
+    TEST_CHECK(plan.partitionBytes(p) == bytes);
+    bytesTransferred += bytes;
+
+    if (bytes > share) {
+      // only a task too big for any partition may exceed the share, on its own
+      TEST_CHECK(plan.tasks(p).size() == 1);
+      ++numOversized;
+    }
+  }
+  checkTopoOrder(numNodes, edges, order);
+
+  TEST_CHECK(plan.bytesTransferred() == bytesTransferred);
+  TEST_CHECK(plan.numOversized() == numOversized && plan.fits() == (numOversized == 0));
+
+  // cut edges go forward, and make up the partition DAG
+  std::set<std::pair<uint32_t, uint32_t> > partEdges;
+  size_t numCut = 0;
+  for (const Edge& e : edges) {
+    TEST_CHECK(partOf[e.first] <= partOf[e.second]);
+    if (partOf[e.first] != partOf[e.second]) {
+      ++numCut;
+      partEdges.emplace(partOf[e.first], partOf[e.second]);
+    }
+  }
+  TEST_CHECK(plan.numCutEdges() == numCut);
+  const auto& pe = plan.partitionEdges();
+  TEST_CHECK(pe.size() == partEdges.size());
+  TEST_CHECK(std::equal(pe.cbegin(), pe.cend(), partEdges.cbegin()));
+}
+
+void testPartitions(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  DAG dag;
+  buildDAG(dag, numNodes, edges);
+  dag.freeze();
+
+  size_t maxTask = 0;
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    maxTask = std::max(maxTask, footprintBytes(i));
+  }
+
+  Partitioner plan;
+  for (size_t lookahead : {1ul, 8ul, 32ul}) {
+    // every task fits, with 1 and 2 partitions resident
+    for (size_t numResident : {1ul, 2ul}) {
+      const dagee::OutOfCoreBudget budget(4 * maxTask * numResident, numResident, lookahead);
+      plan.build(dag.frozen(), Footprint{dag}, budget);
+      check(dag, numNodes, edges, plan, budget.bytesPerPartition());
+      TEST_CHECK(plan.fits() && plan.numPartitions() > 1);
+      TEST_CHECK(plan.maxPartitionBytes() <= budget.bytesPerPartition());
+    }
+
+    // the largest tasks don't fit on their own
+    const dagee::OutOfCoreBudget tight(maxTask - 1, 1, lookahead);
+    plan.build(dag.frozen(), Footprint{dag}, tight);
+    check(dag, numNodes, edges, plan, tight.bytesPerPartition());
+    TEST_CHECK(!plan.fits());
+
+    // everything at once
+    const dagee::OutOfCoreBudget roomy(NUM_BUFFERS * bufferBytes(4), 1, lookahead);
+    plan.build(dag.frozen(), Footprint{dag}, roomy);
+    check(dag, numNodes, edges, plan, roomy.bytesPerPartition());
+    TEST_CHECK(plan.numPartitions() == 1 && plan.numCutEdges() == 0 &&
+               plan.partitionEdges().empty());
+  }
+
+  plan.clear();
+  TEST_CHECK(!plan.valid() && plan.numPartitions() == 0);
+}
+
+int main(int, char**) {
+  for (unsigned seed = 1; seed <= 4; ++seed) {
+    testPartitions(500, 3, seed);
+  }
+  testPartitions(200, 0, 5);
+
+  std::printf("PASSED!\n");
+  return 0;
+}
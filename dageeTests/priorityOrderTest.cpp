@@ -0,0 +1,154 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks DAGbase::computeBottomLevels against brute force, that
+// computePriorityOrder always picks the ready node with the largest bottom
+// level, and that the traversals given a cost model follow it
+
+#include "dagee/CostModel.h"
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+using namespace dageeTests;
+
+//! node data is the id, so that costs vary between nodes
+struct IdCost {
+  double operator()(uint32_t id) const { return double(id % 7 + 1); }
+};
+
+//! cost of the most expensive path from each node to a sink, by relaxing edges N times
+std::vector<double> bottomLevels(uint32_t numNodes, const EdgeVec& edges) {
+  IdCost cost;
+  std::vector<double> bl(numNodes);
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    bl[i] = cost(i);
+  }
+  for (uint32_t round = 0; round < numNodes; ++round) {
+    bool changed = false;
+    for (const Edge& e : edges) {
+      if (bl[e.first] < bl[e.second] + cost(e.first)) {
+        bl[e.first] = bl[e.second] + cost(e.first);
+        changed = true;
+      }
+    }
+    if (!changed) {
+      break;
+    }
+  }
+  return bl;
+}
+
+template <typename DAG>
+void testPriority(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  using Index = typename DAG::Index;
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  const std::vector<double> expected = bottomLevels(numNodes, edges);
+
+  DAG dag;
+  buildDAG(dag, numNodes, edges);
+
+  std::vector<double> bl;
+  dag.computeBottomLevels(IdCost(), bl);
+  TEST_CHECK(dag.isFrozen() && bl.size() == numNodes);
+
+  const auto& fz = dag.frozen();
+  std::vector<Index> indexOf(numNodes);
+  for (Index i = 0; i < numNodes; ++i) {
+    const uint32_t id = dag.nodeData(fz.node(i));
+    TEST_CHECK(bl[i] == expected[id]);
+    indexOf[id] = i;
+  }
+
+  std::vector<Index> order;
+  dag.computePriorityOrder(bl, order);
+
+  std::vector<uint32_t> ids;
+  for (Index i : order) {
+    ids.push_back(dag.nodeData(fz.node(i)));
+  }
+  checkTopoOrder(numNodes, edges, ids);
+
+  // list scheduling: each node has the largest bottom level of all the nodes
+  // ready at its turn, ties going to the smaller index
+  std::vector<uint32_t> numPending(numNodes, 0);
+  for (const Edge& e : edges) {
+    ++numPending[e.second];
+  }
+  std::vector<bool> done(numNodes, false);
+  for (uint32_t id : ids) {
+    for (uint32_t r = 0; r < numNodes; ++r) {
+      if (done[r] || numPending[r] != 0 || r == id) {
+        continue;
+      }
+      TEST_CHECK(expected[r] < expected[id] ||
+                 (expected[r] == expected[id] && indexOf[r] > indexOf[id]));
+    }
+    done[id] = true;
+    for (const Edge& e : edges) {
+      if (e.first == id) {
+        --numPending[e.second];
+      }
+    }
+  }
+
+  // the serial traversal given a cost model replays the priority order
+  std::vector<uint32_t> visited;
+  dag.forEachNode_TopoOrder(IdCost(), [&](typename DAG::NodePtr n) {
+    visited.push_back(dag.nodeData(n));
+  });
+  TEST_CHECK(visited == ids);
+
+  visited.clear();
+  dag.forEachNode_TopoOrderParallel(1, IdCost(), [&](typename DAG::NodePtr n) {
+    visited.push_back(dag.nodeData(n));
+  });
+  TEST_CHECK(visited == ids);
+
+  // in parallel, every node once and after its predecessors
+  std::vector<std::atomic<uint32_t> > stamps(numNodes);
+  for (auto& s : stamps) {
+    s = 0;
+  }
+  std::atomic<uint32_t> clock(0);
+  dag.forEachNode_TopoOrderParallel(4, IdCost(), [&](typename DAG::NodePtr n) {
+    const uint32_t id = dag.nodeData(n);
+    TEST_CHECK(stamps[id].exchange(++clock) == 0);
+  });
+  for (const Edge& e : edges) {
+    TEST_CHECK(stamps[e.first] != 0 && stamps[e.first] < stamps[e.second]);
+  }
+}
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    testPriority<DAG::WithPred>(300, 3, seed);
+    testPriority<DAG::WithSucc>(300, 3, seed);
+    testPriority<DAG::WithPredSucc>(300, 3, seed);
+  }
+  testPriority<DAG::WithPredSucc>(100, 0, 4);
+
+  // a long chain and independent nodes: the chain goes first, one node at a time
+  {
+    DAG::WithPredSucc dag;
+    EdgeVec edges;
+    for (uint32_t i = 11; i < 20; ++i) {
+      edges.emplace_back(i - 1, i);
+    }
+    buildDAG(dag, 20, edges);
+
+    std::vector<double> bl;
+    std::vector<DAG::Index> order;
+    dag.computeBottomLevels(dagee::UniformCostModel(), bl);
+    dag.computePriorityOrder(bl, order);
+    TEST_CHECK(bl[10] == 10.0 && bl[0] == 1.0 && dag.nodeData(dag.frozen().node(order[0])) == 10);
+  }
+
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -0,0 +1,275 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Round-trips DAGbase, IdDAGbase and MixedTaskDag through saveDAG and loadDAG,
+// also through DAGmanager::makeDAGfromFile, and checks
+// that corrupt files are rejected: truncated, with a bad magic, with section
+// offsets out of range or decreasing, or with successors before their node
+
+#include "dagee/DAGserialize.h"
+#include "dagee/IdDAG.h"
+#include "dagee/TaskDAG.h"
+
+#include "dagTestUtil.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <vector>
+
+using namespace dageeTests;
+
+using Bytes = std::vector<uint8_t>;
+
+const char* const SAVED = "serializeTest.dag";
+const char* const TAMPERED = "serializeTestBad.dag";
+
+Bytes readFile(const char* path) {
+  std::ifstream fh(path, std::ios::in | std::ios::binary);
+  return Bytes(std::istreambuf_iterator<char>(fh), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const char* path, const Bytes& bytes) {
+  std::ofstream fh(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  fh.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  TEST_CHECK(fh.good());
+}
+
+template <typename T>
+T& at(Bytes& bytes, uint64_t pos) {
+  TEST_CHECK(pos + sizeof(T) <= bytes.size());
+  return *reinterpret_cast<T*>(bytes.data() + pos);
+}
+
+dagee::DAGfileHeader& header(Bytes& bytes) { return at<dagee::DAGfileHeader>(bytes, 0); }
+
+//! edges by node id, where idOf(dag, node) gives the id
+template <typename DAG, typename I>
+std::set<Edge> edgesOf(DAG& dag, const I& idOf) {
+  dag.freeze();
+  const auto& fz = dag.frozen();
+  std::set<Edge> edges;
+  for (uint32_t i = 0; i < fz.size(); ++i) {
+    for (uint32_t s : fz.successors(i)) {
+      edges.emplace(idOf(dag, fz.node(i)), idOf(dag, fz.node(s)));
+    }
+  }
+  return edges;
+}
+
+struct PlainId {
+  template <typename DAG>
+  uint32_t operator()(DAG& dag, typename DAG::NodePtr n) const {
+    return dag.nodeData(n);
+  }
+};
+
+//! even ids are stored as uint32_t, odd ones as double, see buildMixed
+struct MixedId {
+  template <typename DAG>
+  uint32_t operator()(DAG& dag, typename DAG::NodePtr n) const {
+    if (dag.nodeData(n).template holds<uint32_t>()) {
+      const uint32_t id = dag.template nodeDataAs<uint32_t>(n);
+      TEST_CHECK(id % 2 == 0);
+      return id;
+    }
+    const double d = dag.template nodeDataAs<double>(n);
+    TEST_CHECK(uint32_t(d) % 2 == 1 && d == uint32_t(d) + 0.5);
+    return uint32_t(d);
+  }
+};
+
+template <typename DAG>
+void buildMixed(DAG& dag, uint32_t numNodes, const EdgeVec& edges) {
+  std::vector<typename DAG::NodePtr> nodes;
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    nodes.push_back(i % 2 == 0 ? dag.addNode(i) : dag.addNode(i + 0.5));
+  }
+  for (const Edge& e : edges) {
+    dag.addEdge(nodes[e.first], nodes[e.second]);
+  }
+}
+
+//! save dag, load it back into a new DAG and compare
+template <typename DAG, typename I, typename C>
+void roundTrip(DAG& dag, const I& idOf, const C& codec) {
+  TEST_CHECK(dagee::saveDAG(dag, SAVED, codec));
+
+  DAG loaded;
+  TEST_CHECK(dagee::loadDAG(loaded, SAVED, codec));
+  TEST_CHECK(edgesOf(loaded, idOf) == edgesOf(dag, idOf));
+  TEST_CHECK(loaded.frozen().size() == dag.frozen().size());
+
+  dagee::MappedDAGfile file(SAVED);
+  TEST_CHECK(file.isOpen() && file.numNodes() == dag.frozen().size() &&
+             file.numEdges() == dag.frozen().numEdges());
+}
+
+//! loading the tampered copy of the saved file must fail
+template <typename DAG, typename C>
+void checkRejected(const Bytes& bytes, const C& codec) {
+  writeFile(TAMPERED, bytes);
+  DAG dag;
+  TEST_CHECK(!dagee::loadDAG(dag, TAMPERED, codec));
+}
+
+//! corruptions caught whatever the payload, on a saved DAG with at least one edge
+template <typename DAG, typename C>
+void testRejects(const C& codec) {
+  Bytes good = readFile(SAVED);
+  Bytes bad;
+  const uint64_t N = header(good).mNumNodes;
+  TEST_CHECK(N > 2 && header(good).mNumEdges > 0);
+
+  // truncated, in the header and in the last section
+  checkRejected<DAG>(Bytes(good.cbegin(), good.cbegin() + sizeof(dagee::DAGfileHeader) / 2),
+                     codec);
+  checkRejected<DAG>(Bytes(good.cbegin(), good.cend() - 8), codec);
+  checkRejected<DAG>(Bytes(), codec);
+
+  bad = good;
+  bad[0] ^= 1;
+  checkRejected<DAG>(bad, codec);
+
+  bad = good;
+  header(bad).mVersion += 1;
+  checkRejected<DAG>(bad, codec);
+
+  // sections out of the file, or misaligned
+  bad = good;
+  header(bad).mSuccIndicesPos = bad.size() + 8;
+  checkRejected<DAG>(bad, codec);
+
+  bad = good;
+  header(bad).mPayloadOffsetsPos += 4;
+  checkRejected<DAG>(bad, codec);
+
+  bad = good;
+  header(bad).mNumNodes = uint64_t(1) << 61;
+  checkRejected<DAG>(bad, codec);
+
+  // offsets that run past their section, or decrease
+  bad = good;
+  at<uint64_t>(bad, header(bad).mSuccOffsetsPos + N * 8) += 1;
+  checkRejected<DAG>(bad, codec);
+
+  bad = good;
+  at<uint64_t>(bad, header(bad).mPayloadOffsetsPos + 8) = header(bad).mPayloadBytes + 1;
+  checkRejected<DAG>(bad, codec);
+
+  bad = good;
+  at<uint64_t>(bad, header(bad).mPayloadOffsetsPos + 8) = header(bad).mPayloadBytes;
+  at<uint64_t>(bad, header(bad).mPayloadOffsetsPos + 16) = 0;
+  checkRejected<DAG>(bad, codec);
+
+  bad = good;
+  at<uint64_t>(bad, header(bad).mSuccOffsetsPos + 8) = header(bad).mNumEdges;
+  TEST_CHECK(at<uint64_t>(bad, header(bad).mSuccOffsetsPos + 16) < header(bad).mNumEdges);
+  checkRejected<DAG>(bad, codec);
+
+  // a successor at or before its node, or past the last node
+  const uint64_t* offs = &at<uint64_t>(good, header(good).mSuccOffsetsPos);
+  uint64_t i = 1;
+  while (offs[i] == offs[i + 1]) {
+    ++i;
+    TEST_CHECK(i < N);
+  }
+  for (uint64_t s : {uint64_t(0), i, N}) {
+    bad = good;
+    at<uint32_t>(bad, header(bad).mSuccIndicesPos + offs[i] * 4) = uint32_t(s);
+    checkRejected<DAG>(bad, codec);
+  }
+}
+
+template <typename DAG>
+void testPlain(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  DAG dag;
+  buildDAG(dag, numNodes, edges);
+  roundTrip(dag, PlainId(), dagee::DefaultNodeCodec<DAG>());
+}
+
+//! the same through DAGmanager, which destroys the DAG of a file it can't load
+template <typename DAG>
+void testManager(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  const auto codec = dagee::DefaultNodeCodec<DAG>();
+
+  DAG dag;
+  buildDAG(dag, numNodes, edges);
+  TEST_CHECK(dagee::saveDAG(dag, SAVED, codec));
+
+  dagee::DAGmanager<DAG, dagee::StdAllocatorFactory<> > mgr;
+  DAG* loaded = mgr.makeDAGfromFile(SAVED, codec);
+  TEST_CHECK(loaded && mgr.numLive() == 1);
+  TEST_CHECK(edgesOf(*loaded, PlainId()) == edgesOf(dag, PlainId()));
+
+  Bytes bad = readFile(SAVED);
+  bad[0] ^= 1;
+  writeFile(TAMPERED, bad);
+  TEST_CHECK(mgr.makeDAGfromFile(TAMPERED, codec) == nullptr && mgr.numLive() == 1);
+  mgr.destroyDAG(loaded);
+}
+
+template <typename DAG>
+void testMixed(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  const auto codec =
+      dagee::makeMixedNodeDataCodec(dagee::TrivialCodec<uint32_t>(), dagee::TrivialCodec<double>());
+
+  DAG dag;
+  buildMixed(dag, numNodes, edges);
+  roundTrip(dag, MixedId(), codec);
+  testRejects<DAG>(codec);
+
+  // a type id past the last type, and a payload of the wrong size for its type
+  const Bytes good = readFile(SAVED);
+  Bytes bad = good;
+  bad[header(bad).mPayloadPos] = 2;
+  checkRejected<DAG>(bad, codec);
+
+  bad = good;
+  const uint64_t firstSize = at<uint64_t>(bad, header(bad).mPayloadOffsetsPos + 8);
+  at<uint64_t>(bad, header(bad).mPayloadOffsetsPos + 8) = firstSize - 1;
+  checkRejected<DAG>(bad, codec);
+}
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+  using IdDAG = dagee::IdDAGbase<uint32_t>;
+  using Mixed = dagee::MixedTaskDag<dagee::StdAllocatorFactory<>, true, true, uint32_t, double>;
+
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    testPlain<DAG::WithPred>(500, 3, seed);
+    testPlain<DAG::WithSucc>(500, 3, seed);
+    testPlain<DAG::WithPredSucc>(500, 3, seed);
+    testRejects<DAG::WithPredSucc>(dagee::DefaultNodeCodec<DAG::WithPredSucc>());
+
+    // node 0 is a valid node id, not a failure to decode
+    testPlain<IdDAG::WithPred>(500, 3, seed);
+    testPlain<IdDAG::WithSucc>(500, 3, seed);
+    testPlain<IdDAG::WithPredSucc>(500, 3, seed);
+    testRejects<IdDAG::WithPredSucc>(dagee::DefaultNodeCodec<IdDAG::WithPredSucc>());
+
+    testManager<DAG::WithPredSucc>(200, 3, seed);
+    testManager<IdDAG::WithSucc>(200, 3, seed);
+
+    testMixed<Mixed>(500, 3, seed);
+    testMixed<Mixed::WithSucc>(500, 3, seed);
+  }
+
+  // no nodes at all, and a single node, i.e., id 0
+  {
+    DAG::WithPredSucc empty;
+    roundTrip(empty, PlainId(), dagee::DefaultNodeCodec<DAG::WithPredSucc>());
+    IdDAG single;
+    single.addNode(7u);
+    roundTrip(single, PlainId(), dagee::DefaultNodeCodec<IdDAG>());
+  }
+
+  std::remove(SAVED);
+  std::remove(TAMPERED);
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -0,0 +1,172 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks SmallVec against std::vector under random operations, that it
+// allocates only past its inline capacity, and copy, move and swap across
+// inline and heap storage
+
+#include "dagee/ArenaAllocFactory.h"
+#include "dagee/SmallVec.h"
+
+#include "dagTestUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace dageeTests;
+
+//! std::allocator that counts the buffers it has handed out and not taken back
+template <typename T>
+struct CountingAlloc : public std::allocator<T> {
+  static int sNumLive;
+
+  template <typename U>
+  struct rebind {
+    using other = CountingAlloc<U>;
+  };
+
+  CountingAlloc(void) = default;
+  template <typename U>
+  CountingAlloc(const CountingAlloc<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    ++sNumLive;
+    return std::allocator<T>::allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    --sNumLive;
+    std::allocator<T>::deallocate(p, n);
+  }
+};
+template <typename T>
+int CountingAlloc<T>::sNumLive = 0;
+
+constexpr size_t N = 4;
+using Vec = dagee::SmallVec<uint32_t, N, CountingAlloc<uint32_t> >;
+using Model = std::vector<uint32_t>;
+
+void checkSame(const Vec& v, const Model& m) {
+  TEST_CHECK(v.size() == m.size() && v.empty() == m.empty());
+  TEST_CHECK(std::equal(m.cbegin(), m.cend(), v.cbegin()));
+  TEST_CHECK(v.capacity() >= v.size() && v.capacity() >= N);
+}
+
+void testInline(void) {
+  {
+    Vec v;
+    for (uint32_t i = 0; i < N; ++i) {
+      v.push_back(i);
+    }
+    TEST_CHECK(CountingAlloc<uint32_t>::sNumLive == 0 && v.capacity() == N);
+
+    v.push_back(N);
+    TEST_CHECK(CountingAlloc<uint32_t>::sNumLive == 1 && v.size() == N + 1);
+
+    // clear keeps the heap buffer, as std::vector does
+    v.clear();
+    TEST_CHECK(v.empty() && CountingAlloc<uint32_t>::sNumLive == 1);
+  }
+  TEST_CHECK(CountingAlloc<uint32_t>::sNumLive == 0);
+}
+
+void testRandomOps(unsigned seed) {
+  std::mt19937 rng(seed);
+  Vec v;
+  Model m;
+
+  for (int step = 0; step < 20000; ++step) {
+    const unsigned op = rng() % 10;
+    if (op < 5 || m.empty()) {
+      uint32_t x = rng();
+      v.push_back(x);
+      m.push_back(x);
+    } else if (op < 7) {
+      size_t k = rng() % m.size();
+      v.erase(v.cbegin() + k);
+      m.erase(m.cbegin() + k);
+    } else if (op == 7) {
+      v.pop_back();
+      m.pop_back();
+    } else if (op == 8) {
+      // copy, then move back, through inline or heap storage depending on the size
+      Vec c(v);
+      checkSame(c, m);
+      Vec moved(std::move(c));
+      TEST_CHECK(c.empty());
+      v = std::move(moved);
+    } else if (m.size() > 3 * N) {
+      v.clear();
+      m.clear();
+    }
+    checkSame(v, m);
+  }
+}
+
+void testCopySwap(void) {
+  Vec small;
+  Vec large;
+  Model smallM = {1, 2};
+  Model largeM;
+  for (uint32_t x : smallM) {
+    small.push_back(x);
+  }
+  for (uint32_t i = 0; i < 3 * N; ++i) {
+    large.push_back(100 + i);
+    largeM.push_back(100 + i);
+  }
+
+  small.swap(large);
+  checkSame(small, largeM);
+  checkSame(large, smallM);
+
+  Vec copy;
+  copy = small;
+  checkSame(copy, largeM);
+  copy = large;
+  checkSame(copy, smallM);
+
+  copy.reserve(10 * N);
+  TEST_CHECK(copy.capacity() >= 10 * N);
+  checkSame(copy, smallM);
+}
+
+//! move assignment between different arenas copies instead of stealing
+void testArenaMove(void) {
+  using ArenaVec = dagee::SmallVec<uint32_t, N, dagee::ArenaAllocator<uint32_t> >;
+  dagee::MonotonicArena a0;
+  dagee::MonotonicArena a1;
+
+  ArenaVec v0{dagee::ArenaAllocator<uint32_t>(a0)};
+  ArenaVec v1{dagee::ArenaAllocator<uint32_t>(a1)};
+  Model m;
+  for (uint32_t i = 0; i < 3 * N; ++i) {
+    v0.push_back(i);
+    m.push_back(i);
+  }
+
+  const uint32_t* heap0 = v0.data();
+  v1 = std::move(v0);
+  TEST_CHECK(v1.data() != heap0 && v1.get_allocator().mArena == &a1);
+  TEST_CHECK(v0.empty() && v1.size() == m.size() && std::equal(m.cbegin(), m.cend(), v1.cbegin()));
+
+  ArenaVec v2{dagee::ArenaAllocator<uint32_t>(a1)};
+  const uint32_t* heap1 = v1.data();
+  v2 = std::move(v1);
+  TEST_CHECK(v2.data() == heap1 && v1.empty());
+}
+
+int main(int, char**) {
+  testInline();
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    testRandomOps(seed);
+  }
+  testCopySwap();
+  TEST_CHECK(CountingAlloc<uint32_t>::sNumLive == 0);
+  testArenaMove();
+
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks DAGbase::transitiveReduce against a brute-force reduction on random
+// DAGs, how it interacts with the cached frozen snapshot, and that a reduced
+// DAG executed by DAGexecutor still respects every original dependency
+
+#include "dagee/ArenaAllocFactory.h"
+#include "dagee/DAGexecutor.h"
+#include "dagee/TaskDAG.h"
+#include "dagee/ThreadPoolExecutor.h"
+
+#include "dagTestUtil.h"
+
+#include <atomic>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+using namespace dageeTests;
+
+/**
+ * Edges not implied by a longer path: (a, b) is redundant if another
+ * successor of a reaches b. Reachability by DFS from every node
+ */
+EdgeVec bruteForceReduce(uint32_t numNodes, const EdgeVec& edges) {
+  std::vector<std::vector<uint32_t> > succs(numNodes);
+  for (const Edge& e : edges) {
+    succs[e.first].push_back(e.second);
+  }
+
+  std::vector<std::vector<bool> > reach(numNodes, std::vector<bool>(numNodes, false));
+  for (uint32_t s = 0; s < numNodes; ++s) {
+    std::vector<uint32_t> stack(succs[s]);
+    while (!stack.empty()) {
+      uint32_t n = stack.back();
+      stack.pop_back();
+      if (!reach[s][n]) {
+        reach[s][n] = true;
+        stack.insert(stack.end(), succs[n].cbegin(), succs[n].cend());
+      }
+    }
+  }
+
+  EdgeVec kept;
+  for (const Edge& e : edges) {
+    bool redundant = false;
+    for (uint32_t c : succs[e.first]) {
+      if (c != e.second && reach[c][e.second]) {
+        redundant = true;
+        break;
+      }
+    }
+    if (!redundant) {
+      kept.push_back(e);
+    }
+  }
+  return kept;
+}
+
+//! edges of dag by node data, read through its frozen snapshot
+template <typename DAG>
+std::set<Edge> edgesOf(DAG& dag) {
+  dag.freeze();
+  const auto& fz = dag.frozen();
+  std::set<Edge> edges;
+  for (uint32_t i = 0; i < fz.size(); ++i) {
+    for (uint32_t s : fz.successors(i)) {
+      edges.emplace(dag.nodeData(fz.node(i)), dag.nodeData(fz.node(s)));
+    }
+  }
+  return edges;
+}
+
+template <typename DAG>
+void testReduce(uint32_t numNodes, uint32_t maxPreds, unsigned seed, bool freezeFirst) {
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  const EdgeVec expected = bruteForceReduce(numNodes, edges);
+
+  DAG dag;
+  auto nodes = buildDAG(dag, numNodes, edges);
+
+  if (freezeFirst) {
+    dag.freeze();
+  }
+  TEST_CHECK(!dag.isReduced());
+  const size_t numRemoved = dag.transitiveReduce();
+  TEST_CHECK(numRemoved == edges.size() - expected.size());
+  TEST_CHECK(dag.isReduced());
+
+  // a snapshot taken before is rebuilt with the reduced edges, none is taken otherwise
+  TEST_CHECK(dag.isFrozen() == freezeFirst);
+  if (freezeFirst) {
+    TEST_CHECK(dag.frozen().numEdges() == expected.size());
+  }
+
+  // cached: freezing afterwards keeps the DAG reduced, and reducing again is a no-op
+  TEST_CHECK(edgesOf(dag) == std::set<Edge>(expected.cbegin(), expected.cend()));
+  TEST_CHECK(dag.isReduced() && dag.isFrozen());
+  TEST_CHECK(dag.transitiveReduce() == 0);
+
+  std::vector<uint32_t> order;
+  dag.forEachNode_TopoOrder([&](typename DAG::NodePtr n) { order.push_back(dag.nodeData(n)); });
+  checkTopoOrder(numNodes, edges, order);
+
+  // any modification drops the reduced state. Adding back a removed edge must be undone again
+  std::set<Edge> keptSet(expected.cbegin(), expected.cend());
+  for (const Edge& r : edges) {
+    if (keptSet.count(r) == 0) {
+      dag.addEdge(nodes[r.first], nodes[r.second]);
+      TEST_CHECK(!dag.isReduced() && !dag.isFrozen());
+      TEST_CHECK(dag.transitiveReduce() == 1);
+      TEST_CHECK(edgesOf(dag) == keptSet);
+      break;
+    }
+  }
+}
+
+/**
+ * A chain a0 -> a1 -> ... with every shortcut ai -> aj added too, executed with
+ * and without reduction: only the chain edges are needed, and tasks must still
+ * run in chain order
+ */
+void testExecutor(void) {
+  constexpr uint32_t N = 24;
+
+  dagee::ThreadPoolExecutor poolEx(4);
+  using DAGexec = dagee::DAGexecutor<dagee::ThreadPoolExecutor>;
+  DAGexec dagEx(poolEx);
+
+  for (bool reduce : {false, true}) {
+    dagEx.enableTransitiveReduction(reduce);
+
+    std::atomic<uint32_t> numDone(0);
+    std::atomic<bool> failed(false);
+
+    auto* dag = dagEx.makeDAG();
+    std::vector<DAGexec::NodePtr> nodes;
+    for (uint32_t i = 0; i < N; ++i) {
+      nodes.push_back(dag->addNode(poolEx.makeTask([&numDone, &failed, i] {
+        if (numDone.load() != i) {
+          failed = true;
+        }
+        ++numDone;
+      })));
+    }
+    for (uint32_t i = 0; i < N; ++i) {
+      for (uint32_t j = i + 1; j < N; ++j) {
+        dag->addEdge(nodes[i], nodes[j]);
+      }
+    }
+
+    dagEx.execute(dag);
+    TEST_CHECK(numDone.load() == N && !failed);
+    TEST_CHECK(dag->isReduced() == reduce);
+    TEST_CHECK(dag->frozen().numEdges() == (reduce ? N - 1 : N * (N - 1) / 2));
+    dagEx.destroyDAG(dag);
+  }
+}
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+  using ArenaDAG = dagee::DAGbase<uint32_t, dagee::ArenaAllocatorFactory<> >;
+
+  for (unsigned seed = 1; seed <= 6; ++seed) {
+    // dense enough for plenty of redundant edges, sparse for few
+    const uint32_t maxPreds = seed % 2 ? 8 : 2;
+    for (bool freezeFirst : {false, true}) {
+      testReduce<DAG::WithPred>(300, maxPreds, seed, freezeFirst);
+      testReduce<DAG::WithSucc>(300, maxPreds, seed, freezeFirst);
+      testReduce<DAG::WithPredSucc>(300, maxPreds, seed, freezeFirst);
+      testReduce<ArenaDAG::WithPredSucc>(300, maxPreds, seed, freezeFirst);
+    }
+  }
+
+  testExecutor();
+
+  std::printf("PASSED!\n");
+  return 0;
+}
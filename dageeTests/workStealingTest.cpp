@@ -0,0 +1,177 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+// Checks WorkStealingDeque under concurrent thieves, and that
+// forEachNode_TopoOrderParallel visits every node once, after all its
+// predecessors, for push, pull and frozen DAGs
+
+#include "dagee/TaskDAG.h"
+#include "dagee/WorkStealing.h"
+
+#include "dagTestUtil.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dageeTests;
+
+constexpr unsigned NUM_THREADS = 4;
+
+//! the owner pushes and takes while thieves steal; every item must come out exactly once
+void testDeque(void) {
+  constexpr uint32_t NUM_ITEMS = 100000;
+
+  // small, to make the owner grow the buffer under the thieves
+  dagee::WorkStealingDeque<uint32_t> deq(4);
+  std::unique_ptr<std::atomic<uint32_t>[]> seen(new std::atomic<uint32_t>[NUM_ITEMS]);
+  for (uint32_t i = 0; i < NUM_ITEMS; ++i) {
+    seen[i] = 0;
+  }
+  std::atomic<uint32_t> numSeen(0);
+
+  std::vector<std::thread> thieves;
+  for (unsigned t = 1; t < NUM_THREADS; ++t) {
+    thieves.emplace_back([&] {
+      uint32_t x;
+      while (numSeen.load() < NUM_ITEMS) {
+        if (deq.steal(x)) {
+          seen[x].fetch_add(1);
+          numSeen.fetch_add(1);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint32_t x;
+  for (uint32_t i = 0; i < NUM_ITEMS; ++i) {
+    deq.push(i);
+    if (i % 3 == 0 && deq.take(x)) {
+      seen[x].fetch_add(1);
+      numSeen.fetch_add(1);
+    }
+  }
+  while (deq.take(x)) {
+    seen[x].fetch_add(1);
+    numSeen.fetch_add(1);
+  }
+
+  for (auto& t : thieves) {
+    t.join();
+  }
+
+  TEST_CHECK(numSeen.load() == NUM_ITEMS && deq.empty());
+  for (uint32_t i = 0; i < NUM_ITEMS; ++i) {
+    TEST_CHECK(seen[i].load() == 1);
+  }
+}
+
+/**
+ * Each visit checks that the predecessors of the node were visited before, and
+ * counts the visits
+ */
+struct VisitChecker {
+  std::vector<std::vector<uint32_t> > mPreds;
+  std::unique_ptr<std::atomic<uint32_t>[]> mVisits;
+  std::atomic<bool> mFailed;
+
+  VisitChecker(uint32_t numNodes, const EdgeVec& edges)
+      : mPreds(numNodes), mVisits(new std::atomic<uint32_t>[numNodes]), mFailed(false) {
+    for (const Edge& e : edges) {
+      mPreds[e.second].push_back(e.first);
+    }
+    reset();
+  }
+
+  void reset(void) {
+    for (size_t i = 0; i < mPreds.size(); ++i) {
+      mVisits[i] = 0;
+    }
+  }
+
+  void visit(uint32_t n) {
+    for (uint32_t p : mPreds[n]) {
+      if (mVisits[p].load(std::memory_order_acquire) == 0) {
+        std::printf("Failed: node %u visited before its predecessor %u\n", n, p);
+        mFailed = true;
+      }
+    }
+    mVisits[n].fetch_add(1, std::memory_order_release);
+  }
+
+  void check(uint32_t expected) {
+    TEST_CHECK(!mFailed);
+    for (size_t i = 0; i < mPreds.size(); ++i) {
+      TEST_CHECK(mVisits[i].load() == expected);
+    }
+  }
+};
+
+template <typename DAG>
+void testParallel(uint32_t numNodes, uint32_t maxPreds, unsigned seed) {
+  const EdgeVec edges = randomEdges(numNodes, maxPreds, seed);
+  DAG dag;
+  buildDAG(dag, numNodes, edges);
+
+  VisitChecker checker(numNodes, edges);
+  auto visit = [&](typename DAG::NodePtr n) { checker.visit(dag.nodeData(n)); };
+
+  // twice, since a traversal must leave the DAG ready for the next one
+  for (int r = 0; r < 2; ++r) {
+    dag.forEachNode_TopoOrderParallel(NUM_THREADS, visit);
+    checker.check(1);
+    checker.reset();
+  }
+
+  dag.freeze();
+  dag.forEachNode_TopoOrderParallel(NUM_THREADS, visit);
+  checker.check(1);
+}
+
+#ifdef NDEBUG
+/**
+ * Only without asserts, which catch the cycle: the traversal must still return,
+ * visiting only the nodes that don't depend on the cycle
+ */
+template <typename DAG>
+void testCycle(void) {
+  DAG dag;
+  auto a = dag.addNode(0u);
+  auto b = dag.addNode(1u);
+  auto c = dag.addNode(2u);
+  auto d = dag.addNode(3u);
+  dag.addEdge(a, b);
+  dag.addEdge(b, c);
+  dag.addEdge(c, b);
+  dag.addEdge(c, d);
+
+  std::atomic<uint32_t> numVisits(0);
+  dag.forEachNode_TopoOrderParallel(NUM_THREADS, [&](typename DAG::NodePtr) { ++numVisits; });
+  TEST_CHECK(numVisits.load() == 1);
+}
+#endif
+
+int main(int, char**) {
+  using DAG = dagee::DAGbase<uint32_t>;
+
+  testDeque();
+
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    testParallel<DAG::WithPred>(2000, 4, seed);
+    testParallel<DAG::WithSucc>(2000, 4, seed);
+    testParallel<DAG::WithPredSucc>(2000, 4, seed);
+  }
+  // wide: all sources
+  testParallel<DAG::WithPredSucc>(2000, 0, 4);
+
+#ifdef NDEBUG
+  testCycle<DAG::WithPred>();
+  testCycle<DAG::WithSucc>();
+#endif
+
+  std::printf("PASSED!\n");
+  return 0;
+}
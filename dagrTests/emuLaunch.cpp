@@ -0,0 +1,296 @@
+// Runs the dagr executors on the HSA emulator (dagr/hsaEmu.h), with host
+// functions for kernels. Checks that tasks run once each and after their
+// predecessors
+
+#include "dagr/dagExecutor.h"
+#include "dagr/executor.h"
+
+#include "dagee/CostModel.h"
+#include "dagee/TaskDAG.h"
+
+#include "cpputils/CmdLine.h"
+#include "cpputils/Timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifndef DAGR_EMULATE_HSA
+#error "emuLaunch needs DAGR_EMULATE_HSA"
+#endif
+
+struct NodeRecord {
+  std::vector<uint32_t> mPreds;
+  std::atomic<uint32_t> mRuns;
+};
+
+std::atomic<bool> gFailed(false);
+
+void visitKern(NodeRecord* recs, uint32_t id) {
+  for (uint32_t p : recs[id].mPreds) {
+    if (recs[p].mRuns.load() == 0) {
+      std::printf("Failed: task %u ran before its predecessor %u\n", id, p);
+      gFailed = true;
+    }
+  }
+  recs[id].mRuns.fetch_add(1);
+}
+
+void orderedKern(uint32_t* counter, uint32_t expected) {
+  if (*counter != expected) {
+    std::printf("Failed: ordered task %u ran after %u tasks\n", expected, *counter);
+    gFailed = true;
+  }
+  ++*counter;
+}
+
+void checkRuns(std::vector<NodeRecord>& recs, uint32_t expected) {
+  for (size_t i = 0; i < recs.size(); ++i) {
+    if (recs[i].mRuns.load() != expected) {
+      std::printf("Failed: task %zu ran %u times instead of %u\n", i, recs[i].mRuns.load(),
+                  expected);
+      gFailed = true;
+    }
+    recs[i].mRuns = 0;
+  }
+}
+
+int main(int argc, char** argv) {
+  namespace cl = cpputils::cmdline;
+
+  cl::Option<size_t> numTasksOpt('n', "Number of Tasks to launch", 1024);
+  cl::Option<size_t> numLevelsOpt('l', "Number of levels in tree", 6ul);
+  cl::Option<size_t> numThreadsOpt('t', "Number of host threads sharing an executor", 8ul);
+  cl::Parser parser({&numTasksOpt, &numLevelsOpt, &numThreadsOpt});
+  parser.parse(argc, argv);
+
+  dagr::RuntimeState S;
+  dagr::GpuExecutionResource er(S.gpuAgent(0));
+
+  auto* kinfoVisit = er.kernInfoState().registerKernel<NodeRecord*, uint32_t>(&visitKern);
+  auto* kinfoOrdered = er.kernInfoState().registerKernel<uint32_t*, uint32_t>(&orderedKern);
+
+  dagr::SerialOrderedExecutor ordExec(&er);
+  dagr::SerialUnorderedExecutor unordExec(&er, 4ul);
+
+  // ordered launch
+  {
+    uint32_t counter = 0;
+    auto batchState = ordExec.startBatch();
+    for (uint32_t i = 0; i + 1 < numTasksOpt; ++i) {
+      ordExec.addToBatch(batchState, ordExec.makeTask(dim3(1), dim3(1), kinfoOrdered, &counter, i));
+    }
+    auto th = ordExec.finishBatch(
+        batchState,
+        ordExec.makeTask(dim3(1), dim3(1), kinfoOrdered, &counter, uint32_t(numTasksOpt - 1)));
+    ordExec.waitOnTask(th);
+
+    if (counter != numTasksOpt) {
+      std::printf("Failed: %u of %zu ordered tasks ran\n", counter, size_t(numTasksOpt));
+      gFailed = true;
+    }
+  }
+
+  // unordered batch of independent tasks
+  {
+    std::vector<NodeRecord> recs(numTasksOpt);
+    auto batchState = unordExec.startBatch();
+    for (uint32_t i = 0; i < numTasksOpt; ++i) {
+      unordExec.addToBatch(batchState,
+                           unordExec.makeTask(dim3(1), dim3(1), kinfoVisit, recs.data(), i));
+    }
+    unordExec.waitOnTask(unordExec.launchBatch(batchState));
+    checkRuns(recs, 1);
+  }
+
+  // batches over more queues than a barrier packet has dependencies, joined by a tree
+  {
+    dagr::SerialUnorderedExecutor wideExec(&er, 27ul);
+    std::vector<NodeRecord> recs(numTasksOpt);
+
+    // repeated, to reuse the recycled signals of the tree
+    for (int r = 0; r < 3; ++r) {
+      auto batchState = wideExec.startBatch();
+      for (uint32_t i = 0; i < numTasksOpt; ++i) {
+        wideExec.addToBatch(batchState,
+                            wideExec.makeTask(dim3(1), dim3(1), kinfoVisit, recs.data(), i));
+      }
+      wideExec.waitOnTask(wideExec.launchBatch(batchState));
+      checkRuns(recs, 1);
+    }
+  }
+
+  // single launches sharing doorbells
+  {
+    const size_t maxPackets = 32ul;
+    std::vector<NodeRecord> recs(numTasksOpt);
+    std::vector<dagr::TaskHandle> handles;
+
+    // no time window, so that the count of doorbells is exact
+    unordExec.setSubmitPolicy(
+        dagr::SubmitPolicy::coalesce(maxPackets, 0ul, std::chrono::nanoseconds(0)));
+    auto before = unordExec.submitStats();
+
+    for (uint32_t i = 0; i < numTasksOpt; ++i) {
+      handles.emplace_back(
+          unordExec.launchTask(unordExec.makeTask(dim3(1), dim3(1), kinfoVisit, recs.data(), i)));
+    }
+    // the first wait submits what is still pending
+    for (const auto& th : handles) {
+      unordExec.waitOnTask(th);
+    }
+
+    auto after = unordExec.submitStats();
+    unordExec.setSubmitPolicy(dagr::SubmitPolicy::eager());
+
+    const size_t doorbells = after.mDoorbells - before.mDoorbells;
+    std::printf("Coalesced launch: %zu packets, %zu doorbells\n",
+                size_t(after.mPackets - before.mPackets), doorbells);
+    if (doorbells > numTasksOpt / maxPackets + 4ul) {
+      std::printf("Failed: %zu doorbells for %zu tasks\n", doorbells, size_t(numTasksOpt));
+      gFailed = true;
+    }
+    checkRuns(recs, 1);
+  }
+
+  // many host threads sharing one executor, each launching single tasks and a batch
+  {
+    dagr::ConcurrentExecutor concExec(&er, 2ul);
+
+    const uint32_t numThreads = numThreadsOpt;
+    const uint32_t perThread = numTasksOpt;
+    std::vector<NodeRecord> recs(numThreads * perThread);
+
+    auto submitter = [&](uint32_t t) {
+      const uint32_t beg = t * perThread;
+      const uint32_t mid = beg + perThread / 2;
+
+      for (uint32_t i = beg; i < mid; ++i) {
+        auto th =
+            concExec.launchTask(concExec.makeTask(dim3(1), dim3(1), kinfoVisit, recs.data(), i));
+        concExec.waitOnTask(th);
+        concExec.releaseTask(th);
+      }
+
+      auto batchState = concExec.startBatch();
+      for (uint32_t i = mid; i < beg + perThread; ++i) {
+        concExec.addToBatch(batchState,
+                            concExec.makeTask(dim3(1), dim3(1), kinfoVisit, recs.data(), i));
+      }
+      concExec.waitOnTask(concExec.launchBatch(batchState));
+    };
+
+    cpputils::Timer t0("Concurrent", "Launch From Many Threads", true);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back(submitter, t);
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    t0.stop();
+    checkRuns(recs, 1);
+  }
+
+  // binary tree DAG, root first
+  {
+    using TaskDag = dagee::DAGbase<dagr::GpuKernInstance>::WithSucc;
+    TaskDag dag;
+
+    const uint32_t numNodes = (1u << numLevelsOpt) - 1u;
+    std::vector<NodeRecord> recs(numNodes);
+    std::vector<TaskDag::NodePtr> nodes;
+
+    for (uint32_t i = 0; i < numNodes; ++i) {
+      nodes.emplace_back(
+          dag.addNode(unordExec.makeTask(dim3(1), dim3(1), kinfoVisit, recs.data(), i)));
+      if (i > 0) {
+        recs[i].mPreds.emplace_back((i - 1) / 2);
+        dag.addEdge(nodes[(i - 1) / 2], nodes[i]);
+      }
+    }
+
+    dagr::StaticDAGExecutorBFS dagExec{&unordExec};
+
+    cpputils::Timer t0("DAG", "Execute From Host", true);
+    dagExec.executeFromHost(&dag);
+    t0.stop();
+    checkRuns(recs, 1);
+
+    cpputils::Timer t1("DAG", "Execute From CP", true);
+    dagExec.executeFromCP(&dag);
+    t1.stop();
+    checkRuns(recs, 1);
+
+    // levels dispatched critical path first
+    dagExec.executeFromHost(&dag, dagee::UniformCostModel());
+    checkRuns(recs, 1);
+    dagExec.executeFromCP(&dag, dagee::UniformCostModel());
+    checkRuns(recs, 1);
+    dagExec.executeFusedFromCP(&dag, dagee::UniformCostModel());
+    checkRuns(recs, 1);
+  }
+
+  // random DAG with wide joins, as dataflow on the CP
+  {
+    using TaskDag = dagee::DAGbase<dagr::GpuKernInstance>::WithSucc;
+    TaskDag dag;
+
+    const uint32_t numNodes = numTasksOpt;
+    const uint32_t joinWidth = 40u;
+    std::vector<NodeRecord> recs(numNodes);
+    std::vector<TaskDag::NodePtr> nodes;
+    std::srand(0);
+
+    auto addPred = [&](uint32_t p, uint32_t i) {
+      auto& preds = recs[i].mPreds;
+      if (std::find(preds.begin(), preds.end(), p) == preds.end()) {
+        preds.emplace_back(p);
+        dag.addEdge(nodes[p], nodes[i]);
+      }
+    };
+
+    for (uint32_t i = 0; i < numNodes; ++i) {
+      nodes.emplace_back(
+          dag.addNode(unordExec.makeTask(dim3(1), dim3(1), kinfoVisit, recs.data(), i)));
+
+      // every 64th task joins the tasks before it, the others depend on up to 2 earlier ones
+      if (i % 64u == 63u) {
+        for (uint32_t p = i - joinWidth; p < i; ++p) {
+          addPred(p, i);
+        }
+      } else {
+        for (int k = 0; k < 2 && i > 0; ++k) {
+          if (std::rand() % 2 == 0) {
+            addPred(uint32_t(std::rand()) % i, i);
+          }
+        }
+      }
+    }
+
+    // with more queues than a barrier packet has dependencies, joins need trees
+    dagr::SerialUnorderedExecutor wideExec(&er, 12ul);
+
+    for (auto* exec : {&unordExec, &wideExec}) {
+      dagr::StaticDAGExecutorDataflow dfExec{exec};
+
+      // twice, to reuse the signals returned by the first run
+      for (int r = 0; r < 2; ++r) {
+        cpputils::Timer t0("DAG", "Dataflow From CP", true);
+        dfExec.executeFromCP(&dag);
+        t0.stop();
+        checkRuns(recs, 1);
+      }
+    }
+  }
+
+  if (gFailed) {
+    return EXIT_FAILURE;
+  }
+  std::printf("PASSED!\n");
+  return 0;
+}
@@ -9,16 +9,39 @@
 #include "cpputils/Timer.h"
 
 #include <cassert>
+#include <cstdio>
 
 #include <iostream>
 #include <thread>
+#include <utility>
 
+//! a tree node is a chain of chainLen tasks. @return head and tail of the chain
 template <typename DAG, typename MakeTaskFunc>
-void cojoinedTreeDag(DAG* dag, MakeTaskFunc&& makeTaskFunc, size_t levels, size_t degree) {
+std::pair<typename DAG::NodePtr, typename DAG::NodePtr> addTreeNode(
+    DAG* dag, MakeTaskFunc& makeTaskFunc, size_t chainLen, size_t& numNodes, size_t& numEdges) {
+  auto head = dag->addNode(makeTaskFunc());
+  ++numNodes;
+
+  auto tail = head;
+  for (size_t c = 1; c < chainLen; ++c) {
+    auto n = dag->addNode(makeTaskFunc());
+    ++numNodes;
+    dag->addEdge(tail, n);
+    ++numEdges;
+    tail = n;
+  }
+
+  return std::make_pair(head, tail);
+}
+
+template <typename DAG, typename MakeTaskFunc>
+void cojoinedTreeDag(DAG* dag, MakeTaskFunc&& makeTaskFunc, size_t levels, size_t degree,
+                     size_t chainLen) {
   assert(dag);
+  assert(chainLen > 0);
 
   using NodePtr = typename DAG::NodePtr;
-  using NodeVec = std::vector<NodePtr>;
+  using NodeVec = std::vector<std::pair<NodePtr, NodePtr> >;
 
   NodeVec currVec;
   NodeVec nextVec;
@@ -28,18 +51,16 @@ void cojoinedTreeDag(DAG* dag, MakeTaskFunc&& makeTaskFunc, size_t levels, size_
   size_t numNodes = 0ul;
   size_t numEdges = 0ul;
 
-  auto root = dag->addNode(makeTaskFunc());
-  ++numNodes;
+  auto root = addTreeNode(dag, makeTaskFunc, chainLen, numNodes, numEdges);
   curr->emplace_back(root);
 
   // create expanding tree, where every node has `degree` number of children
   for (size_t i = 0; i < levels; ++i) {
     assert(next->empty());
-    for (auto* n : *curr) {
+    for (const auto& n : *curr) {
       for (size_t d = 0; d < degree; ++d) {
-        auto* child = dag->addNode(makeTaskFunc());
-        ++numNodes;
-        dag->addEdge(n, child);
+        auto child = addTreeNode(dag, makeTaskFunc, chainLen, numNodes, numEdges);
+        dag->addEdge(n.second, child.first);
         ++numEdges;
         next->emplace_back(child);
       }
@@ -56,17 +77,15 @@ void cojoinedTreeDag(DAG* dag, MakeTaskFunc&& makeTaskFunc, size_t levels, size_
     assert(next->empty());
 
     for (size_t c = 0; c < nextLevelSz; ++c) {
-      auto* node = dag->addNode(makeTaskFunc());
-      ++numNodes;
-      next->emplace_back(node);
+      next->emplace_back(addTreeNode(dag, makeTaskFunc, chainLen, numNodes, numEdges));
     }
 
     size_t nextIndex = 0ul;
     size_t counter = 0ul;
 
-    for (auto* node : *curr) {
+    for (const auto& node : *curr) {
       assert(nextIndex < next->size());
-      dag->addEdge(node, (*next)[nextIndex]);
+      dag->addEdge(node.second, (*next)[nextIndex].first);
       ++numEdges;
       ++counter;
 
@@ -87,7 +106,8 @@ int main(int argc, char** argv) {
 
   cl::Option<size_t> numLevelsOpt('l', "Number of levels in tree", 10ul);
   cl::Option<size_t> degreeOpt('d', "Degree of each node", 2ul);
-  cl::Parser parser({&numLevelsOpt, &degreeOpt});
+  cl::Option<size_t> chainLenOpt('c', "Length of the chain of tasks making up each node", 1ul);
+  cl::Parser parser({&numLevelsOpt, &degreeOpt, &chainLenOpt});
   parser.parse(argc, argv);
 
   dagr::RuntimeState S;
@@ -105,7 +125,7 @@ int main(int argc, char** argv) {
   TaskDag dag;
 
   cojoinedTreeDag(&dag, [&]() { return unordExec.makeTask(dim3(1), dim3(1), kinfoNoWork); },
-                  size_t(numLevelsOpt), size_t(degreeOpt));
+                  size_t(numLevelsOpt), size_t(degreeOpt), size_t(chainLenOpt));
 
   constexpr static const size_t NUM_REP = 10ul;
 
@@ -121,5 +141,21 @@ int main(int argc, char** argv) {
     t1.stop();
   }
 
+  const auto& chains = dag.computeChains();
+  std::printf("Chains: numChains = %u, maxLength = %zu, fused edges = %zu\n", chains.numChains(),
+              chains.maxLength(), chains.numFused());
+
+  for (size_t i = 0; i < NUM_REP; ++i) {
+    cpputils::Timer t2("DAG", "Execute Fused From Host", true);
+    dagExec.executeFusedFromHost(&dag);
+    t2.stop();
+  }
+
+  for (size_t i = 0; i < NUM_REP; ++i) {
+    cpputils::Timer t3("DAG", "Execute Fused From CP", true);
+    dagExec.executeFusedFromCP(&dag);
+    t3.stop();
+  }
+
   return 0;
 }
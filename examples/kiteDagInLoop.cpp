@@ -53,20 +53,30 @@ int main(int argc, char* argv[]) {
   dag->addEdge(leftTask, bottomTask);
   dag->addEdge(rightTask, bottomTask);
 
-  for (int i = 0; i < NUM_ITERATIONS; ++i) {
-    dagEx.execute(dag);
-  }
-
-  std::cout << "info: copy Device2Host\n";
-  bufMgr.copyToHost(A, A_d);
+  // the same DAG is executed repeatedly, so instantiate it once and relaunch it
+  auto execDag = dagEx.instantiate(dag);
 
-  std::cout << "info: check result\n";
   bool passed = true;
 
-  for (size_t i = 0; i < N; i++) {
-    // std::printf("A[%zd] == %u\n", i, A[i]);
-    if (A[i] != FINAL_VAL) {
-      passed = false;
+  for (size_t i = 0; i < NUM_ITERATIONS; ++i) {
+    // patch the add value of the left task in place and check that each launch
+    // picks up the new value
+    const uint32_t leftVal = LEFT_ADD_VAL + static_cast<uint32_t>(i);
+    execDag.setArg(leftTask, 3, leftVal);
+
+    dagEx.launch(execDag);
+
+    std::cout << "info: copy Device2Host\n";
+    bufMgr.copyToHost(A, A_d);
+
+    std::cout << "info: check result\n";
+    const uint32_t expected = FINAL_VAL + static_cast<uint32_t>(i);
+
+    for (size_t j = 0; j < N; j++) {
+      // std::printf("A[%zd] == %u\n", j, A[j]);
+      if (A[j] != expected) {
+        passed = false;
+      }
     }
   }
 
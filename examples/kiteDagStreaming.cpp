@@ -0,0 +1,79 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#include "kiteDagGpu.h"
+
+#include "dagee/ATMIalloc.h"
+#include "dagee/ATMIgpuExecutor.h"
+#include "dagee/ATMIstreamingDAGexecutor.h"
+
+#include <cstdlib>
+
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+  constexpr unsigned threadsPerBlock = 1024;
+  constexpr unsigned blocks = 16;
+
+  constexpr size_t N = threadsPerBlock * blocks;
+  constexpr size_t NUM_KITES = 1000;
+  // at most 4 kites worth of nodes are alive at a time
+  constexpr size_t MAX_IN_FLIGHT = 16;
+
+  std::vector<uint32_t> A(N, 0);
+  std::vector<uint32_t> B(N, 0);
+  std::vector<uint32_t> C(N, 0);
+
+  std::cout << "info: copy Host2Device\n";
+
+  using GpuExec = dagee::GpuExecutorAtmi;
+  using StreamExec = dagee::ATMIstreamingDAGexecutor<GpuExec>;
+
+  dagee::AllocManagerAtmi bufMgr;
+
+  auto A_d = bufMgr.makeDeviceCopy(A);
+  auto B_d = bufMgr.makeDeviceCopy(B);
+  auto C_d = bufMgr.makeDeviceCopy(C);
+
+  GpuExec gpuEx;
+  StreamExec streamEx(gpuEx, MAX_IN_FLIGHT);
+
+  auto topK = gpuEx.registerKernel<uint32_t*, size_t>(&topKern);
+  auto midK = gpuEx.registerKernel<uint32_t*, uint32_t*, size_t, uint32_t>(&midKern);
+  auto bottomK = gpuEx.registerKernel<uint32_t*, uint32_t*, uint32_t*, size_t>(&bottomKern);
+
+  std::cout << "Streaming " << NUM_KITES << " Kite DAGs\n";
+
+  //![Streaming Launch]
+  // kites arrive one by one, each after the previous one as they share buffers
+  StreamExec::NodeHandle prevBottom;
+
+  for (size_t k = 0; k < NUM_KITES; ++k) {
+    auto topTask = streamEx.addNode(gpuEx.makeTask(blocks, threadsPerBlock, topK, A_d, N));
+    if (prevBottom.valid()) {
+      streamEx.addEdge(prevBottom, topTask);
+    }
+    streamEx.submit(topTask);
+
+    auto leftTask = streamEx.addTask(
+        gpuEx.makeTask(blocks, threadsPerBlock, midK, A_d, B_d, N, LEFT_ADD_VAL), {topTask});
+    auto rightTask = streamEx.addTask(
+        gpuEx.makeTask(blocks, threadsPerBlock, midK, A_d, C_d, N, RIGHT_ADD_VAL), {topTask});
+
+    prevBottom = streamEx.addTask(
+        gpuEx.makeTask(blocks, threadsPerBlock, bottomK, A_d, B_d, C_d, N), {leftTask, rightTask});
+  }
+
+  streamEx.waitAll();
+  //![Streaming Launch]
+
+  std::cout << "info: " << streamEx.numRetired() << " tasks retired, peak live nodes "
+            << streamEx.numSlots() << "\n";
+
+  std::cout << "info: copy Device2Host\n";
+  bufMgr.copyBufferToVec(A, A_d);
+
+  checkOutput(A);
+
+  return 0;
+}
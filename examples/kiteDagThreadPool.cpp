@@ -0,0 +1,159 @@
+// Copyright (c) 2018-Present Advanced Micro Devices, Inc. See LICENSE.TXT for terms.
+
+#include "dagee/DAGexecutor.h"
+#include "dagee/ThreadPoolExecutor.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// same as kiteDagGpu.h, which needs HIP
+constexpr uint32_t INIT_VAL = 1;
+constexpr uint32_t LEFT_ADD_VAL = 2;
+constexpr uint32_t RIGHT_ADD_VAL = 3;
+constexpr uint32_t FINAL_VAL = 3 * INIT_VAL + LEFT_ADD_VAL + RIGHT_ADD_VAL;
+
+void topKernCpu(uint32_t* A_d, size_t N) {
+  for (size_t i = 0; i < N; i++) {
+    A_d[i] = INIT_VAL;
+  }
+}
+
+void midKernCpu(uint32_t* A_d, uint32_t* B_d, size_t N, uint32_t addVal) {
+  for (size_t i = 0; i < N; i++) {
+    B_d[i] = A_d[i] + addVal;
+  }
+}
+
+void bottomKernCpu(uint32_t* A_d, uint32_t* B_d, uint32_t* C_d, size_t N) {
+  for (size_t i = 0; i < N; i++) {
+    A_d[i] = A_d[i] + B_d[i] + C_d[i];
+  }
+}
+
+template <typename V>
+void checkOutput(const V& A) {
+  std::cout << "info: check result\n";
+
+  for (size_t i = 0; i < A.size(); i++) {
+    if (A[i] != FINAL_VAL) {
+      std::printf("Failed at A[%zd] = %u | Expected = %u\n", i, A[i], FINAL_VAL);
+      std::abort();
+    }
+  }
+  std::cout << "PASSED!\n";
+}
+
+template <bool DYNAMIC_LAUNCH>
+void test(dagee::ThreadPoolExecutor& poolEx) {
+  unsigned numThreads = 1;
+
+  constexpr size_t N = 16;
+
+  std::vector<uint32_t> A(N, 0);
+  std::vector<uint32_t> B(N, 0);
+  std::vector<uint32_t> C(N, 0);
+
+  auto A_h = A.data();
+  auto B_h = B.data();
+  auto C_h = C.data();
+
+  auto topK = poolEx.registerKernel<uint32_t*, size_t>(&topKernCpu);
+  auto midK = poolEx.registerKernel<uint32_t*, uint32_t*, size_t, uint32_t>(&midKernCpu);
+  auto bottomK = poolEx.registerKernel<uint32_t*, uint32_t*, uint32_t*, size_t>(&bottomKernCpu);
+
+  if (DYNAMIC_LAUNCH) {
+    std::cout << "Running host tasks on the thread pool one at a time\n";
+    auto topTask = poolEx.launchTask(poolEx.makeTask(numThreads, topK, A_h, N));
+
+    auto leftTask =
+        poolEx.launchTask(poolEx.makeTask(numThreads, midK, A_h, B_h, N, LEFT_ADD_VAL), {topTask});
+    auto rightTask = poolEx.launchTask(
+        poolEx.makeTask(numThreads, midK, A_h, C_h, N, RIGHT_ADD_VAL), {topTask});
+
+    auto bottomTask = poolEx.launchTask(poolEx.makeTask(numThreads, bottomK, A_h, B_h, C_h, N),
+                                        {leftTask, rightTask});
+    poolEx.waitOnTask(bottomTask);
+
+  } else {
+    std::cout << "Building Kite DAG\n";
+    dagee::DAGexecutor<dagee::ThreadPoolExecutor> dagEx(poolEx);
+    auto* dag = dagEx.makeDAG();
+
+    auto topTask = dag->addNode(poolEx.makeTask(numThreads, topK, A_h, N));
+    auto leftTask = dag->addNode(poolEx.makeTask(numThreads, midK, A_h, B_h, N, LEFT_ADD_VAL));
+    auto rightTask = dag->addNode(poolEx.makeTask(numThreads, midK, A_h, C_h, N, RIGHT_ADD_VAL));
+    auto bottomTask = dag->addNode(poolEx.makeTask(numThreads, bottomK, A_h, B_h, C_h, N));
+
+    dag->addFanOutEdges(topTask, {leftTask, rightTask});
+    dag->addFanInEdges({leftTask, rightTask}, bottomTask);
+
+    std::cout << "Executing Kite DAG\n";
+
+    dagEx.execute(dag);
+  }
+
+  checkOutput(A);
+}
+
+size_t countSources(dagee::DAGbase<dagee::ThreadPoolTaskInstance>& dag) {
+  size_t n = 0;
+  dag.forEachSource([&n](dagee::DAGbase<dagee::ThreadPoolTaskInstance>::NodePtr) { ++n; });
+  return n;
+}
+
+/**
+ * Runs the kite tasks on this thread in topological order, on a DAG storing
+ * only predecessors, which is traversed in pull mode. Traversals must leave
+ * the sources of the DAG as they were
+ */
+void testPullTraversal(dagee::ThreadPoolExecutor& poolEx) {
+  unsigned numThreads = 1;
+
+  constexpr size_t N = 16;
+
+  std::vector<uint32_t> A(N, 0);
+  std::vector<uint32_t> B(N, 0);
+  std::vector<uint32_t> C(N, 0);
+
+  auto A_h = A.data();
+  auto B_h = B.data();
+  auto C_h = C.data();
+
+  auto topK = poolEx.registerKernel<uint32_t*, size_t>(&topKernCpu);
+  auto midK = poolEx.registerKernel<uint32_t*, uint32_t*, size_t, uint32_t>(&midKernCpu);
+  auto bottomK = poolEx.registerKernel<uint32_t*, uint32_t*, uint32_t*, size_t>(&bottomKernCpu);
+
+  std::cout << "Running the Kite DAG in topological order\n";
+  dagee::DAGbase<dagee::ThreadPoolTaskInstance> dag;
+
+  auto topTask = dag.addNode(poolEx.makeTask(numThreads, topK, A_h, N));
+  auto leftTask = dag.addNode(poolEx.makeTask(numThreads, midK, A_h, B_h, N, LEFT_ADD_VAL));
+  auto rightTask = dag.addNode(poolEx.makeTask(numThreads, midK, A_h, C_h, N, RIGHT_ADD_VAL));
+  auto bottomTask = dag.addNode(poolEx.makeTask(numThreads, bottomK, A_h, B_h, C_h, N));
+
+  dag.addFanOutEdges(topTask, {leftTask, rightTask});
+  dag.addFanInEdges({leftTask, rightTask}, bottomTask);
+
+  const size_t numSources = countSources(dag);
+  dag.forEachNode_TopoOrder([&dag](decltype(topTask) n) { dag.nodeData(n).mFunc(); });
+  checkOutput(A);
+
+  auto tailTask = dag.addNode(poolEx.makeTask([] {}));
+  dag.addEdge(bottomTask, tailTask);
+
+  if (numSources != 1 || countSources(dag) != numSources || tailTask->isSrc()) {
+    std::printf("Failed: %zu sources before the traversal, %zu after\n", numSources,
+                countSources(dag));
+    std::abort();
+  }
+}
+
+int main(int, char**) {
+  dagee::ThreadPoolExecutor poolEx;
+  test<true>(poolEx);
+  test<false>(poolEx);
+  testPullTraversal(poolEx);
+}